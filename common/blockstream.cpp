@@ -0,0 +1,171 @@
+#include "blockstream.h"
+
+enum
+{
+    BlockStreamMagic = 0x53424356, // "VCBS"
+    BlockStreamVersion = 1
+};
+
+enum RecordTag
+{
+    EndRecord = 0,
+    TypeRecord = 1,
+    RunRecord = 2
+};
+
+BlockStreamWriter::BlockStreamWriter(QIODevice *device)
+    : m_stream(device)
+{
+    m_stream.setByteOrder(QDataStream::LittleEndian);
+}
+
+void
+BlockStreamWriter::writeHeader()
+{
+    m_stream << (quint32)BlockStreamMagic;
+    m_stream << (quint16)BlockStreamVersion;
+}
+
+void
+BlockStreamWriter::writeRun(const QString &type, int rotation, const Vector<int> &start, const Vector<int> &step, int length)
+{
+    if (!m_typeIndexes.contains(type))
+    {
+        int index = m_typeIndexes.size();
+        m_typeIndexes[type] = index;
+
+        m_stream << (quint8)TypeRecord;
+        m_stream << type;
+    }
+
+    m_stream << (quint8)RunRecord;
+    m_stream << (quint16)m_typeIndexes.value(type);
+    m_stream << (qint8)rotation;
+    m_stream << (qint32)start.x << (qint32)start.y << (qint32)start.z;
+    m_stream << (qint8)step.x << (qint8)step.y << (qint8)step.z;
+    m_stream << (quint32)length;
+}
+
+void
+BlockStreamWriter::writeBlock(const QString &type, int rotation, const Vector<int> &position)
+{
+    writeRun(type, rotation, position, Vector<int>(), 1);
+}
+
+void
+BlockStreamWriter::writeEnd()
+{
+    m_stream << (quint8)EndRecord;
+}
+
+bool
+BlockStreamWriter::hasError() const
+{
+    return m_stream.status() != QDataStream::Ok;
+}
+
+BlockStreamReader::BlockStreamReader(QIODevice *device)
+    : m_stream(device)
+{
+    m_stream.setByteOrder(QDataStream::LittleEndian);
+    m_error = false;
+}
+
+bool
+BlockStreamReader::readHeader()
+{
+    quint32 magic;
+    quint16 version;
+
+    m_stream >> magic >> version;
+
+    if ((m_stream.status() != QDataStream::Ok) || (magic != BlockStreamMagic))
+    {
+        qWarning("BlockStreamReader: invalid stream header");
+        m_error = true;
+        return false;
+    }
+    if (version != BlockStreamVersion)
+    {
+        qWarning("BlockStreamReader: unsupported stream version %d", version);
+        m_error = true;
+        return false;
+    }
+    return true;
+}
+
+bool
+BlockStreamReader::readRun(QString &type, int &rotation, Vector<int> &start, Vector<int> &step, int &length)
+{
+    forever
+    {
+        quint8 tag;
+        m_stream >> tag;
+        if (m_stream.status() != QDataStream::Ok)
+        {
+            qWarning("BlockStreamReader: unexpected end of stream");
+            m_error = true;
+            return false;
+        }
+
+        if (tag == EndRecord)
+        {
+            return false;
+        }
+        else if (tag == TypeRecord)
+        {
+            QString name;
+            m_stream >> name;
+            m_types.append(name);
+        }
+        else if (tag == RunRecord)
+        {
+            quint16 typeIndex;
+            qint8 r;
+            qint32 x, y, z;
+            qint8 dx, dy, dz;
+            quint32 n;
+
+            m_stream >> typeIndex >> r;
+            m_stream >> x >> y >> z;
+            m_stream >> dx >> dy >> dz;
+            m_stream >> n;
+
+            if ((m_stream.status() != QDataStream::Ok) || (typeIndex >= m_types.size()))
+            {
+                qWarning("BlockStreamReader: corrupted run record");
+                m_error = true;
+                return false;
+            }
+
+            type = m_types[typeIndex];
+            rotation = r;
+            start = Vector<int>(x, y, z);
+            step = Vector<int>(dx, dy, dz);
+            length = n;
+            return true;
+        }
+        else
+        {
+            qWarning("BlockStreamReader: unknown record tag %d", tag);
+            m_error = true;
+            return false;
+        }
+    }
+}
+
+bool
+BlockStreamReader::hasError() const
+{
+    return m_error;
+}
+
+bool
+BlockStreamReader::isBlockStream(QIODevice *device)
+{
+    QByteArray header = device->peek(4);
+    if (header.size() != 4) return false;
+
+    quint32 magic = (quint8)header[0] | ((quint8)header[1] << 8) | ((quint8)header[2] << 16) | ((quint32)(quint8)header[3] << 24);
+    return magic == BlockStreamMagic;
+}
@@ -0,0 +1,77 @@
+#ifndef BLOCKSTREAM_H
+#define BLOCKSTREAM_H
+
+#include <QString>
+#include <QMap>
+#include <QList>
+#include <QDataStream>
+#include <QIODevice>
+#include "vector.h"
+
+/*
+ * Binary block stream.
+ *
+ * Stream layout (little endian):
+ *   header: magic (quint32), version (quint16)
+ *   records: tag (quint8) followed by the record body
+ *     TypeRecord: name (QString), gets the next free type index
+ *     RunRecord:  type index (quint16), rotation (qint8),
+ *                 start x, y, z (qint32), step x, y, z (qint8), length (quint32)
+ *     EndRecord:  no body
+ *
+ * A single block is a run of length 1 with zero step.
+ */
+
+class BlockStreamWriter
+{
+public:
+    BlockStreamWriter(QIODevice *device);
+
+    void
+    writeHeader();
+
+    void
+    writeRun(const QString &type, int rotation, const Vector<int> &start, const Vector<int> &step, int length);
+
+    void
+    writeBlock(const QString &type, int rotation, const Vector<int> &position);
+
+    void
+    writeEnd();
+
+    bool
+    hasError() const;
+
+private:
+    QDataStream m_stream;
+    QMap<QString, int> m_typeIndexes;
+};
+
+class BlockStreamReader
+{
+public:
+    BlockStreamReader(QIODevice *device);
+
+    bool
+    readHeader();
+
+    /*
+     * Returns false at the end of the stream or on error.
+     */
+    bool
+    readRun(QString &type, int &rotation, Vector<int> &start, Vector<int> &step, int &length);
+
+    bool
+    hasError() const;
+
+public:
+    static bool
+    isBlockStream(QIODevice *device);
+
+private:
+    QDataStream m_stream;
+    QList<QString> m_types;
+    bool m_error;
+};
+
+#endif // BLOCKSTREAM_H
@@ -0,0 +1,171 @@
+#include "celllibrary.h"
+#include "cellvariantfile.h"
+#include <QScopedPointer>
+
+CellLibrary::CellLibrary()
+{
+}
+
+int
+CellLibrary::cellCount() const
+{
+    return m_cellNames.size();
+}
+
+int
+CellLibrary::cellIndex(const QString &name) const
+{
+    return m_cellIndexes.value(name, -1);
+}
+
+QString
+CellLibrary::cellName(int cell) const
+{
+    return m_cellNames[cell];
+}
+
+Vector<int>
+CellLibrary::dimensions(int cell) const
+{
+    return m_dimensions[cell];
+}
+
+int
+CellLibrary::variantCount(int cell) const
+{
+    return m_variantPointers[cell + 1] - m_variantPointers[cell];
+}
+
+int
+CellLibrary::variantIndex(int cell, const QString &name) const
+{
+    return m_variantIndexes[cell].value(name, -1);
+}
+
+QString
+CellLibrary::variantName(int cell, int variant) const
+{
+    return m_variantNames[globalVariant(cell, variant)];
+}
+
+int
+CellLibrary::portCount(int cell) const
+{
+    return m_portPointers[cell + 1] - m_portPointers[cell];
+}
+
+int
+CellLibrary::portIndex(int cell, const QString &name) const
+{
+    return m_portIndexes[cell].value(name, -1);
+}
+
+QString
+CellLibrary::portName(int cell, int port) const
+{
+    return m_portNames[m_portPointers[cell] + port];
+}
+
+bool
+CellLibrary::portPosition(Vector<int> &pos, int cell, int variant, int port) const
+{
+    int i = m_offsetPointers[globalVariant(cell, variant)] + port;
+    if (!m_hasPort[i]) return false;
+
+    pos = m_offsets[i];
+    return true;
+}
+
+const Vector<int> &
+CellLibrary::portOffset(int cell, int variant, int port) const
+{
+    return m_offsets[m_offsetPointers[globalVariant(cell, variant)] + port];
+}
+
+int
+CellLibrary::blockCount(int cell, int variant) const
+{
+    int v = globalVariant(cell, variant);
+    return m_blockPointers[v + 1] - m_blockPointers[v];
+}
+
+const CellVariant::Block &
+CellLibrary::block(int cell, int variant, int index) const
+{
+    return m_blocks[m_blockPointers[globalVariant(cell, variant)] + index];
+}
+
+int
+CellLibrary::globalVariant(int cell, int variant) const
+{
+    return m_variantPointers[cell] + variant;
+}
+
+CellLibrary *
+CellLibrary::build(const CellVariantFile *file)
+{
+    QScopedPointer<CellLibrary> library(new CellLibrary());
+
+    library->m_variantPointers.append(0);
+    library->m_portPointers.append(0);
+    library->m_offsetPointers.append(0);
+    library->m_blockPointers.append(0);
+
+    foreach (const QString &cellName, file->allCells())
+    {
+        CellVariantList list = file->variantList(cellName);
+        if (!list.isValid())
+        {
+            qWarning("Can't get variant list for cell %s", qPrintable(cellName));
+            return 0;
+        }
+        QList<CellVariant> variants = list.allVariants();
+
+        /* Ports of the cell are the union of the ports of its variants  */
+        QHash<QString, int> portIndexes;
+        foreach (const CellVariant &v, variants)
+        {
+            foreach (const QString &portName, v.allPorts())
+            {
+                if (portIndexes.contains(portName)) continue;
+
+                int index = portIndexes.size();
+                portIndexes[portName] = index;
+                library->m_portNames.append(portName);
+            }
+        }
+
+        QHash<QString, int> variantIndexes;
+        foreach (const CellVariant &v, variants)
+        {
+            int index = variantIndexes.size();
+            variantIndexes[v.name()] = index;
+            library->m_variantNames.append(v.name());
+
+            int first = library->m_offsets.size();
+            library->m_offsets.resize(first + portIndexes.size());
+            library->m_hasPort.resize(first + portIndexes.size());
+            for (QHash<QString, int>::const_iterator i = portIndexes.constBegin(); i != portIndexes.constEnd(); ++i)
+            {
+                library->m_hasPort[first + i.value()] = v.portPosition(library->m_offsets[first + i.value()], i.key());
+            }
+            library->m_offsetPointers.append(library->m_offsets.size());
+
+            foreach (const CellVariant::Block &block, v.allBlocks())
+            {
+                library->m_blocks.append(block);
+            }
+            library->m_blockPointers.append(library->m_blocks.size());
+        }
+
+        library->m_cellIndexes[cellName] = library->m_cellNames.size();
+        library->m_cellNames.append(cellName);
+        library->m_dimensions.append(list.dimensions());
+        library->m_variantIndexes.append(variantIndexes);
+        library->m_portIndexes.append(portIndexes);
+        library->m_variantPointers.append(library->m_variantNames.size());
+        library->m_portPointers.append(library->m_portNames.size());
+    }
+
+    return library.take();
+}
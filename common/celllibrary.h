@@ -0,0 +1,110 @@
+#ifndef CELLLIBRARY_H
+#define CELLLIBRARY_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include "vector.h"
+#include "cellvariant.h"
+
+class CellVariantFile;
+
+/*
+ * Cell variants compiled into flat arrays for indexed lookups.
+ *
+ * Cells, their variants and ports are numbered, variants of a cell in the
+ * order of CellVariantList::allVariants(). Port offsets of a variant and
+ * blocks of a variant are contiguous. Names are resolved once, hot loops
+ * only use the indexes.
+ */
+class CellLibrary
+{
+public:
+    int
+    cellCount() const;
+
+    // -1 if there is no such cell
+    int
+    cellIndex(const QString &name) const;
+
+    QString
+    cellName(int cell) const;
+
+    Vector<int>
+    dimensions(int cell) const;
+
+public:
+    int
+    variantCount(int cell) const;
+
+    // -1 if the cell has no such variant
+    int
+    variantIndex(int cell, const QString &name) const;
+
+    QString
+    variantName(int cell, int variant) const;
+
+public:
+    // Ports of all variants of the cell
+    int
+    portCount(int cell) const;
+
+    // -1 if the cell has no such port
+    int
+    portIndex(int cell, const QString &name) const;
+
+    QString
+    portName(int cell, int port) const;
+
+    // Returns false if the variant doesn't have the port
+    bool
+    portPosition(Vector<int> &pos, int cell, int variant, int port) const;
+
+    // Zero if the variant doesn't have the port
+    const Vector<int> &
+    portOffset(int cell, int variant, int port) const;
+
+public:
+    int
+    blockCount(int cell, int variant) const;
+
+    const CellVariant::Block &
+    block(int cell, int variant, int index) const;
+
+public:
+    static CellLibrary *
+    build(const CellVariantFile *file);
+
+private:
+    CellLibrary();
+
+    // Index of the variant in all variants of the library
+    int
+    globalVariant(int cell, int variant) const;
+
+private:
+    QVector<QString> m_cellNames;
+    QHash<QString, int> m_cellIndexes;
+    QVector<Vector<int> > m_dimensions;
+
+    // Variants of cell c are [m_variantPointers[c]; m_variantPointers[c + 1])
+    QVector<int> m_variantPointers;
+    QVector<QString> m_variantNames;
+    QVector<QHash<QString, int> > m_variantIndexes; // cell -> name -> variant
+
+    // Ports of cell c are [m_portPointers[c]; m_portPointers[c + 1])
+    QVector<int> m_portPointers;
+    QVector<QString> m_portNames;
+    QVector<QHash<QString, int> > m_portIndexes; // cell -> name -> port
+
+    // Offsets of global variant v are [m_offsetPointers[v]; m_offsetPointers[v + 1]), one per port of the cell
+    QVector<int> m_offsetPointers;
+    QVector<Vector<int> > m_offsets;
+    QVector<bool> m_hasPort;
+
+    // Blocks of global variant v are [m_blockPointers[v]; m_blockPointers[v + 1])
+    QVector<int> m_blockPointers;
+    QVector<CellVariant::Block> m_blocks;
+};
+
+#endif // CELLLIBRARY_H
@@ -14,6 +14,12 @@ CellVariant::name() const
     return m_name;
 }
 
+QList<QString>
+CellVariant::allPorts() const
+{
+    return m_ports.keys();
+}
+
 bool
 CellVariant::portPosition(Vector<int> &pos, const QString &portName) const
 {
@@ -26,6 +26,9 @@ public:
     QString
     name() const;
 
+    QList<QString>
+    allPorts() const;
+
     bool
     portPosition(Vector<int> &pos, const QString &portName) const;
 
@@ -1,6 +1,12 @@
 #include "cellvariantfile.h"
 #include <QFile>
 
+QList<QString>
+CellVariantFile::allCells() const
+{
+    return m_cells.keys();
+}
+
 CellVariantList
 CellVariantFile::variantList(const QString &cellName) const
 {
@@ -9,6 +9,9 @@
 class CellVariantFile
 {
 public:
+    QList<QString>
+    allCells() const;
+
     CellVariantList
     variantList(const QString &cellName) const;
 
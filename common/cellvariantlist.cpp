@@ -16,6 +16,12 @@ CellVariantList::name() const
     return m_name;
 }
 
+Vector<int>
+CellVariantList::dimensions() const
+{
+    return m_dimensions;
+}
+
 QList<CellVariant>
 CellVariantList::allVariants() const
 {
@@ -2,121 +2,394 @@
 #include <QFile>
 #include <QXmlStreamReader>
 #include <QScopedPointer>
+#include <QtAlgorithms>
 
-void
+Netlist::Netlist()
+{
+}
+
+int
+Netlist::intern(QVector<QString> &names, QHash<QString, int> &ids, const QString &name)
+{
+    int id = ids.value(name, -1);
+    if (id < 0)
+    {
+        id = names.size();
+        ids[name] = id;
+        names.append(name);
+    }
+    return id;
+}
+
+int
 Netlist::addItem(const QString &itemName)
 {
-    m_itemNetMap[itemName].clear();
-    m_cellTypes[itemName].clear();
-    m_propertyMap[itemName].clear();
+    int item = m_itemIds.value(itemName, -1);
+    if (item >= 0) return item;
+
+    item = intern(m_itemNames, m_itemIds, itemName);
+    m_pads.append(false);
+    m_deleted.append(false);
+    m_cellTypes.append(-1);
+    m_variants.append(-1);
+    m_positions.append(Vector<int>());
+    m_hasPositions.append(false);
+    return item;
 }
 
-void
+int
 Netlist::addNet(const QString &netName)
 {
-    m_netMap[netName].clear();
+    return intern(m_netNames, m_netIds, netName);
 }
 
 void
 Netlist::addItemToNet(const QString &netName, const QString &itemName, const QString &portName)
 {
-    m_netMap[netName].append(qMakePair(itemName, portName));
-    m_itemNetMap[itemName][portName] = netName;
+    m_pinItems.append(addItem(itemName));
+    m_pinNets.append(addNet(netName));
+    m_pinPorts.append(intern(m_portNames, m_portIds, portName));
 }
 
 void
 Netlist::setItemType(const QString &itemName, bool isPad)
 {
-    if (isPad)
+    int item = itemId(itemName);
+    if (item >= 0) m_pads[item] = isPad;
+}
+
+struct NameOrder
+{
+    NameOrder(const QVector<QString> &names)
+        : m_names(names)
+    {
+    }
+
+    bool operator()(int a, int b) const
+    {
+        return m_names[a] < m_names[b];
+    }
+
+    const QVector<QString> &m_names;
+};
+
+// Returns new IDs of the sorted names
+static QVector<int>
+sortNames(QVector<QString> &names, QHash<QString, int> &ids)
+{
+    QVector<int> order(names.size());
+    for (int i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    qSort(order.begin(), order.end(), NameOrder(names));
+
+    QVector<int> newIds(names.size());
+    QVector<QString> sorted(names.size());
+    for (int i = 0; i < order.size(); i++)
+    {
+        newIds[order[i]] = i;
+        sorted[i] = names[order[i]];
+        ids[sorted[i]] = i;
+    }
+    names = sorted;
+    return newIds;
+}
+
+template<class T>
+static void
+permute(QVector<T> &values, const QVector<int> &newIds)
+{
+    QVector<T> result(values.size());
+    for (int i = 0; i < values.size(); i++)
+    {
+        result[newIds[i]] = values[i];
+    }
+    values = result;
+}
+
+struct PortOrder
+{
+    PortOrder(const QVector<int> &ports, const QVector<QString> &names)
+        : m_ports(ports), m_names(names)
+    {
+    }
+
+    bool operator()(int a, int b) const
+    {
+        return m_names[m_ports[a]] < m_names[m_ports[b]];
+    }
+
+    const QVector<int> &m_ports;
+    const QVector<QString> &m_names;
+};
+
+void
+Netlist::index()
+{
+    QVector<int> itemIds = sortNames(m_itemNames, m_itemIds);
+    permute(m_pads, itemIds);
+    permute(m_deleted, itemIds);
+    permute(m_cellTypes, itemIds);
+    permute(m_variants, itemIds);
+    permute(m_positions, itemIds);
+    permute(m_hasPositions, itemIds);
+
+    QHash<int, QHash<QString, QString> > properties;
+    for (QHash<int, QHash<QString, QString> >::const_iterator i = m_properties.constBegin(); i != m_properties.constEnd(); ++i)
+    {
+        properties[itemIds[i.key()]] = i.value();
+    }
+    m_properties = properties;
+
+    QVector<int> netIds = sortNames(m_netNames, m_netIds);
+
+    /* Pins ordered by net, in the order they were added  */
+    int pinCount = m_pinItems.size();
+    int netCount = m_netNames.size();
+    m_netPointers.fill(0, netCount + 1);
+    for (int pin = 0; pin < pinCount; pin++)
+    {
+        m_pinItems[pin] = itemIds[m_pinItems[pin]];
+        m_pinNets[pin] = netIds[m_pinNets[pin]];
+        m_netPointers[m_pinNets[pin] + 1]++;
+    }
+    for (int net = 0; net < netCount; net++)
+    {
+        m_netPointers[net + 1] += m_netPointers[net];
+    }
+
+    QVector<int> fill = m_netPointers;
+    QVector<int> pinIds(pinCount);
+    for (int pin = 0; pin < pinCount; pin++)
+    {
+        pinIds[pin] = fill[m_pinNets[pin]]++;
+    }
+    permute(m_pinItems, pinIds);
+    permute(m_pinNets, pinIds);
+    permute(m_pinPorts, pinIds);
+
+    /* Item -> pins, ordered by port name  */
+    int itemCount = m_itemNames.size();
+    m_itemPointers.fill(0, itemCount + 1);
+    foreach (int item, m_pinItems)
+    {
+        m_itemPointers[item + 1]++;
+    }
+    for (int item = 0; item < itemCount; item++)
     {
-        m_padNames.insert(itemName);
+        m_itemPointers[item + 1] += m_itemPointers[item];
     }
-    else
+
+    fill = m_itemPointers;
+    m_itemPins.resize(pinCount);
+    for (int pin = 0; pin < pinCount; pin++)
     {
-        m_padNames.remove(itemName);
+        m_itemPins[fill[m_pinItems[pin]]++] = pin;
+    }
+    for (int item = 0; item < itemCount; item++)
+    {
+        qStableSort(m_itemPins.begin() + m_itemPointers[item], m_itemPins.begin() + m_itemPointers[item + 1],
+                    PortOrder(m_pinPorts, m_portNames));
     }
 }
 
 void
 Netlist::deleteItem(const QString &itemName)
 {
-    m_padNames.remove(itemName);
-    m_itemNetMap.remove(itemName);
-    m_cellTypes.remove(itemName);
-    m_propertyMap.remove(itemName);
+    int item = itemId(itemName);
+    if (item < 0) return;
+
+    m_deleted[item] = true;
+    m_properties.remove(item);
+}
+
+void
+Netlist::addGate(const QString &itemName, const QString &cellType)
+{
+    addItem(itemName);
+    setItemType(itemName, false);
+    setCellType(itemName, cellType);
+}
+
+void
+Netlist::connect(const QString &itemName, const QString &portName, const QString &netName)
+{
+    int item = addItem(itemName);
+    int net = addNet(netName);
+
+    /* Pins of the last commit are indexed, later ones are at the end  */
+    int indexed = m_itemPins.size();
+    if (item < m_itemPointers.size() - 1)
+    {
+        for (int i = m_itemPointers[item]; i < m_itemPointers[item + 1]; i++)
+        {
+            if (pinPort(m_itemPins[i]) == portName)
+            {
+                m_pinNets[m_itemPins[i]] = net;
+                return;
+            }
+        }
+    }
+    for (int pin = indexed; pin < m_pinItems.size(); pin++)
+    {
+        if ((m_pinItems[pin] == item) && (pinPort(pin) == portName))
+        {
+            m_pinNets[pin] = net;
+            return;
+        }
+    }
+
+    addItemToNet(netName, itemName, portName);
+}
+
+void
+Netlist::commit()
+{
+    index();
 }
 
 QList<QString>
 Netlist::allItems() const
 {
-    return m_itemNetMap.keys();
+    QList<QString> items;
+    for (int item = 0; item < itemCount(); item++)
+    {
+        if (!m_deleted[item]) items.append(m_itemNames[item]);
+    }
+    return items;
 }
 
 QList<QString>
 Netlist::allGates() const
 {
-    QSet<QString> items = m_itemNetMap.keys().toSet();
-    return (items - m_padNames).toList();
+    QList<QString> gates;
+    for (int item = 0; item < itemCount(); item++)
+    {
+        if (!m_deleted[item] && !m_pads[item]) gates.append(m_itemNames[item]);
+    }
+    return gates;
 }
 
 QList<QString>
 Netlist::allPads() const
 {
-    return m_padNames.toList();
+    QList<QString> pads;
+    for (int item = 0; item < itemCount(); item++)
+    {
+        if (!m_deleted[item] && m_pads[item]) pads.append(m_itemNames[item]);
+    }
+    return pads;
 }
 
 QList<QString>
 Netlist::allNets() const
 {
-    return m_netMap.keys();
+    return m_netNames.toList();
+}
+
+bool
+Netlist::isGate(const QString &itemName) const
+{
+    int item = itemId(itemName);
+    return (item >= 0) && !m_deleted[item] && !m_pads[item];
+}
+
+bool
+Netlist::isPad(const QString &itemName) const
+{
+    int item = itemId(itemName);
+    return (item >= 0) && !m_deleted[item] && m_pads[item];
 }
 
 QList<QString>
 Netlist::itemPorts(const QString &itemName) const
 {
-    return m_itemNetMap.value(itemName).keys();
+    QList<QString> ports;
+    int item = itemId(itemName);
+    if ((item < 0) || m_deleted[item]) return ports;
+
+    for (int i = itemPinBegin(item); i < itemPinEnd(item); i++)
+    {
+        QString port = pinPort(m_itemPins[i]);
+        if (ports.isEmpty() || (ports.last() != port)) ports.append(port);
+    }
+    return ports;
+}
+
+QString
+Netlist::netByItemPort(const QString &itemName, const QString &portName) const
+{
+    int item = itemId(itemName);
+    if ((item < 0) || m_deleted[item]) return QString();
+
+    for (int i = itemPinBegin(item); i < itemPinEnd(item); i++)
+    {
+        if (pinPort(m_itemPins[i]) == portName) return m_netNames[m_pinNets[m_itemPins[i]]];
+    }
+    return QString();
 }
 
 QList<QString>
 Netlist::itemsByNet(const QString &netName) const
 {
-    QSet<QString> items;
-    QList<QPair<QString, QString> > net = m_netMap.value(netName);
-    for (int i = 0; i < net.size(); i++)
+    QList<QString> items;
+    int net = netId(netName);
+    if (net < 0) return items;
+
+    QVector<int> ids;
+    for (int pin = netPinBegin(net); pin < netPinEnd(net); pin++)
     {
-        items.insert(net[i].first);
+        if (!ids.contains(m_pinItems[pin])) ids.append(m_pinItems[pin]);
     }
-    return items.toList();
+    foreach (int item, ids)
+    {
+        items.append(m_itemNames[item]);
+    }
+    return items;
 }
 
 QList<QPair<QString, QString> >
 Netlist::itemsAndPortsByNet(const QString &netName) const
 {
-    return m_netMap.value(netName);
+    QList<QPair<QString, QString> > pins;
+    int net = netId(netName);
+    if (net < 0) return pins;
+
+    for (int pin = netPinBegin(net); pin < netPinEnd(net); pin++)
+    {
+        pins.append(qMakePair(m_itemNames[m_pinItems[pin]], pinPort(pin)));
+    }
+    return pins;
 }
 
 QString
 Netlist::cellType(const QString &itemName) const
 {
-    return m_cellTypes.value(itemName);
+    int item = itemId(itemName);
+    if ((item < 0) || m_deleted[item] || (m_cellTypes[item] < 0)) return QString();
+
+    return m_cellTypeNames[m_cellTypes[item]];
 }
 
 void
 Netlist::setCellType(const QString &itemName, const QString &cellType)
 {
-    m_cellTypes[itemName] = cellType;
+    int item = itemId(itemName);
+    if (item >= 0) m_cellTypes[item] = intern(m_cellTypeNames, m_cellTypeIds, cellType);
 }
 
 QString
 Netlist::itemProperty(const QString &itemName, const QString &propertyName) const
 {
-    return m_propertyMap.value(itemName).value(propertyName);
+    return m_properties.value(itemId(itemName)).value(propertyName);
 }
 
 void
 Netlist::setItemProperty(const QString &itemName, const QString &propertyName, const QString &propertyValue)
 {
-    m_propertyMap[itemName][propertyName] = propertyValue;
+    int item = itemId(itemName);
+    if (item >= 0) m_properties[item][propertyName] = propertyValue;
 }
 
 QString
@@ -128,37 +401,188 @@ Netlist::externalName(const QString &itemName) const
 bool
 Netlist::position(const QString &itemName, int &x, int &y, int &z) const
 {
-    QString sx = itemProperty(itemName, "X");
-    QString sy = itemProperty(itemName, "Y");
-    QString sz = itemProperty(itemName, "Z");
-    if (sx.isEmpty() || sy.isEmpty() || sz.isEmpty()) return false;
+    int item = itemId(itemName);
+    if ((item < 0) || m_deleted[item] || !m_hasPositions[item]) return false;
 
-    bool okX, okY, okZ;
-    x = sx.toInt(&okX);
-    y = sy.toInt(&okY);
-    z = sz.toInt(&okZ);
-
-    return okX && okY && okZ;
+    const Vector<int> &p = m_positions[item];
+    x = p.x;
+    y = p.y;
+    z = p.z;
+    return true;
 }
 
 void
 Netlist::setPosition(const QString &itemName, int x, int y, int z)
 {
-    setItemProperty(itemName, "X", QString::number(x));
-    setItemProperty(itemName, "Y", QString::number(y));
-    setItemProperty(itemName, "Z", QString::number(z));
+    int item = itemId(itemName);
+    if (item >= 0) setPosition(item, Vector<int>(x, y, z));
 }
 
 QString
 Netlist::variant(const QString &itemName) const
 {
-    return itemProperty(itemName, "VARIANT");
+    int item = itemId(itemName);
+    if ((item < 0) || m_deleted[item] || (m_variants[item] < 0)) return QString();
+
+    return m_variantNames[m_variants[item]];
 }
 
 void
 Netlist::setVariant(const QString &itemName, const QString &variantName)
 {
-    setItemProperty(itemName, "VARIANT", variantName);
+    int item = itemId(itemName);
+    if (item >= 0) setVariant(item, variantName);
+}
+
+int
+Netlist::itemCount() const
+{
+    return m_itemNames.size();
+}
+
+int
+Netlist::itemId(const QString &itemName) const
+{
+    return m_itemIds.value(itemName, -1);
+}
+
+QString
+Netlist::itemName(int item) const
+{
+    return m_itemNames[item];
+}
+
+bool
+Netlist::isDeleted(int item) const
+{
+    return m_deleted[item];
+}
+
+bool
+Netlist::isPad(int item) const
+{
+    return m_pads[item];
+}
+
+int
+Netlist::itemPinBegin(int item) const
+{
+    return m_itemPointers[item];
+}
+
+int
+Netlist::itemPinEnd(int item) const
+{
+    return m_itemPointers[item + 1];
+}
+
+int
+Netlist::netCount() const
+{
+    return m_netNames.size();
+}
+
+int
+Netlist::netId(const QString &netName) const
+{
+    return m_netIds.value(netName, -1);
+}
+
+QString
+Netlist::netName(int net) const
+{
+    return m_netNames[net];
+}
+
+int
+Netlist::netPinBegin(int net) const
+{
+    return m_netPointers[net];
+}
+
+int
+Netlist::netPinEnd(int net) const
+{
+    return m_netPointers[net + 1];
+}
+
+int
+Netlist::pinCount() const
+{
+    return m_pinItems.size();
+}
+
+int
+Netlist::pinItem(int pin) const
+{
+    return m_pinItems[pin];
+}
+
+int
+Netlist::pinNet(int pin) const
+{
+    return m_pinNets[pin];
+}
+
+QString
+Netlist::pinPort(int pin) const
+{
+    return m_portNames[m_pinPorts[pin]];
+}
+
+int
+Netlist::cellTypeId(int item) const
+{
+    return m_cellTypes[item];
+}
+
+int
+Netlist::cellTypeCount() const
+{
+    return m_cellTypeNames.size();
+}
+
+QString
+Netlist::cellTypeName(int cellType) const
+{
+    return m_cellTypeNames[cellType];
+}
+
+bool
+Netlist::hasPosition(int item) const
+{
+    return m_hasPositions[item];
+}
+
+Vector<int>
+Netlist::position(int item) const
+{
+    return m_positions[item];
+}
+
+void
+Netlist::setPosition(int item, const Vector<int> &position)
+{
+    m_positions[item] = position;
+    m_hasPositions[item] = true;
+}
+
+int
+Netlist::variantId(int item) const
+{
+    return m_variants[item];
+}
+
+QString
+Netlist::variantName(int variant) const
+{
+    return m_variantNames[variant];
+}
+
+void
+Netlist::setVariant(int item, const QString &variantName)
+{
+    m_variants[item] = intern(m_variantNames, m_variantIds, variantName);
 }
 
 Netlist *
@@ -196,6 +620,8 @@ Netlist::readFromFile(const QString &filePath)
         return 0;
     }
 
+    netlist->index();
+
     return netlist.take();
 }
 
@@ -290,7 +716,7 @@ Netlist::parseInstance(QXmlStreamReader &xml)
         return false;
     }
 
-    addItem(instanceName);
+    int item = addItem(instanceName);
 
     while (!(xml.tokenType() == QXmlStreamReader::EndElement && xml.name() == "instance"))
     {
@@ -333,6 +759,27 @@ Netlist::parseInstance(QXmlStreamReader &xml)
             }
         }
     }
+
+    /* Placed netlists keep positions and variants as properties  */
+    QHash<QString, QString> &properties = m_properties[item];
+    if (properties.contains("X") && properties.contains("Y") && properties.contains("Z"))
+    {
+        bool okX, okY, okZ;
+        Vector<int> p(properties.value("X").toInt(&okX), properties.value("Y").toInt(&okY), properties.value("Z").toInt(&okZ));
+        if (okX && okY && okZ)
+        {
+            setPosition(item, p);
+            properties.remove("X");
+            properties.remove("Y");
+            properties.remove("Z");
+        }
+    }
+    if (properties.contains("VARIANT"))
+    {
+        setVariant(item, properties.take("VARIANT"));
+    }
+    if (properties.isEmpty()) m_properties.remove(item);
+
     return true;
 }
 
@@ -3,30 +3,46 @@
 
 #include <QString>
 #include <QList>
-#include <QSet>
-#include <QMap>
+#include <QVector>
+#include <QHash>
 #include <QXmlStreamReader>
-
+#include "vector.h"
+
+/*
+ * Flattened design netlist.
+ *
+ * Items, nets and pins have dense IDs, items and nets are numbered in the
+ * order of their names. Pins of a net and pins of an item (ordered by port
+ * name) are stored in CSR form. Cell type, variant and position are typed
+ * fields, cell types, variants and port names are interned. Other
+ * properties of the file are kept in a side table.
+ *
+ * Deleted items keep their IDs and pins, the name based methods skip them.
+ */
 class Netlist
 {
 public:
+    /*
+     * Warning: this function doesn't delete item from networks
+     */
     void
-    addItem(const QString &itemName);
-
-    void
-    addNet(const QString &netName);
+    deleteItem(const QString &itemName);
 
+public:
+    /*
+     * Editing: gates and connections take effect by name at once, IDs and
+     * the connectivity are rebuilt by commit(), which numbers items and nets
+     * by name again. IDs taken before commit() are invalid after it.
+     */
     void
-    addItemToNet(const QString &netName, const QString &itemName, const QString &portName);
+    addGate(const QString &itemName, const QString &cellType);
 
+    // Moves the port of the item to the net, the net is created if needed
     void
-    setItemType(const QString &itemName, bool isPad);
+    connect(const QString &itemName, const QString &portName, const QString &netName);
 
-    /*
-     * Warning: this function doesn't delete item from networks
-     */
     void
-    deleteItem(const QString &itemName);
+    commit();
 
 public:
     QList<QString>
@@ -42,10 +58,10 @@ public:
     allNets() const;
 
     bool
-    isGate(const QString &itemName);
+    isGate(const QString &itemName) const;
 
     bool
-    isPad(const QString &itemName);
+    isPad(const QString &itemName) const;
 
     QList<QString>
     itemPorts(const QString &itemName) const;
@@ -88,11 +104,116 @@ public:
     void
     setVariant(const QString &itemName, const QString &variantName);
 
+public:
+    // Including deleted items
+    int
+    itemCount() const;
+
+    // -1 if there is no such item
+    int
+    itemId(const QString &itemName) const;
+
+    QString
+    itemName(int item) const;
+
+    bool
+    isDeleted(int item) const;
+
+    bool
+    isPad(int item) const;
+
+    // Pins of the item are [itemPinBegin(item); itemPinEnd(item))
+    int
+    itemPinBegin(int item) const;
+
+    int
+    itemPinEnd(int item) const;
+
+    int
+    netCount() const;
+
+    // -1 if there is no such net
+    int
+    netId(const QString &netName) const;
+
+    QString
+    netName(int net) const;
+
+    // Pins of the net are [netPinBegin(net); netPinEnd(net))
+    int
+    netPinBegin(int net) const;
+
+    int
+    netPinEnd(int net) const;
+
+    int
+    pinCount() const;
+
+    int
+    pinItem(int pin) const;
+
+    int
+    pinNet(int pin) const;
+
+    QString
+    pinPort(int pin) const;
+
+public:
+    // -1 if the item has no cell type
+    int
+    cellTypeId(int item) const;
+
+    int
+    cellTypeCount() const;
+
+    QString
+    cellTypeName(int cellType) const;
+
+    bool
+    hasPosition(int item) const;
+
+    Vector<int>
+    position(int item) const;
+
+    void
+    setPosition(int item, const Vector<int> &position);
+
+    // -1 if the item has no variant
+    int
+    variantId(int item) const;
+
+    QString
+    variantName(int variant) const;
+
+    void
+    setVariant(int item, const QString &variantName);
+
 public:
     static Netlist *
     readFromFile(const QString &filePath);
 
 private:
+    Netlist();
+
+    int
+    addItem(const QString &itemName);
+
+    int
+    addNet(const QString &netName);
+
+    void
+    addItemToNet(const QString &netName, const QString &itemName, const QString &portName);
+
+    void
+    setItemType(const QString &itemName, bool isPad);
+
+    // Renumbers items and nets by name and builds the CSR connectivity
+    void
+    index();
+
+    static int
+    intern(QVector<QString> &names, QHash<QString, int> &ids, const QString &name);
+
     bool
     parseLibrary(QXmlStreamReader &xml);
 
@@ -112,11 +233,35 @@ private:
     parserError(QXmlStreamReader &xml, const char* msg);
 
 private:
-    QSet<QString>       m_padNames;
-    QMap<QString, QList<QPair<QString, QString> > > m_netMap; // netName -> pair<itemName, portName>
-    QMap<QString, QMap<QString, QString> > m_itemNetMap; // itemName -> portName -> netName
-    QMap<QString, QString> m_cellTypes; // itemName -> cellType
-    QMap<QString, QMap<QString, QString> > m_propertyMap; // itemName -> propertyName -> propertyValue
+    QVector<QString> m_itemNames;
+    QHash<QString, int> m_itemIds;
+    QVector<bool> m_pads;
+    QVector<bool> m_deleted;
+    QVector<int> m_cellTypes;
+    QVector<int> m_variants;
+    QVector<Vector<int> > m_positions;
+    QVector<bool> m_hasPositions;
+    QHash<int, QHash<QString, QString> > m_properties; // item -> propertyName -> propertyValue
+
+    QVector<QString> m_netNames;
+    QHash<QString, int> m_netIds;
+
+    QVector<int> m_pinItems;
+    QVector<int> m_pinNets;
+    QVector<int> m_pinPorts;
+
+    // Pins are ordered by net, pins of net n are [m_netPointers[n]; m_netPointers[n + 1])
+    QVector<int> m_netPointers;
+    // Pins of item i are m_itemPins[m_itemPointers[i]; m_itemPointers[i + 1])
+    QVector<int> m_itemPointers;
+    QVector<int> m_itemPins;
+
+    QVector<QString> m_cellTypeNames;
+    QHash<QString, int> m_cellTypeIds;
+    QVector<QString> m_variantNames;
+    QHash<QString, int> m_variantIds;
+    QVector<QString> m_portNames;
+    QHash<QString, int> m_portIds;
 };
 
 #endif // NETLIST_H
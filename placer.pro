@@ -20,24 +20,65 @@ SOURCES += \
     common/netlist.cpp \
     placer/placementjob.cpp \
     placer/qp.cpp \
+    placer/placementdb.cpp \
     placer/coomatrix.cpp \
+    placer/csrmatrix.cpp \
+    placer/preconditioner.cpp \
+    placer/cgsolver.cpp \
+    placer/blockcgsolver.cpp \
+    placer/choleskysolver.cpp \
+    placer/linearsolver.cpp \
+    placer/taskpool.cpp \
+    placer/fmpartitioner.cpp \
     placer/array.cpp \
     placer/legalization.cpp \
+    placer/hpwlengine.cpp \
+    placer/annealer.cpp \
+    placer/variantoptimizer.cpp \
+    placer/poissonsolver.cpp \
+    placer/eplace.cpp \
+    placer/clustering.cpp \
+    placer/congestionmap.cpp \
+    placer/timinganalysis.cpp \
+    placer/buffering.cpp \
+    placer/multistart.cpp \
     common/cellvariant.cpp \
     common/cellvariantlist.cpp \
-    common/cellvariantfile.cpp
+    common/cellvariantfile.cpp \
+    common/celllibrary.cpp
 
 
 HEADERS += \
     common/netlist.h \
     placer/placementjob.h \
     placer/qp.h \
+    placer/placementdb.h \
     placer/placement.h \
     common/vector.h \
     placer/coomatrix.h \
+    placer/csrmatrix.h \
+    placer/preconditioner.h \
+    placer/cgsolver.h \
+    placer/blockcgsolver.h \
+    placer/choleskysolver.h \
+    placer/linearsolver.h \
+    placer/taskpool.h \
+    placer/fmpartitioner.h \
     placer/array.h \
     placer/legalization.h \
+    placer/hpwlengine.h \
+    placer/annealer.h \
+    placer/variantoptimizer.h \
+    placer/poissonsolver.h \
+    placer/eplace.h \
+    placer/clustering.h \
+    placer/congestionmap.h \
+    placer/timinganalysis.h \
+    placer/buffering.h \
+    placer/multistart.h \
+    placer/random.h \
     common/cellvariant.h \
     common/cellvariantlist.h \
-    common/cellvariantfile.h
+    common/cellvariantfile.h \
+    common/celllibrary.h
 
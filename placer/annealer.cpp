@@ -0,0 +1,447 @@
+#include "annealer.h"
+#include "hpwlengine.h"
+#include "taskpool.h"
+#include "random.h"
+#include <QRunnable>
+#include <math.h>
+
+// Initial temperature in standard deviations of random move costs, the start placement is already good
+const double initialTemperatureFactor = 0.1;
+// Annealing stops when the temperature falls below this fraction of the average net cost
+const double exitTemperatureFactor = 0.005;
+const int maxSteps = 200;
+// Fraction of variant moves
+const int variantMovePeriod = 10;
+// Tiles per temperature step, the tile grid doesn't depend on the pool
+const int maxTiles = 16;
+const int minTileSize = 4;
+
+namespace
+{
+
+bool
+accept(int delta, double temperature, Random &random)
+{
+    if (delta <= 0) return true;
+    if (temperature <= 0.0) return false;
+    return random.uniform() < exp(-delta / temperature);
+}
+
+}
+
+class AnnealerTask : public QRunnable
+{
+public:
+    AnnealerTask(Annealer *annealer, const QVector<Annealer::Tile> &tiles, int first, int stride, double temperature,
+                 int rangeLimit, int moves, quint32 seed, QVector<Annealer::Stats> &stats,
+                 QVector<QVector<Annealer::Move> > &accepted)
+        : m_annealer(annealer), m_tiles(tiles), m_first(first), m_stride(stride), m_temperature(temperature),
+          m_rangeLimit(rangeLimit), m_moves(moves), m_seed(seed), m_stats(stats), m_accepted(accepted)
+    {
+    }
+
+    virtual void
+    run()
+    {
+        // Nothing writes the shared engine while the tasks of a colour run
+        HpwlEngine engine(*m_annealer->m_engine);
+        m_annealer->annealTiles(m_tiles, m_first, m_stride, &engine, m_temperature, m_rangeLimit, m_moves, m_seed,
+                                m_stats, m_accepted);
+    }
+
+private:
+    Annealer *m_annealer;
+    const QVector<Annealer::Tile> &m_tiles;
+    int m_first;
+    int m_stride;
+    double m_temperature;
+    int m_rangeLimit;
+    int m_moves;
+    quint32 m_seed;
+    QVector<Annealer::Stats> &m_stats;
+    QVector<QVector<Annealer::Move> > &m_accepted;
+};
+
+Annealer::Annealer(HpwlEngine *engine, const QVector<int> &gates, const Vector<int> &origin, int xBlocks, int zBlocks, int blockSize)
+    : m_engine(engine), m_gates(gates), m_origin(origin),
+      m_xBlocks(xBlocks), m_zBlocks(zBlocks), m_blockSize(blockSize)
+{
+    m_tiers = 1;
+    m_tierPitch = 0;
+    m_effort = 0.5;
+    m_variantMoves = true;
+    m_pool = 0;
+    m_seed = 0;
+}
+
+void
+Annealer::setTiers(int tiers, int pitch)
+{
+    m_tiers = tiers;
+    m_tierPitch = pitch;
+}
+
+void
+Annealer::setEffort(double effort)
+{
+    m_effort = effort;
+}
+
+void
+Annealer::setVariantMoves(bool enabled)
+{
+    m_variantMoves = enabled;
+}
+
+void
+Annealer::setPool(TaskPool *pool)
+{
+    m_pool = pool;
+}
+
+void
+Annealer::setSeed(quint32 seed)
+{
+    m_seed = seed;
+}
+
+int
+Annealer::site(int xi, int zi) const
+{
+    return zi * m_xBlocks + xi;
+}
+
+Vector<int>
+Annealer::sitePosition(int site) const
+{
+    int columns = m_xBlocks * m_zBlocks;
+    int column = site % columns;
+    return m_origin + Vector<int>((column % m_xBlocks) * m_blockSize, (site / columns) * m_tierPitch,
+                                  (column / m_xBlocks) * m_blockSize);
+}
+
+bool
+Annealer::initSites()
+{
+    m_siteGates.fill(-1, m_xBlocks * m_zBlocks * m_tiers);
+    m_gateSites.fill(-1, m_gates.size());
+
+    for (int g = 0; g < m_gates.size(); g++)
+    {
+        Vector<int> d = m_engine->position(m_gates[g]) - m_origin;
+        int xi = d.x / m_blockSize;
+        int zi = d.z / m_blockSize;
+        int tier = (m_tierPitch > 0) ? d.y / m_tierPitch : d.y;
+        int s = tier * m_xBlocks * m_zBlocks + site(xi, zi);
+        if ((d.y < 0) || (d.x < 0) || (d.z < 0) || (tier * m_tierPitch != d.y) || (tier >= m_tiers) ||
+            (d.x % m_blockSize != 0) || (d.z % m_blockSize != 0) ||
+            (xi >= m_xBlocks) || (zi >= m_zBlocks) || (m_siteGates[s] >= 0))
+        {
+            qWarning("Gate %s is not on a free site", qPrintable(m_engine->itemName(m_gates[g])));
+            return false;
+        }
+
+        m_siteGates[s] = g;
+        m_gateSites[g] = s;
+    }
+    return true;
+}
+
+/*
+ * Standard deviation of the costs of random moves over the whole grid,
+ * nothing is applied.
+ */
+double
+Annealer::initialTemperature()
+{
+    Random random(mixSeed(m_gates.size(), 2 * m_seed));
+
+    int samples = qMin(m_gates.size(), 10000);
+    double sum = 0.0;
+    double squares = 0.0;
+    for (int i = 0; i < samples; i++)
+    {
+        int g = random.bounded(m_gates.size());
+        int target = random.bounded(m_siteGates.size());
+        if (target == m_gateSites[g]) continue;
+
+        int other = m_siteGates[target];
+        int delta = (other >= 0) ? m_engine->swapDelta(m_gates[g], m_gates[other])
+                                 : m_engine->moveDelta(m_gates[g], sitePosition(target));
+        sum += delta;
+        squares += double(delta) * delta;
+    }
+
+    double mean = sum / samples;
+    return initialTemperatureFactor * sqrt(qMax(0.0, squares / samples - mean * mean));
+}
+
+/*
+ * Moves stay inside the tile, so tiles of a colour never touch the same
+ * gates or sites. The accepted moves are recorded for applyMove() and
+ * revertMove().
+ */
+void
+Annealer::annealTile(const Tile &tile, HpwlEngine *engine, double temperature, int rangeLimit, int moves, quint32 seed,
+                     Stats &stats, QVector<Move> &accepted)
+{
+    Random random(seed);
+    stats.moves = 0;
+    stats.accepted = 0;
+
+    if (tile.gates.isEmpty()) return;
+
+    for (int i = 0; i < moves; i++)
+    {
+        stats.moves++;
+
+        int g = tile.gates[random.bounded(tile.gates.size())];
+        int item = m_gates[g];
+
+        int variants = engine->variantCount(item);
+        if (m_variantMoves && (variants > 1) && (random.bounded(variantMovePeriod) == 0))
+        {
+            int v = random.bounded(variants - 1);
+            if (v >= engine->variant(item)) v++;
+
+            int delta = engine->variantDelta(item, v);
+            if (!accept(delta, temperature, random)) continue;
+
+            Move move = {item, -1, Vector<int>(), Vector<int>(), v, engine->variant(item)};
+            accepted.append(move);
+            engine->setVariant(item, v);
+
+            stats.accepted++;
+            continue;
+        }
+
+        int s = m_gateSites[g];
+        int column = s % (m_xBlocks * m_zBlocks);
+        int xi = column % m_xBlocks;
+        int zi = column / m_xBlocks;
+        int x0 = qMax(tile.x0, xi - rangeLimit);
+        int x1 = qMin(tile.x1 - 1, xi + rangeLimit);
+        int z0 = qMax(tile.z0, zi - rangeLimit);
+        int z1 = qMin(tile.z1 - 1, zi + rangeLimit);
+        int target = site(x0 + random.bounded(x1 - x0 + 1), z0 + random.bounded(z1 - z0 + 1));
+        if (m_tiers > 1) target += random.bounded(m_tiers) * m_xBlocks * m_zBlocks;
+        if (target == s) continue;
+
+        int other = m_siteGates[target];
+        Vector<int> targetPosition = sitePosition(target);
+
+        int delta;
+        if (other >= 0)
+        {
+            delta = engine->swapDelta(item, m_gates[other]);
+        }
+        else
+        {
+            delta = engine->moveDelta(item, targetPosition);
+        }
+
+        if (!accept(delta, temperature, random)) continue;
+
+        if (other >= 0)
+        {
+            engine->swap(item, m_gates[other]);
+        }
+        else
+        {
+            engine->move(item, targetPosition);
+        }
+        Move move = {item, (other >= 0) ? m_gates[other] : -1, targetPosition, sitePosition(s), -1, -1};
+        accepted.append(move);
+
+        m_siteGates[s] = other;
+        m_siteGates[target] = g;
+        m_gateSites[g] = target;
+        if (other >= 0) m_gateSites[other] = s;
+
+        stats.accepted++;
+    }
+}
+
+void
+Annealer::applyMove(HpwlEngine *engine, const Move &move)
+{
+    if (move.variant >= 0)
+    {
+        engine->setVariant(move.item, move.variant);
+    }
+    else if (move.other >= 0)
+    {
+        engine->swap(move.item, move.other);
+    }
+    else
+    {
+        engine->move(move.item, move.position);
+    }
+}
+
+void
+Annealer::revertMove(HpwlEngine *engine, const Move &move)
+{
+    if (move.variant >= 0)
+    {
+        engine->setVariant(move.item, move.oldVariant);
+    }
+    else if (move.other >= 0)
+    {
+        engine->swap(move.item, move.other);
+    }
+    else
+    {
+        engine->move(move.item, move.oldPosition);
+    }
+}
+
+/*
+ * Anneals tiles first, first + stride, ... Every tile starts from the
+ * engine state of the colour start, so its moves are reverted afterwards.
+ * Tiles get moves in proportion to their gates.
+ */
+void
+Annealer::annealTiles(const QVector<Tile> &tiles, int first, int stride, HpwlEngine *engine, double temperature,
+                      int rangeLimit, int moves, quint32 seed, QVector<Stats> &stats, QVector<QVector<Move> > &accepted)
+{
+    for (int i = first; i < tiles.size(); i += stride)
+    {
+        int tileMoves = qint64(moves) * tiles[i].gates.size() / m_gates.size();
+        annealTile(tiles[i], engine, temperature, rangeLimit, tileMoves, mixSeed(seed, i), stats[i], accepted[i]);
+        for (int m = accepted[i].size() - 1; m >= 0; m--)
+        {
+            revertMove(engine, accepted[i][m]);
+        }
+    }
+}
+
+/*
+ * The tile grid follows from the grid size and is shifted randomly every
+ * step. Tiles of one checkerboard colour are independent, the pool only
+ * spreads them over the threads. Their moves are applied in tile order,
+ * so the result doesn't depend on the pool or the timing of the threads.
+ */
+Annealer::Stats
+Annealer::runStep(double temperature, int rangeLimit, int moves, quint32 seed)
+{
+    Stats total;
+    total.moves = 0;
+    total.accepted = 0;
+
+    int size = qMax(minTileSize, int(ceil(sqrt(double(m_xBlocks) * m_zBlocks / maxTiles))));
+
+    Random random(seed);
+    int xOffset = random.bounded(size);
+    int zOffset = random.bounded(size);
+
+    QVector<Tile> tiles[2];
+    for (int z0 = -zOffset, tz = 0; z0 < m_zBlocks; z0 += size, tz++)
+    {
+        for (int x0 = -xOffset, tx = 0; x0 < m_xBlocks; x0 += size, tx++)
+        {
+            Tile tile;
+            tile.x0 = qMax(0, x0);
+            tile.z0 = qMax(0, z0);
+            tile.x1 = qMin(m_xBlocks, x0 + size);
+            tile.z1 = qMin(m_zBlocks, z0 + size);
+            for (int tier = 0; tier < m_tiers; tier++)
+            {
+                for (int zi = tile.z0; zi < tile.z1; zi++)
+                {
+                    for (int xi = tile.x0; xi < tile.x1; xi++)
+                    {
+                        int g = m_siteGates[tier * m_xBlocks * m_zBlocks + site(xi, zi)];
+                        if (g >= 0) tile.gates.append(g);
+                    }
+                }
+            }
+            if (!tile.gates.isEmpty()) tiles[(tx + tz) % 2].append(tile);
+        }
+    }
+
+    for (int colour = 0; colour < 2; colour++)
+    {
+        int count = tiles[colour].size();
+        QVector<Stats> stats(count);
+        QVector<QVector<Move> > accepted(count);
+        quint32 colourSeed = mixSeed(seed, colour + 1);
+        if (m_pool == 0)
+        {
+            annealTiles(tiles[colour], 0, 1, m_engine, temperature, rangeLimit, moves, colourSeed, stats, accepted);
+        }
+        else
+        {
+            TaskGroup group(m_pool);
+            for (int t = 0; t < qMin(count, m_pool->threadCount()); t++)
+            {
+                group.run(new AnnealerTask(this, tiles[colour], t, m_pool->threadCount(), temperature, rangeLimit, moves,
+                                          colourSeed, stats, accepted));
+            }
+            group.wait();
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            foreach (const Move &move, accepted[i])
+            {
+                applyMove(m_engine, move);
+            }
+            total.moves += stats[i].moves;
+            total.accepted += stats[i].accepted;
+        }
+    }
+
+    return total;
+}
+
+/*
+ * Adaptive schedule of VPR: the temperature drops slowly while about half
+ * of the moves are accepted, the range limit keeps the acceptance rate
+ * near 0.44. The last step is a greedy quench.
+ */
+bool
+Annealer::run()
+{
+    if (!initSites()) return false;
+    if ((m_gates.size() < 2) || (m_effort <= 0.0)) return true;
+
+    int movesPerStep = qMax(1, int(m_effort * pow(double(m_gates.size()), 4.0 / 3.0)));
+    int maxRange = qMax(m_xBlocks, m_zBlocks);
+    double rangeLimit = maxRange;
+    double temperature = initialTemperature();
+    int initialHpwl = m_engine->hpwl();
+
+    int step = 0;
+    for (; step < maxSteps; step++)
+    {
+        double exitTemperature = exitTemperatureFactor * m_engine->hpwl() / qMax(1, m_engine->netCount());
+        if (temperature < exitTemperature) break;
+
+        Stats stats = runStep(temperature, qRound(rangeLimit), movesPerStep, mixSeed(step, 2 * m_seed + 1));
+        double rate = double(stats.accepted) / qMax(1, stats.moves);
+
+        if (rate > 0.96)
+        {
+            temperature *= 0.5;
+        }
+        else if (rate > 0.8)
+        {
+            temperature *= 0.9;
+        }
+        else if (rate > 0.15)
+        {
+            temperature *= 0.95;
+        }
+        else
+        {
+            temperature *= 0.8;
+        }
+        rangeLimit = qBound(1.0, rangeLimit * (1.0 - 0.44 + rate), double(maxRange));
+    }
+
+    runStep(0.0, qRound(rangeLimit), movesPerStep, mixSeed(step, 2 * m_seed + 1));
+
+    qDebug("Annealing: %d steps, HPWL %d -> %d", step + 1, initialHpwl, m_engine->hpwl());
+    return true;
+}
@@ -0,0 +1,132 @@
+#ifndef ANNEALER_H
+#define ANNEALER_H
+
+#include <QVector>
+#include "common/vector.h"
+
+class HpwlEngine;
+class TaskPool;
+class AnnealerTask;
+
+/*
+ * Simulated annealing detailed placer.
+ *
+ * Gates sit on the legalization sites, a move either swaps a gate with the
+ * gate of another site (or moves it to the free site) within the range
+ * limit, or changes the variant of the gate. Cost is the HPWL of the engine.
+ * Stacked sites of a column are on tiers pitch blocks apart, moves take any tier.
+ *
+ * The schedule is adaptive: the initial temperature follows from the spread
+ * of the cost changes of random moves, the cooling rate and the range limit
+ * follow the acceptance rate.
+ *
+ * The grid is cut into tiles, tiles of the same checkerboard colour are
+ * annealed independently, at the same time with a pool. Tiles never share
+ * gates or sites, every tile sees the other tiles as they were when the
+ * colour started, then the accepted moves are applied to the engine in
+ * tile order. Tile borders move every temperature step.
+ */
+class Annealer
+{
+public:
+    // Gates are engine items, sites are blockSize x blockSize squares from origin
+    Annealer(HpwlEngine *engine, const QVector<int> &gates, const Vector<int> &origin, int xBlocks, int zBlocks, int blockSize);
+
+    // Every (x, z) site has one more site pitch blocks above it on each further tier
+    void
+    setTiers(int tiers, int pitch);
+
+    // Moves per temperature step are effort * gates^(4/3)
+    void
+    setEffort(double effort);
+
+    void
+    setVariantMoves(bool enabled);
+
+    // 0: sequential
+    void
+    setPool(TaskPool *pool);
+
+    // Runs with the same seed and gates give the same placement, with or without a pool
+    void
+    setSeed(quint32 seed);
+
+    // Returns false if gates are not on sites
+    bool
+    run();
+
+private:
+    struct Tile
+    {
+        int x0, z0, x1, z1;   // Sites [x0; x1) x [z0; z1)
+        QVector<int> gates;
+    };
+
+    struct Stats
+    {
+        int moves;
+        int accepted;
+    };
+
+    // Accepted move of a tile
+    struct Move
+    {
+        int item;
+        int other;              // Swapped item, -1 if none
+        Vector<int> position;   // Target of a move without a swap
+        Vector<int> oldPosition;
+        int variant;            // New variant, -1 if the position changes
+        int oldVariant;
+    };
+
+    bool
+    initSites();
+
+    double
+    initialTemperature();
+
+    Stats
+    runStep(double temperature, int rangeLimit, int moves, quint32 seed);
+
+    void
+    annealTile(const Tile &tile, HpwlEngine *engine, double temperature, int rangeLimit, int moves, quint32 seed,
+               Stats &stats, QVector<Move> &accepted);
+
+    void
+    annealTiles(const QVector<Tile> &tiles, int first, int stride, HpwlEngine *engine, double temperature,
+                int rangeLimit, int moves, quint32 seed, QVector<Stats> &stats, QVector<QVector<Move> > &accepted);
+
+    void
+    applyMove(HpwlEngine *engine, const Move &move);
+
+    void
+    revertMove(HpwlEngine *engine, const Move &move);
+
+    // Site of tier 0
+    int
+    site(int xi, int zi) const;
+
+    Vector<int>
+    sitePosition(int site) const;
+
+private:
+    HpwlEngine *m_engine;
+    QVector<int> m_gates;
+    Vector<int> m_origin;
+    int m_xBlocks, m_zBlocks;
+    int m_blockSize;
+    int m_tiers;
+    int m_tierPitch;
+
+    double m_effort;
+    bool m_variantMoves;
+    TaskPool *m_pool;
+    quint32 m_seed;
+
+    QVector<int> m_siteGates; // site -> gate, -1 if free
+    QVector<int> m_gateSites; // index in m_gates -> site
+
+    friend class AnnealerTask;
+};
+
+#endif // ANNEALER_H
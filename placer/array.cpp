@@ -1,12 +1,86 @@
 #include "array.h"
+#include <string.h>
 
-Array::Array() : QVector<double>()
+enum
 {
-    //
+    ArrayAlignment = 32 // AVX
+};
+
+Array::Array()
+{
+    m_data = 0;
+    m_size = 0;
+    m_capacity = 0;
+}
+
+Array::Array(int size)
+{
+    m_data = 0;
+    m_size = 0;
+    m_capacity = 0;
+    resize(size);
+}
+
+Array::Array(const Array &other)
+{
+    m_data = 0;
+    m_size = 0;
+    m_capacity = 0;
+    *this = other;
+}
+
+Array::~Array()
+{
+    qFreeAligned(m_data);
+}
+
+Array& Array::operator=(const Array &other)
+{
+    if (&other == this) return *this;
+
+    if (other.m_size > m_capacity)
+    {
+        qFreeAligned(m_data);
+        m_data = static_cast<double *>(qMallocAligned(other.m_size * sizeof(double), ArrayAlignment));
+        Q_CHECK_PTR(m_data);
+        m_capacity = other.m_size;
+    }
+    m_size = other.m_size;
+    if (m_size > 0)
+    {
+        memcpy(m_data, other.m_data, m_size * sizeof(double));
+    }
+    return *this;
 }
 
-Array::Array(int size) : QVector<double>(size, 0.0)
+void Array::resize(int size)
 {
+    if (size > m_capacity)
+    {
+        m_data = static_cast<double *>(qReallocAligned(m_data, size * sizeof(double), m_capacity * sizeof(double), ArrayAlignment));
+        Q_CHECK_PTR(m_data);
+        m_capacity = size;
+    }
+    if (size > m_size)
+    {
+        memset(m_data + m_size, 0, (size - m_size) * sizeof(double));
+    }
+    m_size = size;
+}
+
+void Array::fill(double value)
+{
+    for (int i = 0; i < m_size; i++)
+    {
+        m_data[i] = value;
+    }
+}
+
+void Array::swap(Array &other)
+{
+    qSwap(m_data, other.m_data);
+    qSwap(m_size, other.m_size);
+    qSwap(m_capacity, other.m_capacity);
 }
 
 Array Array::operator*(double v) const
@@ -23,24 +97,14 @@ Array Array::operator*(double v) const
 
 Array& Array::operator+=(const Array &v)
 {
-    Q_ASSERT(size() == v.size());
-
-    for (int i = 0; i < size(); i++)
-    {
-        (*this)[i] += v[i];
-    }
+    axpy(1.0, v, *this);
     return *this;
 }
 
 
 Array& Array::operator-=(const Array &v)
 {
-    Q_ASSERT(size() == v.size());
-
-    for (int i = 0; i < size(); i++)
-    {
-        (*this)[i] -= v[i];
-    }
+    axpy(-1.0, v, *this);
     return *this;
 }
 
@@ -67,15 +131,92 @@ Array operator-(const Array &v1, const Array &v2)
     return result;
 }
 
-
+/*
+ * Reductions use four partial sums, so they vectorize without
+ * reassociating floating point additions (no -ffast-math needed).
+ */
 double dot(const Array &v1, const Array &v2)
 {
     Q_ASSERT(v1.size() == v2.size());
 
-    double sum = 0.0;
-    for (int i = 0; i < v1.size(); i++)
+    const double *a = v1.constData();
+    const double *b = v2.constData();
+    int n = v1.size();
+
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; i++)
+    {
+        s0 += a[i] * b[i];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+void axpy(double a, const Array &x, Array &y)
+{
+    Q_ASSERT(x.size() == y.size());
+
+    const double *px = x.constData();
+    double *py = y.data();
+    int n = x.size();
+
+    for (int i = 0; i < n; i++)
+    {
+        py[i] += a * px[i];
+    }
+}
+
+void xpby(const Array &x, double b, Array &y)
+{
+    Q_ASSERT(x.size() == y.size());
+
+    const double *px = x.constData();
+    double *py = y.data();
+    int n = x.size();
+
+    for (int i = 0; i < n; i++)
+    {
+        py[i] = px[i] + b * py[i];
+    }
+}
+
+double axpyNorm(double a, const Array &x, Array &y)
+{
+    Q_ASSERT(x.size() == y.size());
+
+    const double *px = x.constData();
+    double *py = y.data();
+    int n = x.size();
+
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        double y0 = py[i] + a * px[i];
+        double y1 = py[i + 1] + a * px[i + 1];
+        double y2 = py[i + 2] + a * px[i + 2];
+        double y3 = py[i + 3] + a * px[i + 3];
+        py[i] = y0;
+        py[i + 1] = y1;
+        py[i + 2] = y2;
+        py[i + 3] = y3;
+        s0 += y0 * y0;
+        s1 += y1 * y1;
+        s2 += y2 * y2;
+        s3 += y3 * y3;
+    }
+    for (; i < n; i++)
     {
-        sum += v1[i] * v2[i];
+        double yi = py[i] + a * px[i];
+        py[i] = yi;
+        s0 += yi * yi;
     }
-    return sum;
+    return (s0 + s1) + (s2 + s3);
 }
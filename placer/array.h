@@ -1,22 +1,111 @@
 #ifndef ARRAY_H
 #define ARRAY_H
 
-#include <QVector>
+#include <QtGlobal>
 
-class Array : public QVector<double>
+/*
+ * Vector of doubles for the solvers.
+ * Storage is aligned for SIMD loads. Copying into an array of the same size
+ * and resizing to a smaller size reuse the buffer, so solver loops built on
+ * the in-place kernels below don't allocate.
+ */
+class Array
 {
 public:
     Array();
     Array(int size);
+    Array(const Array &other);
+    ~Array();
 
+    Array& operator=(const Array &other);
+
+    int size() const;
+    bool isEmpty() const;
+
+    // New elements are zero
+    void resize(int size);
+    void fill(double value);
+
+    double *data();
+    const double *data() const;
+    const double *constData() const;
+
+    double &operator[](int i);
+    const double &operator[](int i) const;
+    double at(int i) const;
+
+    void swap(Array &other);
+
+    // Convenience operators, these allocate
     Array operator*(double v) const;
     Array& operator+=(const Array &v);
     Array& operator-=(const Array &v);
     Array& operator*=(double v);
+
+private:
+    double *m_data;
+    int     m_size;
+    int     m_capacity;
 };
 
 Array operator-(const Array &v1, const Array &v2);
 
 double dot(const Array &v1, const Array &v2);
 
+/*
+ * In-place kernels. Loops are written so that the compiler can vectorize them.
+ */
+
+// y += a * x
+void axpy(double a, const Array &x, Array &y);
+
+// y = x + b * y
+void xpby(const Array &x, double b, Array &y);
+
+// y += a * x, returns the new y * y
+double axpyNorm(double a, const Array &x, Array &y);
+
+inline int Array::size() const
+{
+    return m_size;
+}
+
+inline bool Array::isEmpty() const
+{
+    return m_size == 0;
+}
+
+inline double *Array::data()
+{
+    return m_data;
+}
+
+inline const double *Array::data() const
+{
+    return m_data;
+}
+
+inline const double *Array::constData() const
+{
+    return m_data;
+}
+
+inline double &Array::operator[](int i)
+{
+    Q_ASSERT((i >= 0) && (i < m_size));
+    return m_data[i];
+}
+
+inline const double &Array::operator[](int i) const
+{
+    Q_ASSERT((i >= 0) && (i < m_size));
+    return m_data[i];
+}
+
+inline double Array::at(int i) const
+{
+    Q_ASSERT((i >= 0) && (i < m_size));
+    return m_data[i];
+}
+
 #endif // ARRAY_H
@@ -0,0 +1,109 @@
+#include "blockcgsolver.h"
+#include "csrmatrix.h"
+#include <math.h>
+
+BlockCgSolver::BlockCgSolver(const CsrMatrix &matrix, Preconditioner::Type preconditionerType)
+    : CgSolver(matrix, preconditionerType)
+{
+}
+
+void
+BlockCgSolver::solve(const Array &b1, const Array &b2, Array &x1, Array &x2)
+{
+    Q_ASSERT(b1.size() == m_matrix.n());
+    Q_ASSERT(b2.size() == m_matrix.n());
+
+    int n = m_matrix.n();
+
+    const Array *b[2] = {&b1, &b2};
+    Array *x[2] = {&x1, &x2};
+    double rz[2], bnorm[2], residual[2];
+    bool active[2];
+
+    /* All buffers are allocated here, the iterations work in place.  */
+    Array r[2] = {Array(n), Array(n)};
+    Array z[2] = {Array(n), Array(n)};
+    Array p[2] = {Array(n), Array(n)};
+    Array Ap[2] = {Array(n), Array(n)};
+
+    for (int c = 0; c < 2; c++)
+    {
+        bnorm[c] = sqrt(dot(*b[c], *b[c]));
+        if (bnorm[c] == 0.0)
+        {
+            x[c]->resize(n);
+            x[c]->fill(0.0);
+            bnorm[c] = 1.0;
+        }
+        else if (x[c]->size() == n)
+        {
+            // r = b - Ax
+            m_matrix.matvec(*x[c], r[c]);
+            xpby(*b[c], -1.0, r[c]);
+        }
+        else
+        {
+            x[c]->resize(n);
+            x[c]->fill(0.0);
+            r[c] = *b[c];
+        }
+        residual[c] = sqrt(dot(r[c], r[c])) / bnorm[c];
+        active[c] = (residual[c] > m_tolerance);
+
+        if (active[c])
+        {
+            m_preconditioner->apply(r[c], z[c]);
+            p[c] = z[c];
+            rz[c] = dot(r[c], z[c]);
+        }
+    }
+
+    int i;
+    for (i = 0; (i < m_maxIterations) && (active[0] || active[1]); i++)
+    {
+        m_matrix.matvec(p[0], p[1], Ap[0], Ap[1]);
+
+        for (int c = 0; c < 2; c++)
+        {
+            if (!active[c]) continue;
+
+            double pAp = dot(p[c], Ap[c]);
+            if (pAp <= 0.0)
+            {
+                active[c] = false;
+                continue;
+            }
+
+            double alpha = rz[c] / pAp;
+
+            axpy(alpha, p[c], *x[c]);
+            double rr = axpyNorm(-alpha, Ap[c], r[c]);
+
+            residual[c] = sqrt(rr) / bnorm[c];
+            if (residual[c] <= m_tolerance)
+            {
+                active[c] = false;
+
+                /* Frozen direction, keeps matvec() result unused.  */
+                p[c].fill(0.0);
+                continue;
+            }
+
+            m_preconditioner->apply(r[c], z[c]);
+            double rzNew = dot(r[c], z[c]);
+
+            // p = z + beta p
+            xpby(z[c], rzNew / rz[c], p[c]);
+
+            rz[c] = rzNew;
+        }
+    }
+
+    m_iterations = i;
+    m_relativeResidual = qMax(residual[0], residual[1]);
+
+    if (active[0] || active[1])
+    {
+        qWarning("BlockCgSolver::solve(): reaches maximum iteration (relative residual %g).", m_relativeResidual);
+    }
+}
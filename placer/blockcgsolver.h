@@ -0,0 +1,23 @@
+#ifndef BLOCKCGSOLVER_H
+#define BLOCKCGSOLVER_H
+
+#include "cgsolver.h"
+
+/*
+ * Conjugate gradient for two right-hand sides at once.
+ * Both systems share every matrix-vector product, so the matrix is read once
+ * per iteration. Step sizes are computed separately for each system; a system
+ * which has converged is frozen while the other one continues.
+ */
+class BlockCgSolver : public CgSolver
+{
+public:
+    BlockCgSolver(const CsrMatrix &matrix, Preconditioner::Type preconditionerType);
+
+    using CgSolver::solve;
+
+    virtual void
+    solve(const Array &b1, const Array &b2, Array &x1, Array &x2);
+};
+
+#endif // BLOCKCGSOLVER_H
@@ -0,0 +1,443 @@
+#include "buffering.h"
+#include <QPointF>
+#include <QRectF>
+#include <QScopedPointer>
+#include <algorithm>
+#include <float.h>
+#include <limits.h>
+#include "common/netlist.h"
+#include "common/celllibrary.h"
+#include "placementjob.h"
+#include "timinganalysis.h"
+#include "legalization.h"
+
+// Clustering rounds of a net, every round adds a level to its tree
+const int maxBufferRounds = 32;
+
+/*
+ * Sink of a net or of a buffer: the input pin of a gate, a pad or a buffer.
+ * Slack is the slack the node would have with a wire of no delay.
+ */
+typedef struct {
+    QString item;
+    QString port;
+    QPointF position;
+    int slack;
+    bool buffer;
+} BufferNode;
+
+/*
+ * Input of a buffer or a sink moved to a new net
+ */
+typedef struct {
+    QString item;
+    QString port;
+    QString net;
+} BufferPin;
+
+typedef struct {
+    Netlist *netlist;
+    NetPlacement *placement;
+
+    QString cell;
+    QString input;
+    QString output;
+    int delay;
+
+    int maxFanout;
+    double maxLength;
+    int maxWireLength;
+    int repeaterDelay;
+
+    // Legalization sites left for buffers
+    int capacity;
+    int count;
+} BufferData;
+
+/*
+ * Buffer tree of a net, the netlist changes once it is chosen and fits
+ */
+typedef struct {
+    QList<BufferNode> buffers;
+    QList<BufferPin> pins;
+    int slack;    // Worst slack of the sinks of the net
+} BufferTree;
+
+struct NodeOrder
+{
+    NodeOrder(bool xAxis)
+        : m_xAxis(xAxis)
+    {
+    }
+
+    bool operator()(const BufferNode &a, const BufferNode &b) const
+    {
+        return m_xAxis ? (a.position.x() < b.position.x()) : (a.position.y() < b.position.y());
+    }
+
+    bool m_xAxis;
+};
+
+bool
+slackOrder(const BufferNode &a, const BufferNode &b)
+{
+    return a.slack < b.slack;
+}
+
+struct SlackOrder
+{
+    SlackOrder(const QList<int> &slacks)
+        : m_slacks(slacks)
+    {
+    }
+
+    bool operator()(int a, int b) const
+    {
+        return m_slacks[a] < m_slacks[b];
+    }
+
+    const QList<int> &m_slacks;
+};
+
+double
+distance(const QPointF &a, const QPointF &b)
+{
+    return qAbs(a.x() - b.x()) + qAbs(a.y() - b.y());
+}
+
+// Repeaters of the timing analysis on a wire
+int
+wireDelay(const BufferData &data, const QPointF &a, const QPointF &b)
+{
+    return data.repeaterDelay * int(distance(a, b) / data.maxWireLength);
+}
+
+int
+worstSlack(const QVector<BufferNode> &nodes, const QPointF &source, const BufferData &data)
+{
+    int slack = INT_MAX;
+    foreach (const BufferNode &node, nodes)
+    {
+        slack = qMin(slack, node.slack - wireDelay(data, source, node.position));
+    }
+    return slack;
+}
+
+QRectF
+boundingBox(const QVector<BufferNode> &nodes, int begin, int end)
+{
+    double minX = nodes[begin].position.x(), maxX = minX;
+    double minY = nodes[begin].position.y(), maxY = minY;
+    for (int i = begin + 1; i < end; i++)
+    {
+        minX = qMin(minX, nodes[i].position.x());
+        maxX = qMax(maxX, nodes[i].position.x());
+        minY = qMin(minY, nodes[i].position.y());
+        maxY = qMax(maxY, nodes[i].position.y());
+    }
+    return QRectF(minX, minY, maxX - minX, maxY - minY);
+}
+
+/*
+ * Median bisection of nodes[begin; end) until every group has at most
+ * maxFanout nodes within a box of half-perimeter maxLength.
+ * bounds gets the end of every group.
+ */
+void
+splitGroups(QVector<BufferNode> &nodes, int begin, int end, const BufferData &data, QVector<int> &bounds)
+{
+    QRectF box = boundingBox(nodes, begin, end);
+    if ((end - begin <= data.maxFanout) && (box.width() + box.height() <= data.maxLength))
+    {
+        bounds.append(end);
+        return;
+    }
+
+    std::stable_sort(nodes.begin() + begin, nodes.begin() + end, NodeOrder(box.width() >= box.height()));
+
+    int middle = (begin + end) / 2;
+    splitGroups(nodes, begin, middle, data, bounds);
+    splitGroups(nodes, middle, end, data, bounds);
+}
+
+/*
+ * The center of the box reaches the whole group, moving it towards the
+ * source by t shortens the source wire by t and lengthens the others by at most t.
+ */
+QPointF
+bufferPosition(const QVector<BufferNode> &nodes, int begin, int end, const QPointF &source, const BufferData &data)
+{
+    QRectF box = boundingBox(nodes, begin, end);
+    QPointF center = box.center();
+
+    double reach = 0.0;
+    for (int i = begin; i < end; i++)
+    {
+        reach = qMax(reach, distance(center, nodes[i].position));
+    }
+
+    double length = distance(center, source);
+    if (length <= 0.0) return center;
+
+    double t = qBound(0.0, (data.maxLength - reach) / length, 1.0);
+    return center + (source - center) * t;
+}
+
+BufferNode
+addBuffer(BufferTree &tree, const BufferData &data, const QString &netName, const QVector<BufferNode> &nodes,
+          int begin, int end, const QPointF &position)
+{
+    BufferNode buffer;
+    buffer.item = QString("%1$buf%2").arg(netName).arg(data.count + tree.buffers.size());
+    buffer.port = data.input;
+    buffer.position = position;
+    buffer.slack = INT_MAX;
+    buffer.buffer = true;
+
+    BufferPin output = {buffer.item, data.output, buffer.item};
+    tree.pins.append(output);
+    for (int i = begin; i < end; i++)
+    {
+        BufferPin sink = {nodes[i].item, nodes[i].port, buffer.item};
+        tree.pins.append(sink);
+        buffer.slack = qMin(buffer.slack, nodes[i].slack - wireDelay(data, position, nodes[i].position));
+    }
+    buffer.slack -= data.delay;
+
+    tree.buffers.append(buffer);
+    return buffer;
+}
+
+bool
+fitsNet(const QVector<BufferNode> &nodes, const QPointF &source, const BufferData &data)
+{
+    if (nodes.size() > data.maxFanout) return false;
+
+    foreach (const BufferNode &node, nodes)
+    {
+        if (distance(source, node.position) > data.maxLength) return false;
+    }
+    return true;
+}
+
+/*
+ * Returns false if the net can't be buffered within maxBufferRounds
+ */
+bool
+buildTree(BufferTree &tree, const BufferData &data, const QString &netName, const QPointF &source, QVector<BufferNode> nodes)
+{
+    int round = 0;
+    while (!fitsNet(nodes, source, data))
+    {
+        if (round++ == maxBufferRounds)
+        {
+            qWarning("Can't buffer net %s", qPrintable(netName));
+            return false;
+        }
+
+        /* Most critical sinks in range keep the direct connection  */
+        std::stable_sort(nodes.begin(), nodes.end(), slackOrder);
+        int direct = (nodes.size() > data.maxFanout) ? data.maxFanout / 2 : data.maxFanout;
+
+        QVector<BufferNode> next;
+        QVector<BufferNode> rest;
+        foreach (const BufferNode &node, nodes)
+        {
+            if ((next.size() < direct) && (distance(source, node.position) <= data.maxLength))
+            {
+                next.append(node);
+            }
+            else
+            {
+                rest.append(node);
+            }
+        }
+
+        QVector<int> bounds;
+        if (!rest.isEmpty()) splitGroups(rest, 0, rest.size(), data, bounds);
+
+        int begin = 0;
+        foreach (int end, bounds)
+        {
+            /* Lone sinks in range stay on the net while it has room, otherwise the round makes no progress  */
+            if ((end - begin == 1) && (next.size() < data.maxFanout) &&
+                (distance(source, rest[begin].position) <= data.maxLength))
+            {
+                next.append(rest[begin]);
+            }
+            else
+            {
+                QPointF position = bufferPosition(rest, begin, end, source, data);
+                next.append(addBuffer(tree, data, netName, rest, begin, end, position));
+            }
+            begin = end;
+        }
+        nodes = next;
+    }
+
+    foreach (const BufferNode &node, nodes)
+    {
+        BufferPin pin = {node.item, node.port, netName};
+        if (node.buffer) tree.pins.append(pin);
+    }
+    tree.slack = worstSlack(nodes, source, data);
+
+    return true;
+}
+
+/*
+ * The tree within the signal range has to beat the direct wire, or the
+ * tree that only splits the fanout if the net has too many sinks. Returns
+ * false if the chosen tree can't be built or doesn't fit into the sites
+ * left, the netlist stays as it is then.
+ */
+bool
+bufferNet(BufferData &data, const QString &netName, const QPointF &source, const QVector<BufferNode> &nodes)
+{
+    BufferTree tree;
+    if (!buildTree(tree, data, netName, source, nodes)) return false;
+
+    BufferData fanoutData = data;
+    fanoutData.maxLength = DBL_MAX;
+    BufferTree fanoutTree;
+    if (!buildTree(fanoutTree, fanoutData, netName, source, nodes)) return false;
+    if (fanoutTree.slack >= tree.slack) tree = fanoutTree;
+
+    if (data.count + tree.buffers.size() > data.capacity) return false;
+
+    foreach (const BufferNode &buffer, tree.buffers)
+    {
+        data.netlist->addGate(buffer.item, data.cell);
+        (*data.placement)[buffer.item] = GatePlacement(buffer.position.x(), 0, buffer.position.y());
+    }
+    foreach (const BufferPin &pin, tree.pins)
+    {
+        data.netlist->connect(pin.item, pin.port, pin.net);
+    }
+    data.count += tree.buffers.size();
+
+    return true;
+}
+
+QPointF
+itemPosition(const Netlist *netlist, const NetPlacement &placement, int item)
+{
+    if (netlist->isPad(item))
+    {
+        Vector<int> p = netlist->position(item);
+        return QPointF(p.x, p.z);
+    }
+
+    GatePlacement gp = placement.value(netlist->itemName(item));
+    return QPointF(gp.x, gp.z);
+}
+
+/*
+ * Input and output port of the buffer cell
+ */
+bool
+readBufferCell(BufferData &data, const CellLibrary *library, const PlacementJob *placementJob)
+{
+    data.cell = placementJob->bufferCell();
+    int cell = library->cellIndex(data.cell);
+    if (cell < 0)
+    {
+        qWarning("Can't find buffer cell %s", qPrintable(data.cell));
+        return false;
+    }
+
+    PlacementJob::CellTiming timing = placementJob->cellTiming(data.cell);
+    data.output = timing.output;
+    data.delay = timing.delay;
+    if ((library->portCount(cell) != 2) || (library->portIndex(cell, data.output) < 0))
+    {
+        qWarning("Buffer cell %s needs one input and the output %s", qPrintable(data.cell), qPrintable(data.output));
+        return false;
+    }
+    data.input = library->portName(cell, 1 - library->portIndex(cell, data.output));
+
+    return true;
+}
+
+bool
+insertBuffers(Netlist *netlist, NetPlacement &placement, const CellLibrary *library, const PlacementJob *placementJob, int &count)
+{
+    BufferData data;
+    data.netlist = netlist;
+    data.placement = &placement;
+    data.maxFanout = placementJob->maxFanout();
+    data.maxLength = placementJob->bufferSpacing();
+    data.maxWireLength = placementJob->maxWireLength();
+    data.repeaterDelay = placementJob->repeaterDelay();
+    data.count = 0;
+
+    Vector<int> min = placementJob->minCoordinates();
+    Vector<int> max = placementJob->maxCoordinates();
+    int xBlocks = (max.x - min.x + 1) / legalizationBlockSize;
+    int zBlocks = (max.z - min.z + 1) / legalizationBlockSize;
+    int sites = xBlocks * zBlocks * placementJob->tierCount();
+    data.capacity = int(sites * placementJob->bufferUtilization()) - placement.size();
+    count = 0;
+
+    if (!readBufferCell(data, library, placementJob)) return false;
+
+    QScopedPointer<TimingAnalysis> timing(TimingAnalysis::run(netlist, library, placementJob));
+    if (timing.isNull()) return false;
+
+    /* Sinks are collected before the netlist changes, critical nets first  */
+    QList<QString> netNames;
+    QList<QPointF> sources;
+    QList<QVector<BufferNode> > sinks;
+    QList<int> slacks;
+    for (int net = 0; net < netlist->netCount(); net++)
+    {
+        int driver = timing->driver(net);
+        if (driver < 0) continue;
+
+        QPointF source = itemPosition(netlist, placement, netlist->pinItem(driver));
+
+        QVector<BufferNode> nodes;
+        for (int pin = netlist->netPinBegin(net); pin < netlist->netPinEnd(net); pin++)
+        {
+            int item = netlist->pinItem(pin);
+            if ((pin == driver) || netlist->isDeleted(item)) continue;
+
+            BufferNode node;
+            node.item = netlist->itemName(item);
+            node.port = netlist->pinPort(pin);
+            node.position = itemPosition(netlist, placement, item);
+            node.slack = timing->pinSlack(pin) + wireDelay(data, source, node.position);
+            node.buffer = false;
+            nodes.append(node);
+        }
+
+        if (fitsNet(nodes, source, data)) continue;
+
+        netNames.append(netlist->netName(net));
+        sources.append(source);
+        sinks.append(nodes);
+        slacks.append(timing->slack(net));
+    }
+
+    QVector<int> order(netNames.size());
+    for (int i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), SlackOrder(slacks));
+
+    int skipped = 0;
+    foreach (int i, order)
+    {
+        if (!bufferNet(data, netNames[i], sources[i], sinks[i])) skipped++;
+    }
+    netlist->commit();
+
+    if (skipped > 0)
+    {
+        qWarning("%d nets are not buffered", skipped);
+    }
+
+    count = data.count;
+    return true;
+}
@@ -0,0 +1,29 @@
+#ifndef BUFFERING_H
+#define BUFFERING_H
+
+#include "placement.h"
+
+class Netlist;
+class CellLibrary;
+class PlacementJob;
+
+/*
+ * Buffer trees for nets with more than maxFanout sinks or with sinks out of
+ * the signal range (maxLength blocks in the (x, z) plane) of their driver.
+ *
+ * Sinks are clustered bottom-up: the most critical sinks in range stay on
+ * the net, the others are split at the median of their bounding box until
+ * every group fits a buffer, which is placed at the center of the group and
+ * pulled towards the driver as far as the group stays in range. Lone sinks
+ * out of range get repeaters maxLength blocks apart. A net keeps this tree
+ * only if the timing analysis model gives its sinks a better worst slack
+ * than with the direct wire, or with the tree that only splits the fanout.
+ * Buffers are new gates of the netlist, their positions are added to the
+ * placement, which needs to be legalized again. Critical nets are buffered
+ * first, nets whose trees don't fit into the legalization sites up to the
+ * buffer utilization of the job or can't be built keep their wires.
+ */
+bool
+insertBuffers(Netlist *netlist, NetPlacement &placement, const CellLibrary *library, const PlacementJob *placementJob, int &count);
+
+#endif // BUFFERING_H
@@ -0,0 +1,119 @@
+#include "cgsolver.h"
+#include "csrmatrix.h"
+#include <math.h>
+
+CgSolver::CgSolver(const CsrMatrix &matrix, Preconditioner::Type preconditionerType)
+    : m_matrix(matrix)
+{
+    m_preconditioner = Preconditioner::create(preconditionerType, matrix);
+    m_tolerance = 1e-6;
+    m_maxIterations = qMax(1000, matrix.n());
+    m_iterations = 0;
+    m_relativeResidual = 0.0;
+}
+
+CgSolver::~CgSolver()
+{
+    delete m_preconditioner;
+}
+
+void
+CgSolver::setTolerance(double tolerance)
+{
+    m_tolerance = tolerance;
+}
+
+void
+CgSolver::setMaxIterations(int maxIterations)
+{
+    m_maxIterations = maxIterations;
+}
+
+void
+CgSolver::solve(const Array &b, Array &x)
+{
+    Q_ASSERT(b.size() == m_matrix.n());
+
+    int n = m_matrix.n();
+
+    m_iterations = 0;
+    m_relativeResidual = 0.0;
+
+    double bnorm = sqrt(dot(b, b));
+    if (bnorm == 0.0)
+    {
+        x.resize(n);
+        x.fill(0.0);
+        return;
+    }
+
+    /* All buffers are allocated here, the iterations work in place.  */
+    Array r(n);
+    Array z(n);
+    Array p(n);
+    Array Ap(n);
+
+    if (x.size() == n)
+    {
+        // r = b - Ax
+        m_matrix.matvec(x, r);
+        xpby(b, -1.0, r);
+    }
+    else
+    {
+        x.resize(n);
+        x.fill(0.0);
+        r = b;
+    }
+
+    m_relativeResidual = sqrt(dot(r, r)) / bnorm;
+    if (m_relativeResidual <= m_tolerance) return;
+
+    m_preconditioner->apply(r, z);
+    p = z;
+    double rz = dot(r, z);
+
+    int i;
+    for (i = 0; i < m_maxIterations; i++)
+    {
+        m_matrix.matvec(p, Ap);
+
+        double pAp = dot(p, Ap);
+        if (pAp <= 0.0) break;
+
+        double alpha = rz / pAp;
+
+        axpy(alpha, p, x);
+        double rr = axpyNorm(-alpha, Ap, r);
+
+        m_relativeResidual = sqrt(rr) / bnorm;
+        if (m_relativeResidual <= m_tolerance) break;
+
+        m_preconditioner->apply(r, z);
+        double rzNew = dot(r, z);
+
+        // p = z + beta p
+        xpby(z, rzNew / rz, p);
+
+        rz = rzNew;
+    }
+    m_iterations = i + 1;
+
+    if (i == m_maxIterations)
+    {
+        m_iterations = m_maxIterations;
+        qWarning("CgSolver::solve(): reaches maximum iteration (relative residual %g).", m_relativeResidual);
+    }
+}
+
+int
+CgSolver::iterations() const
+{
+    return m_iterations;
+}
+
+double
+CgSolver::relativeResidual() const
+{
+    return m_relativeResidual;
+}
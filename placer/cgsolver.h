@@ -0,0 +1,52 @@
+#ifndef CGSOLVER_H
+#define CGSOLVER_H
+
+#include "linearsolver.h"
+
+class CsrMatrix;
+
+/*
+ * Preconditioned conjugate gradient solver for symmetric positive definite matrices.
+ * Preconditioner is built once and reused for all right-hand sides.
+ */
+class CgSolver : public LinearSolver
+{
+public:
+    CgSolver(const CsrMatrix &matrix, Preconditioner::Type preconditionerType);
+    ~CgSolver();
+
+    // Stop when |b - Ax| <= tolerance * |b|
+    virtual void
+    setTolerance(double tolerance);
+
+    void
+    setMaxIterations(int maxIterations);
+
+    using LinearSolver::solve;
+
+    // Solve "b = Ax" starting from x (or zero)
+    virtual void
+    solve(const Array &b, Array &x);
+
+    // Statistics of the last solve() call
+    int
+    iterations() const;
+
+    double
+    relativeResidual() const;
+
+private:
+    Q_DISABLE_COPY(CgSolver)
+
+protected:
+    const CsrMatrix &m_matrix;
+    Preconditioner *m_preconditioner;
+
+    double m_tolerance;
+    int m_maxIterations;
+
+    int m_iterations;
+    double m_relativeResidual;
+};
+
+#endif // CGSOLVER_H
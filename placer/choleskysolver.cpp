@@ -0,0 +1,275 @@
+#include "choleskysolver.h"
+#include "csrmatrix.h"
+#include <QMap>
+#include <QPair>
+#include <math.h>
+
+CholeskySolver::CholeskySolver(const CsrMatrix &matrix)
+{
+    m_n = matrix.n();
+
+    order(matrix);
+    m_valid = factorize(matrix);
+}
+
+bool
+CholeskySolver::isValid() const
+{
+    return m_valid;
+}
+
+int
+CholeskySolver::factorNnz() const
+{
+    return m_rowIndexes.size();
+}
+
+void
+CholeskySolver::order(const CsrMatrix &matrix)
+{
+    const QVector<int> &rowPointers = matrix.rowPointers();
+    const QVector<int> &columnIndexes = matrix.columnIndexes();
+
+    /* Elimination graph, adjacency lists are kept sorted.  */
+    QVector<QVector<int> > adjacency(m_n);
+    for (int row = 0; row < m_n; row++)
+    {
+        for (int i = rowPointers[row]; i < rowPointers[row + 1]; i++)
+        {
+            if (columnIndexes[i] != row) adjacency[row].append(columnIndexes[i]);
+        }
+    }
+
+    /*
+     * Minimum degree ordering. Queue is an ordered set of (degree, node),
+     * the entry of a node is replaced when its degree changes.
+     */
+    QMap<QPair<int, int>, bool> queue;
+    for (int i = 0; i < m_n; i++)
+    {
+        queue.insert(qMakePair(adjacency[i].size(), i), true);
+    }
+
+    QVector<QVector<int> > patterns(m_n); // Column patterns of L in old indexes
+    m_permutation.clear();
+    m_permutation.reserve(m_n);
+
+    QVector<int> merged;
+    while (queue.size() > 0)
+    {
+        int v = queue.begin().key().second;
+        queue.erase(queue.begin());
+
+        m_permutation.append(v);
+
+        /* Neighbours of v form a clique after its elimination.  */
+        const QVector<int> &neighbours = adjacency[v];
+        foreach (int u, neighbours)
+        {
+            const QVector<int> &a = adjacency[u];
+            queue.remove(qMakePair(a.size(), u));
+
+            merged.clear();
+            merged.reserve(a.size() + neighbours.size());
+
+            int i = 0, j = 0;
+            while ((i < a.size()) || (j < neighbours.size()))
+            {
+                int next;
+                if ((j == neighbours.size()) || ((i < a.size()) && (a[i] < neighbours[j])))
+                {
+                    next = a[i++];
+                }
+                else if ((i == a.size()) || (neighbours[j] < a[i]))
+                {
+                    next = neighbours[j++];
+                }
+                else
+                {
+                    next = a[i++];
+                    j++;
+                }
+                if ((next != u) && (next != v)) merged.append(next);
+            }
+
+            adjacency[u].swap(merged);
+            queue.insert(qMakePair(adjacency[u].size(), u), true);
+        }
+
+        patterns[v] = neighbours;
+        adjacency[v].clear();
+    }
+
+    m_inversePermutation.resize(m_n);
+    for (int i = 0; i < m_n; i++)
+    {
+        m_inversePermutation[m_permutation[i]] = i;
+    }
+
+    /* Symbolic factor in new indexes.  */
+    m_columnPointers.fill(0, m_n + 1);
+    m_rowIndexes.clear();
+    for (int j = 0; j < m_n; j++)
+    {
+        const QVector<int> &pattern = patterns[m_permutation[j]];
+
+        int start = m_rowIndexes.size();
+        foreach (int u, pattern)
+        {
+            m_rowIndexes.append(m_inversePermutation[u]);
+        }
+        qSort(m_rowIndexes.begin() + start, m_rowIndexes.end());
+
+        m_columnPointers[j + 1] = m_rowIndexes.size();
+        patterns[m_permutation[j]].clear();
+    }
+    m_values.fill(0.0, m_rowIndexes.size());
+}
+
+bool
+CholeskySolver::factorize(const CsrMatrix &matrix)
+{
+    const QVector<int> &rowPointers = matrix.rowPointers();
+    const QVector<int> &columnIndexes = matrix.columnIndexes();
+    const QVector<double> &values = matrix.values();
+
+    /* Row patterns of L: columns k < j with L(j,k) != 0, in increasing order.  */
+    QVector<int> rowCounts(m_n + 1, 0);
+    for (int i = 0; i < m_rowIndexes.size(); i++)
+    {
+        rowCounts[m_rowIndexes[i] + 1]++;
+    }
+    for (int i = 0; i < m_n; i++)
+    {
+        rowCounts[i + 1] += rowCounts[i];
+    }
+    QVector<int> rowColumns(m_rowIndexes.size());
+    QVector<int> fill = rowCounts;
+    for (int k = 0; k < m_n; k++)
+    {
+        for (int i = m_columnPointers[k]; i < m_columnPointers[k + 1]; i++)
+        {
+            rowColumns[fill[m_rowIndexes[i]]++] = k;
+        }
+    }
+
+    /* Left-looking factorization.  */
+    m_diagonal.fill(0.0, m_n);
+    QVector<double> work(m_n, 0.0);
+    QVector<int> next = m_columnPointers; // Position of the current row in each column
+    for (int j = 0; j < m_n; j++)
+    {
+        /* Scatter lower part of column j of P A P^T.  */
+        int v = m_permutation[j];
+        double a = 0.0;
+        for (int i = rowPointers[v]; i < rowPointers[v + 1]; i++)
+        {
+            int row = m_inversePermutation[columnIndexes[i]];
+            if (row >= j) work[row] += values[i];
+            if (row == j) a += values[i];
+        }
+
+        /* Apply updates from previous columns.  */
+        for (int r = rowCounts[j]; r < rowCounts[j + 1]; r++)
+        {
+            int k = rowColumns[r];
+            int p = next[k];
+            Q_ASSERT(m_rowIndexes[p] == j);
+
+            double ljk = m_values[p];
+            work[j] -= ljk * ljk;
+            for (int i = p + 1; i < m_columnPointers[k + 1]; i++)
+            {
+                work[m_rowIndexes[i]] -= m_values[i] * ljk;
+            }
+            next[k] = p + 1;
+        }
+
+        double d = work[j];
+        work[j] = 0.0;
+
+        /*
+         * Gates which are not connected to any pad make the matrix singular
+         * (zero pivot at the last gate of such a group). Pin them instead of failing.
+         */
+        double eps = 1e-10 * qAbs(a);
+        bool singular = (d <= eps);
+        if (d < -eps) return false;
+
+        d = singular ? 1.0 : sqrt(d);
+        m_diagonal[j] = d;
+
+        for (int i = m_columnPointers[j]; i < m_columnPointers[j + 1]; i++)
+        {
+            int row = m_rowIndexes[i];
+            m_values[i] = singular ? 0.0 : (work[row] / d);
+            work[row] = 0.0;
+        }
+    }
+
+    return true;
+}
+
+void
+CholeskySolver::solve(const Array &b, Array &x)
+{
+    Array x2;
+    solve(b, Array(m_n), x, x2);
+}
+
+void
+CholeskySolver::solve(const Array &b1, const Array &b2, Array &x1, Array &x2)
+{
+    Q_ASSERT(b1.size() == m_n);
+    Q_ASSERT(b2.size() == m_n);
+
+    Array z1(m_n);
+    Array z2(m_n);
+    for (int i = 0; i < m_n; i++)
+    {
+        z1[i] = b1[m_permutation[i]];
+        z2[i] = b2[m_permutation[i]];
+    }
+
+    /* Forward substitution "L y = P b".  */
+    for (int j = 0; j < m_n; j++)
+    {
+        double d = m_diagonal[j];
+        double v1 = z1[j] / d;
+        double v2 = z2[j] / d;
+        z1[j] = v1;
+        z2[j] = v2;
+
+        for (int i = m_columnPointers[j]; i < m_columnPointers[j + 1]; i++)
+        {
+            int row = m_rowIndexes[i];
+            z1[row] -= m_values[i] * v1;
+            z2[row] -= m_values[i] * v2;
+        }
+    }
+
+    /* Backward substitution "L^T z = y".  */
+    for (int j = m_n - 1; j >= 0; j--)
+    {
+        double v1 = z1[j];
+        double v2 = z2[j];
+        for (int i = m_columnPointers[j]; i < m_columnPointers[j + 1]; i++)
+        {
+            int row = m_rowIndexes[i];
+            v1 -= m_values[i] * z1[row];
+            v2 -= m_values[i] * z2[row];
+        }
+
+        double d = m_diagonal[j];
+        z1[j] = v1 / d;
+        z2[j] = v2 / d;
+    }
+
+    x1 = Array(m_n);
+    x2 = Array(m_n);
+    for (int i = 0; i < m_n; i++)
+    {
+        x1[m_permutation[i]] = z1[i];
+        x2[m_permutation[i]] = z2[i];
+    }
+}
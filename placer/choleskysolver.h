@@ -0,0 +1,56 @@
+#ifndef CHOLESKYSOLVER_H
+#define CHOLESKYSOLVER_H
+
+#include <QVector>
+#include "linearsolver.h"
+
+/*
+ * Sparse Cholesky factorization "P A P^T = L L^T".
+ * P is a minimum degree ordering. The factor is computed once and then
+ * used for any number of right-hand sides.
+ */
+class CholeskySolver : public LinearSolver
+{
+public:
+    CholeskySolver(const CsrMatrix &matrix);
+
+    // False if the matrix is not positive definite
+    bool
+    isValid() const;
+
+    // Number of non-zero elements in L (without diagonal)
+    int
+    factorNnz() const;
+
+    using LinearSolver::solve;
+
+    // Initial guess in x is ignored
+    virtual void
+    solve(const Array &b, Array &x);
+
+    // Both right-hand sides are solved in a single pass over L
+    virtual void
+    solve(const Array &b1, const Array &b2, Array &x1, Array &x2);
+
+private:
+    void
+    order(const CsrMatrix &matrix);
+
+    bool
+    factorize(const CsrMatrix &matrix);
+
+private:
+    int             m_n;
+    bool            m_valid;
+
+    QVector<int>    m_permutation;        // new index -> old index
+    QVector<int>    m_inversePermutation; // old index -> new index
+
+    // Strictly lower part of L by columns, row indexes are sorted
+    QVector<int>    m_columnPointers;
+    QVector<int>    m_rowIndexes;
+    QVector<double> m_values;
+    QVector<double> m_diagonal;
+};
+
+#endif // CHOLESKYSOLVER_H
@@ -0,0 +1,70 @@
+#include "clustering.h"
+#include "placementdb.h"
+
+// Larger nets don't make their cells close
+const int maxMatchingNetSize = 16;
+
+int
+matchCells(const QVector<int> &netPointers, const QVector<int> &netCells, const QVector<int> &cellNetPointers,
+           const QVector<int> &cellNets, const QVector<double> &weights, int count, double maxWeight, bool normalize,
+           const MatchingFilter *filter, QVector<int> &clusters)
+{
+    clusters.fill(-1, count);
+    int clusterCount = 0;
+
+    QVector<double> scores(count, 0.0);
+    QVector<int> touched;
+    for (int cell = 0; cell < count; cell++)
+    {
+        if (clusters[cell] >= 0) continue;
+
+        touched.clear();
+        for (int i = cellNetPointers[cell]; i < cellNetPointers[cell + 1]; i++)
+        {
+            int net = cellNets[i];
+            int size = netPointers[net + 1] - netPointers[net];
+            if ((size < 2) || (size > maxMatchingNetSize)) continue;
+
+            double score = 1.0 / (size - 1);
+            for (int pin = netPointers[net]; pin < netPointers[net + 1]; pin++)
+            {
+                int other = netCells[pin];
+                if ((other == cell) || (other >= count) || (clusters[other] >= 0)) continue;
+                if (weights[cell] + weights[other] > maxWeight) continue;
+                if ((filter != 0) && !filter->canPair(cell, other)) continue;
+
+                if (scores[other] == 0.0) touched.append(other);
+                scores[other] += score;
+            }
+        }
+
+        int best = -1;
+        double bestScore = 0.0;
+        foreach (int other, touched)
+        {
+            double score = normalize ? scores[other] / (weights[cell] + weights[other]) : scores[other];
+            if ((best < 0) || (score > bestScore))
+            {
+                best = other;
+                bestScore = score;
+            }
+        }
+        foreach (int other, touched)
+        {
+            scores[other] = 0.0;
+        }
+
+        clusters[cell] = clusterCount;
+        if (best >= 0) clusters[best] = clusterCount;
+        clusterCount++;
+    }
+
+    return clusterCount;
+}
+
+int
+matchGates(const PlacementDb *db, const QVector<double> &weights, double maxWeight, QVector<int> &clusters)
+{
+    return matchCells(db->netPointers(), db->pinCells(), db->cellNetPointers(), db->cellNets(), weights,
+                      db->gateCount(), maxWeight, true, 0, clusters);
+}
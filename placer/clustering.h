@@ -0,0 +1,43 @@
+#ifndef CLUSTERING_H
+#define CLUSTERING_H
+
+#include <QVector>
+
+class PlacementDb;
+
+/*
+ * Pairs that matchCells() may form
+ */
+class MatchingFilter
+{
+public:
+    virtual ~MatchingFilter() {}
+
+    virtual bool
+    canPair(int cell, int other) const = 0;
+};
+
+/*
+ * Heavy-edge matching of a hypergraph. Pins of net n are
+ * netCells[netPointers[n]; netPointers[n + 1]), nets of cell c are
+ * cellNets[cellNetPointers[c]; cellNetPointers[c + 1]). Every cell of
+ * [0; count) is matched with the unmatched neighbour it is connected to
+ * the strongest: a net of p pins contributes 1/(p - 1), with normalize the
+ * sum is divided by the weight of the pair. Cells from count on only
+ * connect. Pairs heavier than maxWeight or refused by the filter (0 takes
+ * every pair) are not formed. Returns the number of clusters,
+ * clusters[cell] is the cluster of the cell.
+ */
+int
+matchCells(const QVector<int> &netPointers, const QVector<int> &netCells, const QVector<int> &cellNetPointers,
+           const QVector<int> &cellNets, const QVector<double> &weights, int count, double maxWeight, bool normalize,
+           const MatchingFilter *filter, QVector<int> &clusters);
+
+/*
+ * Matching of the gates for multilevel placement, the score of a pair is
+ * divided by its weight.
+ */
+int
+matchGates(const PlacementDb *db, const QVector<double> &weights, double maxWeight, QVector<int> &clusters);
+
+#endif // CLUSTERING_H
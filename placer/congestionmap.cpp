@@ -0,0 +1,181 @@
+#include "congestionmap.h"
+#include "hpwlengine.h"
+#include <QFile>
+#include <QXmlStreamWriter>
+#include <QScopedPointer>
+
+// Fully blocked bins keep a little capacity, so that congestion stays finite
+const double minCapacity = 1.0;
+
+CongestionMap::CongestionMap()
+{
+    m_binSize = 1;
+    m_xBins = m_zBins = 0;
+}
+
+int
+CongestionMap::xBins() const
+{
+    return m_xBins;
+}
+
+int
+CongestionMap::zBins() const
+{
+    return m_zBins;
+}
+
+int
+CongestionMap::bin(int x, int z) const
+{
+    int xi = qBound(0, (x - m_min.x) / m_binSize, m_xBins - 1);
+    int zi = qBound(0, (z - m_min.z) / m_binSize, m_zBins - 1);
+    return zi * m_xBins + xi;
+}
+
+double
+CongestionMap::demand(int bin) const
+{
+    return m_demand[bin];
+}
+
+double
+CongestionMap::capacity(int bin) const
+{
+    return m_capacity[bin];
+}
+
+double
+CongestionMap::congestion(int bin) const
+{
+    return m_demand[bin] / m_capacity[bin];
+}
+
+double
+CongestionMap::maxCongestion() const
+{
+    double result = 0.0;
+    for (int bin = 0; bin < m_demand.size(); bin++)
+    {
+        result = qMax(result, congestion(bin));
+    }
+    return result;
+}
+
+double
+CongestionMap::overflow() const
+{
+    double total = 0.0;
+    double excess = 0.0;
+    for (int bin = 0; bin < m_demand.size(); bin++)
+    {
+        total += m_demand[bin];
+        excess += qMax(0.0, m_demand[bin] - m_capacity[bin]);
+    }
+    return (total > 0.0) ? excess / total : 0.0;
+}
+
+bool
+CongestionMap::save(const QString &filePath) const
+{
+    QFile fo(filePath);
+    if (!fo.open(QFile::WriteOnly | QFile::Truncate))
+    {
+        qWarning("Can't open congestion report %s", qPrintable(filePath));
+        return false;
+    }
+
+    QXmlStreamWriter stream(&fo);
+    stream.setAutoFormatting(true);
+    stream.writeStartDocument();
+    stream.writeStartElement("congestion");
+    stream.writeAttribute("binSize", QString::number(m_binSize));
+    stream.writeAttribute("max", QString::number(maxCongestion()));
+    stream.writeAttribute("overflow", QString::number(overflow()));
+
+    for (int bin = 0; bin < m_demand.size(); bin++)
+    {
+        stream.writeStartElement("bin");
+        stream.writeAttribute("x", QString::number(m_min.x + (bin % m_xBins) * m_binSize));
+        stream.writeAttribute("z", QString::number(m_min.z + (bin / m_xBins) * m_binSize));
+        stream.writeAttribute("demand", QString::number(m_demand[bin]));
+        stream.writeAttribute("capacity", QString::number(m_capacity[bin]));
+        stream.writeEndElement();
+    }
+
+    stream.writeEndElement();
+    stream.writeEndDocument();
+
+    fo.close();
+
+    return true;
+}
+
+void
+CongestionMap::addRectangle(QVector<double> &map, int x0, int z0, int x1, int z1, double density)
+{
+    x0 = qMax(x0, m_min.x);
+    z0 = qMax(z0, m_min.z);
+    x1 = qMin(x1, m_max.x);
+    z1 = qMin(z1, m_max.z);
+    if ((x0 > x1) || (z0 > z1)) return;
+
+    for (int zi = (z0 - m_min.z) / m_binSize; zi <= (z1 - m_min.z) / m_binSize; zi++)
+    {
+        int binZ0 = qMax(z0, m_min.z + zi * m_binSize);
+        int binZ1 = qMin(z1, m_min.z + (zi + 1) * m_binSize - 1);
+        for (int xi = (x0 - m_min.x) / m_binSize; xi <= (x1 - m_min.x) / m_binSize; xi++)
+        {
+            int binX0 = qMax(x0, m_min.x + xi * m_binSize);
+            int binX1 = qMin(x1, m_min.x + (xi + 1) * m_binSize - 1);
+            map[zi * m_xBins + xi] += density * (binX1 - binX0 + 1) * (binZ1 - binZ0 + 1);
+        }
+    }
+}
+
+CongestionMap *
+CongestionMap::build(const HpwlEngine *engine, const Vector<int> &min, const Vector<int> &max, int binSize)
+{
+    QScopedPointer<CongestionMap> map(new CongestionMap());
+    map->m_min = min;
+    map->m_max = max;
+    map->m_binSize = binSize;
+    map->m_xBins = (max.x - min.x) / binSize + 1;
+    map->m_zBins = (max.z - min.z) / binSize + 1;
+    map->m_demand.fill(0.0, map->m_xBins * map->m_zBins);
+    map->m_capacity.fill(0.0, map->m_xBins * map->m_zBins);
+
+    /* Free volume: columns of the area minus the cells  */
+    int height = max.y - min.y + 1;
+    map->addRectangle(map->m_capacity, min.x, min.z, max.x, max.z, height);
+    for (int item = 0; item < engine->itemCount(); item++)
+    {
+        Vector<int> p = engine->position(item);
+        Vector<int> size = engine->dimensions(item);
+
+        int blocked = qMin(p.y + size.y - 1, max.y) - qMax(p.y, min.y) + 1;
+        if (blocked <= 0) continue;
+
+        map->addRectangle(map->m_capacity, p.x, p.z, p.x + size.x - 1, p.z + size.z - 1, -blocked);
+    }
+    for (int bin = 0; bin < map->m_capacity.size(); bin++)
+    {
+        map->m_capacity[bin] = qMax(minCapacity, map->m_capacity[bin]);
+    }
+
+    /* Wire of a net, spread over its footprint  */
+    for (int net = 0; net < engine->netCount(); net++)
+    {
+        if (engine->netPinCount(net) < 2) continue;
+
+        Vector<int> netMin, netMax;
+        engine->netBox(net, netMin, netMax);
+
+        Vector<int> size = netMax - netMin;
+        double wire = size.length() + 1;
+        double area = double(size.x + 1) * (size.z + 1);
+        map->addRectangle(map->m_demand, netMin.x, netMin.z, netMax.x, netMax.z, wire / area);
+    }
+
+    return map.take();
+}
@@ -0,0 +1,72 @@
+#ifndef CONGESTIONMAP_H
+#define CONGESTIONMAP_H
+
+#include <QString>
+#include <QVector>
+#include "common/vector.h"
+
+class HpwlEngine;
+
+/*
+ * Routing congestion estimate (RUDY, Spindler and Johannes).
+ *
+ * The routing area is cut into columns of binSize x binSize in the (x, z)
+ * plane. The wire of a net, the half-perimeter of its pins, is spread evenly
+ * over the (x, z) footprint of its bounding box. Capacity of a bin is the
+ * volume of its column minus the cells in it. Congestion is demand / capacity.
+ */
+class CongestionMap
+{
+public:
+    int
+    xBins() const;
+
+    int
+    zBins() const;
+
+    // Bin of the point, clamped to the area
+    int
+    bin(int x, int z) const;
+
+    double
+    demand(int bin) const;
+
+    double
+    capacity(int bin) const;
+
+    double
+    congestion(int bin) const;
+
+    double
+    maxCongestion() const;
+
+    // Demand above the capacity of the bins, fraction of the total demand
+    double
+    overflow() const;
+
+public:
+    bool
+    save(const QString &filePath) const;
+
+public:
+    // min and max are the routing area (inclusive)
+    static CongestionMap *
+    build(const HpwlEngine *engine, const Vector<int> &min, const Vector<int> &max, int binSize);
+
+private:
+    CongestionMap();
+
+    // Adds density per unit area to the columns [x0; x1] x [z0; z1] (clipped)
+    void
+    addRectangle(QVector<double> &map, int x0, int z0, int x1, int z1, double density);
+
+private:
+    Vector<int> m_min, m_max;
+    int m_binSize;
+    int m_xBins, m_zBins;
+
+    QVector<double> m_demand;
+    QVector<double> m_capacity;
+};
+
+#endif // CONGESTIONMAP_H
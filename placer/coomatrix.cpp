@@ -24,7 +24,7 @@ int CooMatrix::nnz() const
     return m_data.size();
 }
 
-double CooMatrix::getElement(int index, int &x, int &y)
+double CooMatrix::getElement(int index, int &x, int &y) const
 {
     x = m_col[index];
     y = m_row[index];
@@ -33,61 +33,55 @@ double CooMatrix::getElement(int index, int &x, int &y)
 
 Array CooMatrix::matvec(const Array &x) const
 {
-    Array result(m_n);
+    Array result;
+    matvec(x, result);
+    return result;
+}
+
+void CooMatrix::matvec(const Array &x, Array &y) const
+{
+    Q_ASSERT(&x != &y);
+
+    y.resize(m_n);
+    y.fill(0.0);
+
+    const int *row = m_row.constData();
+    const int *col = m_col.constData();
+    const double *data = m_data.constData();
+    const double *px = x.constData();
+    double *py = y.data();
 
     for (int i = 0; i < m_data.size(); i++)
     {
-        result[m_row[i]] += m_data[i] * x[m_col[i]];
+        py[row[i]] += data[i] * px[col[i]];
     }
-
-    return result;
 }
 
 Array CooMatrix::solve(const Array &b) const
 {
-    // x = A^{-1} b with CG
+    // x = A^{-1} b with CG, starting from zero
 
     int maxit = 1000;
     Array x(m_n);
-    Array Ax;
-    Array Ap;
-    Array r;
-    Array p;
+    Array Ap(m_n);
+    Array r = b;
+    Array p = r;
     double rnormold, alpha, rnorm;
-    double error, errorold = 1.0;
-
-    for(int i = 0; i < x.size(); i++)
-    {
-        x[i] = (double)qrand() / (double)RAND_MAX;
-    }
 
-    Ax = matvec(x);
-    r = b - Ax;
-    p = r;
     rnormold = dot(r, r);
 
     int i;
     for (i = 0; i < maxit; i++)
     {
-        Ap = matvec(p);
+        matvec(p, Ap);
         alpha = rnormold / dot(p, Ap);
 
-        // p *= alpha
-        x += p * alpha;
-
-        // Ap *= alpha;
-        r -= Ap * alpha;
-
-        rnorm = dot(r, r);
+        axpy(alpha, p, x);
+        rnorm = axpyNorm(-alpha, Ap, r);
         if (sqrt(rnorm) < 1e-8) break;
-        else
-        {
-            error = abs( dot( r, x) );
-            errorold = error;
-        }
-
-        p *= (rnorm/rnormold);
-        p += r;
+
+        // p = r + (rnorm / rnormold) p
+        xpby(r, rnorm / rnormold, p);
 
         rnormold = rnorm;
     }
@@ -1,6 +1,7 @@
 #ifndef COOMATRIX_H
 #define COOMATRIX_H
 
+#include <QVector>
 #include "array.h"
 
 class CooMatrix
@@ -16,11 +17,14 @@ public:
     // Number of non-zero elements
     int nnz() const;
 
-    double getElement(int index, int &x, int &y);
+    double getElement(int index, int &x, int &y) const;
 
     // Calculate "Ax"
     Array matvec(const Array &x) const;
 
+    // Calculate "y = Ax" into an existing buffer, x and y must differ
+    void matvec(const Array &x, Array &y) const;
+
     // Solve "b = Ax"
     Array solve(const Array &b) const;
 
@@ -0,0 +1,175 @@
+#include "csrmatrix.h"
+#include "coomatrix.h"
+#include <QPair>
+#include <algorithm>
+
+CsrMatrix::CsrMatrix(const CooMatrix &coo)
+{
+    m_n = coo.n();
+
+    /* Count elements in each row.  */
+    m_rowPointers.fill(0, m_n + 1);
+    for (int i = 0; i < coo.nnz(); i++)
+    {
+        int x, y;
+        coo.getElement(i, x, y);
+        m_rowPointers[y + 1]++;
+    }
+    for (int i = 0; i < m_n; i++)
+    {
+        m_rowPointers[i + 1] += m_rowPointers[i];
+    }
+
+    /* Scatter elements into rows.  */
+    QVector<QPair<int, double> > elements(coo.nnz());
+    QVector<int> fill = m_rowPointers;
+    for (int i = 0; i < coo.nnz(); i++)
+    {
+        int x, y;
+        double v = coo.getElement(i, x, y);
+        elements[fill[y]++] = qMakePair(x, v);
+    }
+
+    /* Sort each row by column and merge duplicates.  */
+    m_columnIndexes.reserve(elements.size());
+    m_values.reserve(elements.size());
+
+    int start = 0;
+    for (int row = 0; row < m_n; row++)
+    {
+        int end = m_rowPointers[row + 1];
+        std::sort(elements.begin() + start, elements.begin() + end);
+
+        m_rowPointers[row] = m_columnIndexes.size();
+        for (int i = start; i < end; i++)
+        {
+            if ((i > start) && (elements[i].first == m_columnIndexes.last()))
+            {
+                m_values.last() += elements[i].second;
+            }
+            else
+            {
+                m_columnIndexes.append(elements[i].first);
+                m_values.append(elements[i].second);
+            }
+        }
+        start = end;
+    }
+    m_rowPointers[m_n] = m_columnIndexes.size();
+}
+
+int
+CsrMatrix::n() const
+{
+    return m_n;
+}
+
+int
+CsrMatrix::nnz() const
+{
+    return m_values.size();
+}
+
+Array
+CsrMatrix::matvec(const Array &x) const
+{
+    Array result;
+    matvec(x, result);
+    return result;
+}
+
+void
+CsrMatrix::matvec(const Array &x, Array &y) const
+{
+    Q_ASSERT(x.size() == m_n);
+    Q_ASSERT(&x != &y);
+
+    y.resize(m_n);
+
+    const int *rowPointers = m_rowPointers.constData();
+    const int *columnIndexes = m_columnIndexes.constData();
+    const double *values = m_values.constData();
+    const double *px = x.constData();
+    double *py = y.data();
+
+    for (int row = 0; row < m_n; row++)
+    {
+        double sum = 0.0;
+        for (int i = rowPointers[row]; i < rowPointers[row + 1]; i++)
+        {
+            sum += values[i] * px[columnIndexes[i]];
+        }
+        py[row] = sum;
+    }
+}
+
+void
+CsrMatrix::matvec(const Array &x1, const Array &x2, Array &y1, Array &y2) const
+{
+    Q_ASSERT(x1.size() == m_n);
+    Q_ASSERT(x2.size() == m_n);
+
+    y1.resize(m_n);
+    y2.resize(m_n);
+
+    const int *rowPointers = m_rowPointers.constData();
+    const int *columnIndexes = m_columnIndexes.constData();
+    const double *values = m_values.constData();
+    const double *px1 = x1.constData();
+    const double *px2 = x2.constData();
+    double *py1 = y1.data();
+    double *py2 = y2.data();
+
+    for (int row = 0; row < m_n; row++)
+    {
+        double sum1 = 0.0;
+        double sum2 = 0.0;
+        for (int i = rowPointers[row]; i < rowPointers[row + 1]; i++)
+        {
+            double v = values[i];
+            int col = columnIndexes[i];
+            sum1 += v * px1[col];
+            sum2 += v * px2[col];
+        }
+        py1[row] = sum1;
+        py2[row] = sum2;
+    }
+}
+
+Array
+CsrMatrix::diagonal() const
+{
+    Array result(m_n);
+
+    for (int row = 0; row < m_n; row++)
+    {
+        for (int i = m_rowPointers[row]; i < m_rowPointers[row + 1]; i++)
+        {
+            if (m_columnIndexes[i] == row)
+            {
+                result[row] = m_values[i];
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+const QVector<int> &
+CsrMatrix::rowPointers() const
+{
+    return m_rowPointers;
+}
+
+const QVector<int> &
+CsrMatrix::columnIndexes() const
+{
+    return m_columnIndexes;
+}
+
+const QVector<double> &
+CsrMatrix::values() const
+{
+    return m_values;
+}
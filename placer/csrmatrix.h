@@ -0,0 +1,46 @@
+#ifndef CSRMATRIX_H
+#define CSRMATRIX_H
+
+#include <QVector>
+#include "array.h"
+
+class CooMatrix;
+
+/*
+ * Compressed sparse row matrix.
+ * Column indexes are sorted within each row, duplicate elements are merged.
+ */
+class CsrMatrix
+{
+public:
+    CsrMatrix(const CooMatrix &coo);
+
+    // Matrix size
+    int n() const;
+
+    // Number of non-zero elements
+    int nnz() const;
+
+    // Calculate "Ax"
+    Array matvec(const Array &x) const;
+
+    // Calculate "y = Ax" into an existing buffer, x and y must differ
+    void matvec(const Array &x, Array &y) const;
+
+    // Calculate "y1 = A x1" and "y2 = A x2" in a single pass
+    void matvec(const Array &x1, const Array &x2, Array &y1, Array &y2) const;
+
+    Array diagonal() const;
+
+    const QVector<int> &rowPointers() const;
+    const QVector<int> &columnIndexes() const;
+    const QVector<double> &values() const;
+
+private:
+    int             m_n;
+    QVector<int>    m_rowPointers;
+    QVector<int>    m_columnIndexes;
+    QVector<double> m_values;
+};
+
+#endif // CSRMATRIX_H
@@ -0,0 +1,651 @@
+#include "eplace.h"
+#include <QVector>
+#include <QPointF>
+#include <QSizeF>
+#include <QScopedPointer>
+#include <QThread>
+#include <QRunnable>
+#include <QVarLengthArray>
+#include <math.h>
+#include "placementdb.h"
+#include "poissonsolver.h"
+#include "taskpool.h"
+#include "placementjob.h"
+#include "legalization.h"
+#include "qp.h"
+#include "random.h"
+
+// Bins per side: the largest power of 2 with at least one cell per bin
+const int minBinCount = 16;
+const int maxBinCount = 512;
+// Kernels always use the same chunks, so the result doesn't depend on the thread count
+const int maxChunks = 16;
+const int minChunkSize = 256;
+// Density weight starts at this fraction of the wirelength / density gradient ratio
+const double initialDensityWeight = 1e-3;
+const double densityWeightGrowth = 1.05;
+// First step of the optimizer in bins
+const double initialStep = 0.1;
+
+/*
+ * Movable cells are the gates of the database followed by the fillers,
+ * fillers take the free area up to the target density. All cells have the
+ * footprint of a legalization site, cells smaller than a bin are inflated
+ * and their density lowered. Gates in congested regions carry more charge.
+ */
+typedef struct {
+    const PlacementDb *db;
+    int gateCount;
+    int cellCount;
+    QVector<int> gatePinPointers; // gate -> pins of the database
+    QVector<int> gatePins;
+    QVector<double> gateCharges; // gate -> charge in sites
+
+    QPointF origin;
+    QSizeF size;
+    int binCount;
+    double binWidth, binHeight;
+    double cellWidth, cellHeight;
+    double cellDensity;
+    double gateArea;
+    double targetDensity;
+
+    PoissonSolver *solver;
+    TaskPool *pool;
+
+    // Evaluated point and its parameters
+    const QVector<QPointF> *positions;
+    QVector<QPointF> *gradient;
+    double gamma;
+    double lambda;
+
+    // Buffers
+    QVector<QPointF> pinGradients;
+    QVector<QVector<double> > maps;  // chunk -> gate bins, filler bins
+    QVector<double> wirelengthNorms; // chunk -> |gradient|
+    QVector<double> densityNorms;
+    QVector<double> density;
+    QVector<double> fieldX, fieldY;
+} EPlaceData;
+
+QPointF
+pinPosition(const EPlaceData &data, int cell)
+{
+    return data.db->isGate(cell) ? (*data.positions)[cell] : data.db->positions()[cell];
+}
+
+double
+cellCharge(const EPlaceData &data, int cell)
+{
+    return (cell < data.gateCount) ? data.gateCharges[cell] : 1.0;
+}
+
+QPointF
+clampCell(const EPlaceData &data, const QPointF &p)
+{
+    double x = qBound(data.origin.x() + data.cellWidth / 2, p.x(), data.origin.x() + data.size.width() - data.cellWidth / 2);
+    double y = qBound(data.origin.y() + data.cellHeight / 2, p.y(), data.origin.y() + data.size.height() - data.cellHeight / 2);
+    return QPointF(x, y);
+}
+
+/*
+ * Overlaps of the cell centered at c with the bins along one axis,
+ * the first overlapped bin is returned.
+ */
+int
+binOverlaps(QVarLengthArray<double, 8> &overlaps, double c, double origin, double cellSize, double binSize, int binCount)
+{
+    double low = c - cellSize / 2 - origin;
+    double high = c + cellSize / 2 - origin;
+    int first = qBound(0, int(floor(low / binSize)), binCount - 1);
+    int last = qBound(0, int(floor(high / binSize)), binCount - 1);
+
+    overlaps.clear();
+    for (int b = first; b <= last; b++)
+    {
+        double overlap = qMin(high, (b + 1) * binSize) - qMax(low, b * binSize);
+        overlaps.append(qMax(0.0, overlap));
+    }
+    return first;
+}
+
+/*
+ * Weighted-average wirelength along one axis:
+ * sum(c exp(c / gamma)) / sum(exp(c / gamma)) - sum(c exp(-c / gamma)) / sum(exp(-c / gamma)).
+ * Exponents are shifted by the extreme coordinates to stay finite.
+ */
+void
+axisGradient(EPlaceData &data, int begin, int end, bool xAxis)
+{
+    const QVector<int> &pinCells = data.db->pinCells();
+
+    QVarLengthArray<double, 32> coordinates(end - begin);
+    double min = 0.0, max = 0.0;
+    for (int i = 0; i < end - begin; i++)
+    {
+        QPointF p = pinPosition(data, pinCells[begin + i]);
+        coordinates[i] = xAxis ? p.x() : p.y();
+        if ((i == 0) || (coordinates[i] < min)) min = coordinates[i];
+        if ((i == 0) || (coordinates[i] > max)) max = coordinates[i];
+    }
+
+    QVarLengthArray<double, 32> maxWeights(end - begin);
+    QVarLengthArray<double, 32> minWeights(end - begin);
+    double maxSum = 0.0, maxMoment = 0.0;
+    double minSum = 0.0, minMoment = 0.0;
+    for (int i = 0; i < end - begin; i++)
+    {
+        maxWeights[i] = exp((coordinates[i] - max) / data.gamma);
+        minWeights[i] = exp((min - coordinates[i]) / data.gamma);
+        maxSum += maxWeights[i];
+        maxMoment += coordinates[i] * maxWeights[i];
+        minSum += minWeights[i];
+        minMoment += coordinates[i] * minWeights[i];
+    }
+    double maxAverage = maxMoment / maxSum;
+    double minAverage = minMoment / minSum;
+
+    for (int i = 0; i < end - begin; i++)
+    {
+        double g = maxWeights[i] / maxSum * (1.0 + (coordinates[i] - maxAverage) / data.gamma)
+                 - minWeights[i] / minSum * (1.0 - (coordinates[i] - minAverage) / data.gamma);
+        if (xAxis)
+        {
+            data.pinGradients[begin + i].setX(g);
+        }
+        else
+        {
+            data.pinGradients[begin + i].setY(g);
+        }
+    }
+}
+
+void
+wirelengthKernel(EPlaceData &data, int first, int last)
+{
+    const QVector<int> &netPointers = data.db->netPointers();
+
+    for (int net = first; net < last; net++)
+    {
+        int begin = netPointers[net];
+        int end = netPointers[net + 1];
+        if (end - begin < 2)
+        {
+            for (int pin = begin; pin < end; pin++)
+            {
+                data.pinGradients[pin] = QPointF();
+            }
+            continue;
+        }
+
+        axisGradient(data, begin, end, true);
+        axisGradient(data, begin, end, false);
+
+        double weight = data.db->netWeight(net);
+        for (int pin = begin; pin < end; pin++)
+        {
+            data.pinGradients[pin] *= weight;
+        }
+    }
+}
+
+void
+densityKernel(EPlaceData &data, int first, int last, int chunk)
+{
+    int bins = data.binCount * data.binCount;
+    QVector<double> &map = data.maps[chunk];
+    map.fill(0.0, 2 * bins);
+
+    QVarLengthArray<double, 8> xOverlaps, yOverlaps;
+    for (int cell = first; cell < last; cell++)
+    {
+        QPointF p = (*data.positions)[cell];
+        int i0 = binOverlaps(xOverlaps, p.x(), data.origin.x(), data.cellWidth, data.binWidth, data.binCount);
+        int j0 = binOverlaps(yOverlaps, p.y(), data.origin.y(), data.cellHeight, data.binHeight, data.binCount);
+
+        double *bin = map.data() + ((cell < data.gateCount) ? 0 : bins);
+        double density = data.cellDensity * cellCharge(data, cell);
+        for (int j = 0; j < yOverlaps.size(); j++)
+        {
+            for (int i = 0; i < xOverlaps.size(); i++)
+            {
+                bin[(j0 + j) * data.binCount + i0 + i] += density * xOverlaps[i] * yOverlaps[j];
+            }
+        }
+    }
+}
+
+/*
+ * Gradient of a cell: wirelength gradients of its pins, the field of the
+ * bins it covers, scaled by the inverse of the diagonal of the Hessian
+ * (pin count plus the weighted charge).
+ */
+void
+gradientKernel(EPlaceData &data, int first, int last, int chunk)
+{
+    double wirelengthNorm = 0.0;
+    double densityNorm = 0.0;
+
+    QVarLengthArray<double, 8> xOverlaps, yOverlaps;
+    for (int cell = first; cell < last; cell++)
+    {
+        QPointF wirelength;
+        int pins = 0;
+        if (cell < data.gateCount)
+        {
+            for (int i = data.gatePinPointers[cell]; i < data.gatePinPointers[cell + 1]; i++)
+            {
+                wirelength += data.pinGradients[data.gatePins[i]];
+            }
+            pins = data.gatePinPointers[cell + 1] - data.gatePinPointers[cell];
+        }
+
+        QPointF p = (*data.positions)[cell];
+        int i0 = binOverlaps(xOverlaps, p.x(), data.origin.x(), data.cellWidth, data.binWidth, data.binCount);
+        int j0 = binOverlaps(yOverlaps, p.y(), data.origin.y(), data.cellHeight, data.binHeight, data.binCount);
+
+        // Energy decreases along the field
+        QPointF density;
+        double cellDensity = data.cellDensity * cellCharge(data, cell);
+        for (int j = 0; j < yOverlaps.size(); j++)
+        {
+            for (int i = 0; i < xOverlaps.size(); i++)
+            {
+                int bin = (j0 + j) * data.binCount + i0 + i;
+                double charge = cellDensity * xOverlaps[i] * yOverlaps[j];
+                density -= QPointF(data.fieldX[bin], data.fieldY[bin]) * charge;
+            }
+        }
+
+        wirelengthNorm += qAbs(wirelength.x()) + qAbs(wirelength.y());
+        densityNorm += qAbs(density.x()) + qAbs(density.y());
+
+        double area = cellDensity * data.cellWidth * data.cellHeight;
+        double hessian = qMax(1.0, pins + data.lambda * area);
+        (*data.gradient)[cell] = (wirelength + density * data.lambda) / hessian;
+    }
+
+    data.wirelengthNorms[chunk] = wirelengthNorm;
+    data.densityNorms[chunk] = densityNorm;
+}
+
+class KernelTask : public QRunnable
+{
+public:
+    enum Kernel
+    {
+        Wirelength,
+        Density,
+        Gradient
+    };
+
+    KernelTask(EPlaceData &data, Kernel kernel, int first, int last, int chunk)
+        : m_data(data), m_kernel(kernel), m_first(first), m_last(last), m_chunk(chunk)
+    {
+    }
+
+    virtual void
+    run()
+    {
+        switch (m_kernel)
+        {
+        case Wirelength:
+            wirelengthKernel(m_data, m_first, m_last);
+            break;
+        case Density:
+            densityKernel(m_data, m_first, m_last, m_chunk);
+            break;
+        case Gradient:
+            gradientKernel(m_data, m_first, m_last, m_chunk);
+            break;
+        }
+    }
+
+private:
+    EPlaceData &m_data;
+    Kernel m_kernel;
+    int m_first, m_last;
+    int m_chunk;
+};
+
+// Returns the number of chunks
+int
+runKernel(EPlaceData &data, KernelTask::Kernel kernel, int count)
+{
+    int chunks = qBound(1, count / minChunkSize, maxChunks);
+    int chunkSize = (count + chunks - 1) / chunks;
+
+    if (data.pool == 0)
+    {
+        for (int chunk = 0; chunk < chunks; chunk++)
+        {
+            KernelTask(data, kernel, chunk * chunkSize, qMin(count, (chunk + 1) * chunkSize), chunk).run();
+        }
+        return chunks;
+    }
+
+    TaskGroup group(data.pool);
+    for (int chunk = 0; chunk < chunks; chunk++)
+    {
+        group.run(new KernelTask(data, kernel, chunk * chunkSize, qMin(count, (chunk + 1) * chunkSize), chunk));
+    }
+    group.wait();
+    return chunks;
+}
+
+/*
+ * Preconditioned gradient at the positions, returns the overflow of the gates.
+ * The smoothing length of the wirelength follows the overflow (ePlace).
+ */
+double
+evaluate(EPlaceData &data, const QVector<QPointF> &positions, QVector<QPointF> &gradient)
+{
+    data.positions = &positions;
+    data.gradient = &gradient;
+
+    int bins = data.binCount * data.binCount;
+    int chunks = runKernel(data, KernelTask::Density, data.cellCount);
+
+    double binArea = data.binWidth * data.binHeight;
+    double overflow = 0.0;
+    data.density.fill(0.0, bins);
+    for (int bin = 0; bin < bins; bin++)
+    {
+        double gates = 0.0;
+        double fillers = 0.0;
+        for (int chunk = 0; chunk < chunks; chunk++)
+        {
+            gates += data.maps[chunk][bin];
+            fillers += data.maps[chunk][bins + bin];
+        }
+        overflow += qMax(0.0, gates - data.targetDensity * binArea);
+        data.density[bin] = (gates + fillers) / binArea;
+    }
+    overflow /= data.gateArea;
+
+    data.solver->solve(data.density, data.fieldX, data.fieldY);
+
+    double binSize = (data.binWidth + data.binHeight) / 2;
+    data.gamma = 8.0 * binSize * pow(10.0, (20.0 * qMin(overflow, 1.0) - 11.0) / 9.0);
+    runKernel(data, KernelTask::Wirelength, data.db->netCount());
+
+    runKernel(data, KernelTask::Gradient, data.cellCount);
+    return overflow;
+}
+
+double
+norm(const QVector<QPointF> &a, const QVector<QPointF> &b)
+{
+    double sum = 0.0;
+    for (int i = 0; i < a.size(); i++)
+    {
+        QPointF d = a[i] - b[i];
+        sum += d.x() * d.x() + d.y() * d.y();
+    }
+    return sqrt(sum);
+}
+
+double
+hpwl(const EPlaceData &data, const QVector<QPointF> &positions)
+{
+    const QVector<int> &netPointers = data.db->netPointers();
+    const QVector<int> &pinCells = data.db->pinCells();
+
+    double total = 0.0;
+    for (int net = 0; net < data.db->netCount(); net++)
+    {
+        if (netPointers[net + 1] - netPointers[net] < 2) continue;
+
+        QPointF min, max;
+        for (int pin = netPointers[net]; pin < netPointers[net + 1]; pin++)
+        {
+            int cell = pinCells[pin];
+            QPointF p = data.db->isGate(cell) ? positions[cell] : data.db->positions()[cell];
+            if (pin == netPointers[net])
+            {
+                min = max = p;
+                continue;
+            }
+            min = QPointF(qMin(min.x(), p.x()), qMin(min.y(), p.y()));
+            max = QPointF(qMax(max.x(), p.x()), qMax(max.y(), p.y()));
+        }
+        total += (max.x() - min.x()) + (max.y() - min.y());
+    }
+    return total;
+}
+
+void
+readRegion(EPlaceData &data, const PlacementJob *placementJob)
+{
+    // Sites of legalize(), site 0 is centered at min + blockSize / 2
+    Vector<int> min = placementJob->minCoordinates();
+    Vector<int> max = placementJob->maxCoordinates();
+    int xBlocks = (max.x - min.x + 1) / legalizationBlockSize;
+    int zBlocks = (max.z - min.z + 1) / legalizationBlockSize;
+
+    double siteOffset = legalizationBlockSize / 2 - legalizationBlockSize / 2.0;
+    data.origin = QPointF(min.x + siteOffset, min.z + siteOffset);
+    data.size = QSizeF(xBlocks * legalizationBlockSize, zBlocks * legalizationBlockSize);
+
+    // Gates stacked on tiers share the area of a site
+    double siteArea = legalizationBlockSize * legalizationBlockSize / double(placementJob->tierCount());
+    double regionArea = data.size.width() * data.size.height();
+    data.targetDensity = placementJob->targetDensity();
+
+    // Inflation is scaled down to the area left at the target density
+    double inflation = 0.0;
+    foreach (double charge, data.gateCharges)
+    {
+        inflation += (charge - 1.0) * siteArea;
+    }
+    double freeArea = data.targetDensity * regionArea - data.gateCount * siteArea;
+    if (inflation > freeArea)
+    {
+        double scale = qMax(0.0, freeArea) / inflation;
+        for (int gate = 0; gate < data.gateCount; gate++)
+        {
+            data.gateCharges[gate] = 1.0 + (data.gateCharges[gate] - 1.0) * scale;
+        }
+    }
+
+    data.gateArea = 0.0;
+    foreach (double charge, data.gateCharges)
+    {
+        data.gateArea += charge * siteArea;
+    }
+
+    int fillers = qMax(0, int((data.targetDensity * regionArea - data.gateArea) / siteArea));
+    data.cellCount = data.gateCount + fillers;
+
+    data.binCount = minBinCount;
+    while ((data.binCount < maxBinCount) && (4 * data.binCount * data.binCount <= data.cellCount))
+    {
+        data.binCount *= 2;
+    }
+    data.binWidth = data.size.width() / data.binCount;
+    data.binHeight = data.size.height() / data.binCount;
+
+    // Inflated cells keep their area
+    data.cellWidth = qMax(double(legalizationBlockSize), M_SQRT2 * data.binWidth);
+    data.cellHeight = qMax(double(legalizationBlockSize), M_SQRT2 * data.binHeight);
+    data.cellDensity = siteArea / (data.cellWidth * data.cellHeight);
+}
+
+void
+readPins(EPlaceData &data)
+{
+    const QVector<int> &netPointers = data.db->netPointers();
+    const QVector<int> &pinCells = data.db->pinCells();
+
+    data.gatePinPointers.fill(0, data.gateCount + 1);
+    foreach (int cell, pinCells)
+    {
+        if (data.db->isGate(cell)) data.gatePinPointers[cell + 1]++;
+    }
+    for (int gate = 0; gate < data.gateCount; gate++)
+    {
+        data.gatePinPointers[gate + 1] += data.gatePinPointers[gate];
+    }
+
+    QVector<int> fill = data.gatePinPointers;
+    data.gatePins.resize(data.gatePinPointers[data.gateCount]);
+    for (int net = 0; net < data.db->netCount(); net++)
+    {
+        for (int pin = netPointers[net]; pin < netPointers[net + 1]; pin++)
+        {
+            int cell = pinCells[pin];
+            if (data.db->isGate(cell)) data.gatePins[fill[cell]++] = pin;
+        }
+    }
+}
+
+/*
+ * Gates start from the QP solution, slightly spread so that equal
+ * positions separate. Fillers are spread over the region. Both streams
+ * follow the seed of the job.
+ */
+void
+initialPositions(QVector<QPointF> &positions, const EPlaceData &data, quint32 seed)
+{
+    Random random(mixSeed(seed, data.cellCount));
+
+    positions.resize(data.cellCount);
+    for (int cell = 0; cell < data.cellCount; cell++)
+    {
+        QPointF p;
+        if (cell < data.gateCount)
+        {
+            p = data.db->positions()[cell];
+            p += QPointF(random.uniform() - 0.5, random.uniform() - 0.5) * data.binWidth;
+        }
+        else
+        {
+            p = data.origin + QPointF(random.uniform() * data.size.width(), random.uniform() * data.size.height());
+        }
+        positions[cell] = clampCell(data, p);
+    }
+}
+
+void
+savePlacement(NetPlacement &placement, const EPlaceData &data, const QVector<QPointF> &positions)
+{
+    for (int gate = 0; gate < data.gateCount; gate++)
+    {
+        QPointF p = positions[gate];
+
+        GatePlacement gp(p.x(), 0, p.y());
+        placement[data.db->cellName(gate)] = gp;
+    }
+}
+
+/*
+ * Nesterov's method with the step from the local Lipschitz estimate:
+ * u is the solution, v the reference point where the gradient is taken.
+ */
+NetPlacement
+placeElectrostatic(const Netlist *netlist, const PlacementJob *placementJob, const GateInflation &inflation, const NetWeights &netWeights,
+                   int start)
+{
+    NetPlacement placement;
+
+    QScopedPointer<PlacementDb> db(PlacementDb::build(netlist));
+    if (db.isNull())
+    {
+        qWarning("Can't initialize electrostatic placement");
+        return placement;
+    }
+    if (db->gateCount() == 0) return placement;
+    db->netWeights() = netWeights;
+
+    solveGlobalQP(db.data(), placementJob);
+
+    EPlaceData data;
+    data.db = db.data();
+    data.gateCount = db->gateCount();
+    data.gateCharges.resize(data.gateCount);
+    for (int gate = 0; gate < data.gateCount; gate++)
+    {
+        data.gateCharges[gate] = inflation.value(db->cellName(gate), 1.0);
+    }
+    readRegion(data, placementJob);
+    readPins(data);
+
+    int threads = placementJob->threadCount();
+    if (threads <= 0)
+    {
+        threads = QThread::idealThreadCount();
+    }
+    TaskPool pool(threads);
+    data.pool = (pool.threadCount() > 1) ? &pool : 0;
+
+    PoissonSolver solver(data.binCount);
+    solver.setBinSize(data.binWidth, data.binHeight);
+    solver.setPool(data.pool);
+    data.solver = &solver;
+
+    data.pinGradients.resize(db->pinCount());
+    data.maps.resize(maxChunks);
+    data.wirelengthNorms.resize(maxChunks);
+    data.densityNorms.resize(maxChunks);
+    data.lambda = 0.0;
+
+    QVector<QPointF> u;
+    initialPositions(u, data, placementJob->seed() + start);
+    QVector<QPointF> v = u;
+    QVector<QPointF> g(data.cellCount);
+    double overflow = evaluate(data, v, g);
+
+    double wirelengthNorm = 0.0, densityNorm = 0.0;
+    for (int chunk = 0; chunk < maxChunks; chunk++)
+    {
+        wirelengthNorm += data.wirelengthNorms[chunk];
+        densityNorm += data.densityNorms[chunk];
+    }
+    data.lambda = (densityNorm > 0.0) ? initialDensityWeight * wirelengthNorm / densityNorm : 1.0;
+    overflow = evaluate(data, v, g);
+
+    // Reference point of the first step estimate
+    double maxGradient = 0.0;
+    foreach (const QPointF &d, g)
+    {
+        maxGradient = qMax(maxGradient, qMax(qAbs(d.x()), qAbs(d.y())));
+    }
+    QVector<QPointF> vPrevious(data.cellCount);
+    for (int cell = 0; cell < data.cellCount; cell++)
+    {
+        double step = (maxGradient > 0.0) ? initialStep * data.binWidth / maxGradient : 0.0;
+        vPrevious[cell] = clampCell(data, v[cell] - g[cell] * step);
+    }
+    QVector<QPointF> gPrevious(data.cellCount);
+    evaluate(data, vPrevious, gPrevious);
+
+    double a = 1.0;
+    int iteration = 0;
+    while ((iteration < placementJob->globalIterations()) && (overflow > placementJob->targetOverflow()))
+    {
+        iteration++;
+
+        double gradientChange = norm(g, gPrevious);
+        double alpha = (gradientChange > 0.0) ? norm(v, vPrevious) / gradientChange : 0.0;
+        double aNext = (1.0 + sqrt(4.0 * a * a + 1.0)) / 2;
+
+        for (int cell = 0; cell < data.cellCount; cell++)
+        {
+            QPointF uNext = clampCell(data, v[cell] - g[cell] * alpha);
+            vPrevious[cell] = v[cell];
+            v[cell] = clampCell(data, uNext + (uNext - u[cell]) * ((a - 1.0) / aNext));
+            u[cell] = uNext;
+        }
+        a = aNext;
+
+        qSwap(g, gPrevious);
+        data.lambda *= densityWeightGrowth;
+        overflow = evaluate(data, v, g);
+    }
+
+    qDebug("Electrostatic placement: %d iterations, overflow %0.3f, HPWL %0.0f", iteration, overflow, hpwl(data, u));
+
+    savePlacement(placement, data, u);
+
+    return placement;
+}
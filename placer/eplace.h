@@ -0,0 +1,22 @@
+#ifndef EPLACE_H
+#define EPLACE_H
+
+#include "placement.h"
+
+class Netlist;
+class PlacementJob;
+
+/*
+ * Electrostatic global placement (ePlace, Lu et al.): alternative to placeQuad().
+ * Gates are charges, the density penalty is their potential energy, which
+ * follows from the Poisson equation. Weighted-average wirelength plus the
+ * penalty is minimized with Nesterov's method until the bin overflow is low.
+ * Inflated gates take more room, wirelength of the nets is scaled by their weights.
+ * Start start spreads the initial positions with the seed seed() + start.
+ */
+NetPlacement
+placeElectrostatic(const Netlist *netlist, const PlacementJob *placementJob,
+                   const GateInflation &inflation = GateInflation(), const NetWeights &netWeights = NetWeights(),
+                   int start = 0);
+
+#endif // EPLACE_H
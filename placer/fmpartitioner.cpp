@@ -0,0 +1,442 @@
+#include "fmpartitioner.h"
+#include "clustering.h"
+
+namespace
+{
+
+// Coarsening stops when a level removes less than this fraction of cells
+const double minCoarseningRatio = 0.1;
+
+// Clusters never mix sides
+class SideFilter : public MatchingFilter
+{
+public:
+    SideFilter(const QVector<int> &sides)
+        : m_sides(sides)
+    {
+    }
+
+    virtual bool
+    canPair(int cell, int other) const
+    {
+        return m_sides[cell] == m_sides[other];
+    }
+
+private:
+    const QVector<int> &m_sides;
+};
+
+/*
+ * Cells sorted by gain, one doubly linked list per gain value.
+ */
+class GainBuckets
+{
+public:
+    GainBuckets(int cellCount, int maxGain)
+        : m_maxGain(maxGain), m_top(-1)
+    {
+        m_heads.fill(-1, 2 * maxGain + 1);
+        m_next.fill(-1, cellCount);
+        m_prev.fill(-1, cellCount);
+    }
+
+    void
+    insert(int cell, int gain)
+    {
+        int index = gain + m_maxGain;
+        m_prev[cell] = -1;
+        m_next[cell] = m_heads[index];
+        if (m_heads[index] >= 0) m_prev[m_heads[index]] = cell;
+        m_heads[index] = cell;
+        if (index > m_top) m_top = index;
+    }
+
+    void
+    remove(int cell, int gain)
+    {
+        int index = gain + m_maxGain;
+        if (m_prev[cell] >= 0) m_next[m_prev[cell]] = m_next[cell];
+        else m_heads[index] = m_next[cell];
+        if (m_next[cell] >= 0) m_prev[m_next[cell]] = m_prev[cell];
+    }
+
+    // Returns -1 if empty
+    int
+    top(int &gain)
+    {
+        while ((m_top >= 0) && (m_heads[m_top] < 0)) m_top--;
+        if (m_top < 0) return -1;
+
+        gain = m_top - m_maxGain;
+        return m_heads[m_top];
+    }
+
+private:
+    int m_maxGain;
+    int m_top;
+    QVector<int> m_heads;
+    QVector<int> m_next;
+    QVector<int> m_prev;
+};
+
+}
+
+int
+Hypergraph::cellCount() const
+{
+    return weights.size();
+}
+
+int
+Hypergraph::netCount() const
+{
+    return netPointers.isEmpty() ? 0 : netPointers.size() - 1;
+}
+
+FmPartitioner::FmPartitioner()
+{
+    m_maxPasses = 4;
+    m_tolerance = 0.1;
+    m_coarseningThreshold = 0;
+}
+
+void
+FmPartitioner::setMaxPasses(int maxPasses)
+{
+    m_maxPasses = maxPasses;
+}
+
+void
+FmPartitioner::setTolerance(double tolerance)
+{
+    m_tolerance = tolerance;
+}
+
+void
+FmPartitioner::setCoarseningThreshold(int threshold)
+{
+    m_coarseningThreshold = threshold;
+}
+
+int
+FmPartitioner::refine(const Hypergraph &graph, QVector<int> &sides) const
+{
+    Q_ASSERT(sides.size() == graph.cellCount());
+
+    if (graph.cellCount() < 2) return cutSize(graph, sides);
+
+    double total = 0.0;
+    double weight0 = 0.0;
+    double minCell = graph.weights[0];
+    double maxCell = graph.weights[0];
+    for (int cell = 0; cell < graph.cellCount(); cell++)
+    {
+        double w = graph.weights[cell];
+        total += w;
+        if (sides[cell] == 0) weight0 += w;
+        minCell = qMin(minCell, w);
+        maxCell = qMax(maxCell, w);
+    }
+
+    // Neither side may become empty
+    double slack = qMax(m_tolerance * total, maxCell);
+    double minWeight = qMax(weight0 - slack, minCell);
+    double maxWeight = qMin(weight0 + slack, total - minCell);
+
+    refineLevel(graph, sides, minWeight, maxWeight, slack);
+
+    return cutSize(graph, sides);
+}
+
+int
+FmPartitioner::cutSize(const Hypergraph &graph, const QVector<int> &sides)
+{
+    int cut = 0;
+    for (int net = 0; net < graph.netCount(); net++)
+    {
+        bool used[2] = {graph.fixedCounts[0][net] > 0, graph.fixedCounts[1][net] > 0};
+        for (int pin = graph.netPointers[net]; pin < graph.netPointers[net + 1]; pin++)
+        {
+            used[sides[graph.netCells[pin]]] = true;
+        }
+        if (used[0] && used[1]) cut++;
+    }
+    return cut;
+}
+
+void
+FmPartitioner::refineLevel(const Hypergraph &graph, QVector<int> &sides, double minWeight, double maxWeight, double maxClusterWeight) const
+{
+    QVector<int> cellNetPointers;
+    QVector<int> cellNets;
+    transpose(graph, cellNetPointers, cellNets);
+
+    if ((m_coarseningThreshold > 0) && (graph.cellCount() >= m_coarseningThreshold))
+    {
+        Hypergraph coarse;
+        QVector<int> clusters;
+        if (coarsen(graph, sides, cellNetPointers, cellNets, maxClusterWeight, coarse, clusters))
+        {
+            // Clusters never mix sides, so the initial partition is kept
+            QVector<int> coarseSides(coarse.cellCount());
+            for (int cell = 0; cell < graph.cellCount(); cell++)
+            {
+                coarseSides[clusters[cell]] = sides[cell];
+            }
+
+            refineLevel(coarse, coarseSides, minWeight, maxWeight, maxClusterWeight);
+
+            for (int cell = 0; cell < graph.cellCount(); cell++)
+            {
+                sides[cell] = coarseSides[clusters[cell]];
+            }
+        }
+    }
+
+    for (int pass = 0; pass < m_maxPasses; pass++)
+    {
+        if (!runPass(graph, cellNetPointers, cellNets, sides, minWeight, maxWeight)) break;
+    }
+}
+
+/*
+ * One FM pass. Returns true if the cut has been reduced.
+ */
+bool
+FmPartitioner::runPass(const Hypergraph &graph, const QVector<int> &cellNetPointers, const QVector<int> &cellNets,
+                       QVector<int> &sides, double minWeight, double maxWeight) const
+{
+    int n = graph.cellCount();
+
+    // Pins of every net on each side, fixed terminals included
+    QVector<int> counts[2] = {graph.fixedCounts[0], graph.fixedCounts[1]};
+    for (int net = 0; net < graph.netCount(); net++)
+    {
+        for (int pin = graph.netPointers[net]; pin < graph.netPointers[net + 1]; pin++)
+        {
+            counts[sides[graph.netCells[pin]]][net]++;
+        }
+    }
+
+    double weight0 = 0.0;
+    int maxDegree = 0;
+    for (int cell = 0; cell < n; cell++)
+    {
+        if (sides[cell] == 0) weight0 += graph.weights[cell];
+        maxDegree = qMax(maxDegree, cellNetPointers[cell + 1] - cellNetPointers[cell]);
+    }
+
+    // Gain of a move: nets which stop being cut minus nets which become cut
+    QVector<int> gains(n, 0);
+    for (int cell = 0; cell < n; cell++)
+    {
+        int from = sides[cell];
+        int to = 1 - from;
+        for (int i = cellNetPointers[cell]; i < cellNetPointers[cell + 1]; i++)
+        {
+            int net = cellNets[i];
+            if (counts[from][net] == 1) gains[cell]++;
+            if (counts[to][net] == 0) gains[cell]--;
+        }
+    }
+
+    GainBuckets buckets[2] = {GainBuckets(n, maxDegree), GainBuckets(n, maxDegree)};
+    for (int cell = 0; cell < n; cell++)
+    {
+        buckets[sides[cell]].insert(cell, gains[cell]);
+    }
+
+    QVector<bool> locked(n, false);
+    QVector<int> moves;
+    moves.reserve(n);
+
+    int gain = 0;
+    int bestGain = 0;
+    int bestMoves = 0;
+    double center = (minWeight + maxWeight) / 2;
+    double bestImbalance = qAbs(weight0 - center);
+
+    // Long runs of moves without improvement rarely pay off
+    int maxUselessMoves = qMax(100, n / 4);
+
+    while (moves.size() - bestMoves <= maxUselessMoves)
+    {
+        int cell = -1;
+        int cellGain = 0;
+        for (int side = 0; side < 2; side++)
+        {
+            int candidateGain;
+            int candidate = buckets[side].top(candidateGain);
+            if (candidate < 0) continue;
+
+            double w = graph.weights[candidate];
+            bool feasible = (side == 0) ? (weight0 - w >= minWeight) : (weight0 + w <= maxWeight);
+            if (!feasible) continue;
+
+            if ((cell < 0) || (candidateGain > cellGain))
+            {
+                cell = candidate;
+                cellGain = candidateGain;
+            }
+        }
+        if (cell < 0) break;
+
+        int from = sides[cell];
+        int to = 1 - from;
+
+        buckets[from].remove(cell, gains[cell]);
+        locked[cell] = true;
+
+        /* Gain updates of the classic FM algorithm, before and after the move.  */
+        for (int i = cellNetPointers[cell]; i < cellNetPointers[cell + 1]; i++)
+        {
+            int net = cellNets[i];
+            int first = graph.netPointers[net];
+            int last = graph.netPointers[net + 1];
+
+            int delta[2] = {0, 0};
+            if (counts[to][net] == 0)
+            {
+                delta[from] = 1;
+            }
+            else if (counts[to][net] == 1)
+            {
+                delta[to] = -1;
+            }
+
+            counts[from][net]--;
+            counts[to][net]++;
+
+            int deltaAfter[2] = {0, 0};
+            if (counts[from][net] == 0)
+            {
+                deltaAfter[to] = -1;
+            }
+            else if (counts[from][net] == 1)
+            {
+                deltaAfter[from] = 1;
+            }
+
+            if (!delta[0] && !delta[1] && !deltaAfter[0] && !deltaAfter[1]) continue;
+
+            for (int pin = first; pin < last; pin++)
+            {
+                int other = graph.netCells[pin];
+                if (locked[other]) continue;
+
+                int side = sides[other];
+                int d = delta[side] + deltaAfter[side];
+                if (d == 0) continue;
+
+                buckets[side].remove(other, gains[other]);
+                gains[other] += d;
+                buckets[side].insert(other, gains[other]);
+            }
+        }
+
+        sides[cell] = to;
+        weight0 += (to == 0) ? graph.weights[cell] : -graph.weights[cell];
+        moves.append(cell);
+
+        gain += cellGain;
+        double imbalance = qAbs(weight0 - center);
+        if ((gain > bestGain) || ((gain == bestGain) && (imbalance < bestImbalance)))
+        {
+            bestGain = gain;
+            bestMoves = moves.size();
+            bestImbalance = imbalance;
+        }
+    }
+
+    // Roll back moves after the best prefix
+    for (int i = moves.size() - 1; i >= bestMoves; i--)
+    {
+        sides[moves[i]] = 1 - sides[moves[i]];
+    }
+
+    return bestGain > 0;
+}
+
+/*
+ * Matches every cell with the unmatched neighbour of the same side it shares
+ * the most small nets with. Returns false if the level would be too small a step.
+ */
+bool
+FmPartitioner::coarsen(const Hypergraph &graph, const QVector<int> &sides, const QVector<int> &cellNetPointers, const QVector<int> &cellNets,
+                       double maxClusterWeight, Hypergraph &coarse, QVector<int> &clusters)
+{
+    int n = graph.cellCount();
+
+    SideFilter filter(sides);
+    int coarseCount = matchCells(graph.netPointers, graph.netCells, cellNetPointers, cellNets, graph.weights, n,
+                                 maxClusterWeight, false, &filter, clusters);
+
+    if (coarseCount > (1.0 - minCoarseningRatio) * n) return false;
+
+    coarse.weights.fill(0.0, coarseCount);
+    for (int cell = 0; cell < n; cell++)
+    {
+        coarse.weights[clusters[cell]] += graph.weights[cell];
+    }
+
+    coarse.netPointers.clear();
+    coarse.netCells.clear();
+    coarse.fixedCounts[0].clear();
+    coarse.fixedCounts[1].clear();
+    coarse.netPointers.append(0);
+
+    QVector<int> marks(coarseCount, -1);
+    for (int net = 0; net < graph.netCount(); net++)
+    {
+        int start = coarse.netCells.size();
+        for (int pin = graph.netPointers[net]; pin < graph.netPointers[net + 1]; pin++)
+        {
+            int cluster = clusters[graph.netCells[pin]];
+            if (marks[cluster] == net) continue;
+
+            marks[cluster] = net;
+            coarse.netCells.append(cluster);
+        }
+
+        // Nets inside a cluster can't be cut
+        int fixed = graph.fixedCounts[0][net] + graph.fixedCounts[1][net];
+        int size = coarse.netCells.size() - start;
+        if ((size == 0) || ((size == 1) && (fixed == 0)))
+        {
+            coarse.netCells.resize(start);
+            continue;
+        }
+
+        coarse.netPointers.append(coarse.netCells.size());
+        coarse.fixedCounts[0].append(graph.fixedCounts[0][net]);
+        coarse.fixedCounts[1].append(graph.fixedCounts[1][net]);
+    }
+
+    return true;
+}
+
+void
+FmPartitioner::transpose(const Hypergraph &graph, QVector<int> &cellNetPointers, QVector<int> &cellNets)
+{
+    int n = graph.cellCount();
+
+    cellNetPointers.fill(0, n + 1);
+    foreach (int cell, graph.netCells)
+    {
+        cellNetPointers[cell + 1]++;
+    }
+    for (int cell = 0; cell < n; cell++)
+    {
+        cellNetPointers[cell + 1] += cellNetPointers[cell];
+    }
+
+    QVector<int> fill = cellNetPointers;
+    cellNets.resize(graph.netCells.size());
+    for (int net = 0; net < graph.netCount(); net++)
+    {
+        for (int pin = graph.netPointers[net]; pin < graph.netPointers[net + 1]; pin++)
+        {
+            cellNets[fill[graph.netCells[pin]]++] = net;
+        }
+    }
+}
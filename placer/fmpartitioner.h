@@ -0,0 +1,80 @@
+#ifndef FMPARTITIONER_H
+#define FMPARTITIONER_H
+
+#include <QVector>
+
+/*
+ * Hypergraph for bisection.
+ * Pins of net n are cells[netPointers[n]; netPointers[n + 1]), a cell appears
+ * in a net at most once. Fixed terminals of a net never move, they only pull
+ * its cells towards their side.
+ */
+struct Hypergraph
+{
+    QVector<double> weights;     // cell -> weight
+    QVector<int> netPointers;
+    QVector<int> netCells;
+    QVector<int> fixedCounts[2]; // net -> number of fixed terminals on side 0 and side 1
+
+    int
+    cellCount() const;
+
+    int
+    netCount() const;
+};
+
+/*
+ * Fiduccia-Mattheyses refinement of a bisection.
+ *
+ * Every pass moves each cell at most once, best gain first (bucket lists),
+ * and keeps the best prefix of the moves. The weight of side 0 may move away
+ * from its initial value by tolerance * total weight (at least by the
+ * heaviest cell).
+ *
+ * Large hypergraphs can be coarsened first: cells of the same side are
+ * matched along small nets, the coarsest level is refined and the result is
+ * projected back and refined again at every level.
+ */
+class FmPartitioner
+{
+public:
+    FmPartitioner();
+
+    void
+    setMaxPasses(int maxPasses);
+
+    void
+    setTolerance(double tolerance);
+
+    // Hypergraphs with at least this number of cells are coarsened, 0 disables coarsening
+    void
+    setCoarseningThreshold(int threshold);
+
+    // sides[cell] is 0 or 1, initial partition on input; returns the cut size
+    int
+    refine(const Hypergraph &graph, QVector<int> &sides) const;
+
+    static int
+    cutSize(const Hypergraph &graph, const QVector<int> &sides);
+
+private:
+    void
+    refineLevel(const Hypergraph &graph, QVector<int> &sides, double minWeight, double maxWeight, double maxClusterWeight) const;
+
+    bool
+    runPass(const Hypergraph &graph, const QVector<int> &cellNetPointers, const QVector<int> &cellNets, QVector<int> &sides, double minWeight, double maxWeight) const;
+
+    static bool
+    coarsen(const Hypergraph &graph, const QVector<int> &sides, const QVector<int> &cellNetPointers, const QVector<int> &cellNets,
+            double maxClusterWeight, Hypergraph &coarse, QVector<int> &clusters);
+
+    static void
+    transpose(const Hypergraph &graph, QVector<int> &cellNetPointers, QVector<int> &cellNets);
+
+private:
+    int m_maxPasses;
+    double m_tolerance;
+    int m_coarseningThreshold;
+};
+
+#endif // FMPARTITIONER_H
@@ -0,0 +1,437 @@
+#include "hpwlengine.h"
+#include "common/netlist.h"
+#include "common/celllibrary.h"
+#include <QScopedPointer>
+
+static inline int
+component(const Vector<int> &v, int axis)
+{
+    return (axis == 0) ? v.x : ((axis == 1) ? v.y : v.z);
+}
+
+HpwlEngine::HpwlEngine()
+{
+    m_library = 0;
+    m_hpwl = 0;
+}
+
+int
+HpwlEngine::itemCount() const
+{
+    return m_itemNames.size();
+}
+
+QString
+HpwlEngine::itemName(int item) const
+{
+    return m_itemNames[item];
+}
+
+int
+HpwlEngine::itemIndex(const QString &name) const
+{
+    return m_itemIndexes.value(name, -1);
+}
+
+Vector<int>
+HpwlEngine::position(int item) const
+{
+    return m_positions[item];
+}
+
+int
+HpwlEngine::variant(int item) const
+{
+    return m_variants[item];
+}
+
+Vector<int>
+HpwlEngine::dimensions(int item) const
+{
+    return m_library->dimensions(m_itemCells[item]);
+}
+
+int
+HpwlEngine::variantCount(int item) const
+{
+    return m_library->variantCount(m_itemCells[item]);
+}
+
+QString
+HpwlEngine::variantName(int item, int variant) const
+{
+    return m_library->variantName(m_itemCells[item], variant);
+}
+
+int
+HpwlEngine::netCount() const
+{
+    return m_netPointers.size() - 1;
+}
+
+QVector<int>
+HpwlEngine::itemNets(int item) const
+{
+    QVector<int> nets;
+    for (int i = m_itemPinPointers[item]; i < m_itemPinPointers[item + 1]; i++)
+    {
+        int net = m_pinNets[m_itemPins[i]];
+        if (!nets.contains(net)) nets.append(net);
+    }
+    return nets;
+}
+
+int
+HpwlEngine::netPinCount(int net) const
+{
+    return m_netPointers[net + 1] - m_netPointers[net];
+}
+
+void
+HpwlEngine::netBox(int net, Vector<int> &min, Vector<int> &max) const
+{
+    const NetBox &box = m_boxes[net];
+    min = Vector<int>(box.min[0], box.min[1], box.min[2]);
+    max = Vector<int>(box.max[0], box.max[1], box.max[2]);
+}
+
+int
+HpwlEngine::hpwl() const
+{
+    return m_hpwl;
+}
+
+int
+HpwlEngine::moveDelta(int item, const Vector<int> &position) const
+{
+    QVector<PinChange> changes;
+    changeItem(changes, item, position, m_variants[item]);
+    return evaluate(changes, 0, 0);
+}
+
+int
+HpwlEngine::swapDelta(int item1, int item2) const
+{
+    QVector<PinChange> changes;
+    changeItem(changes, item1, m_positions[item2], m_variants[item1]);
+    changeItem(changes, item2, m_positions[item1], m_variants[item2]);
+    return evaluate(changes, 0, 0);
+}
+
+int
+HpwlEngine::variantDelta(int item, int variant) const
+{
+    QVector<PinChange> changes;
+    changeItem(changes, item, m_positions[item], variant);
+    return evaluate(changes, 0, 0);
+}
+
+void
+HpwlEngine::move(int item, const Vector<int> &position)
+{
+    QVector<PinChange> changes;
+    changeItem(changes, item, position, m_variants[item]);
+    apply(changes);
+    m_positions[item] = position;
+}
+
+void
+HpwlEngine::swap(int item1, int item2)
+{
+    QVector<PinChange> changes;
+    changeItem(changes, item1, m_positions[item2], m_variants[item1]);
+    changeItem(changes, item2, m_positions[item1], m_variants[item2]);
+    apply(changes);
+    qSwap(m_positions[item1], m_positions[item2]);
+}
+
+void
+HpwlEngine::setVariant(int item, int variant)
+{
+    QVector<PinChange> changes;
+    changeItem(changes, item, m_positions[item], variant);
+    apply(changes);
+    m_variants[item] = variant;
+}
+
+void
+HpwlEngine::save(Netlist *netlist) const
+{
+    for (int item = 0; item < itemCount(); item++)
+    {
+        netlist->setPosition(m_netlistItems[item], m_positions[item]);
+        netlist->setVariant(m_netlistItems[item], variantName(item, m_variants[item]));
+    }
+}
+
+void
+HpwlEngine::changeItem(QVector<PinChange> &changes, int item, const Vector<int> &position, int variant) const
+{
+    int cell = m_itemCells[item];
+    for (int i = m_itemPinPointers[item]; i < m_itemPinPointers[item + 1]; i++)
+    {
+        PinChange change;
+        change.pin = m_itemPins[i];
+        change.position = position + m_library->portOffset(cell, variant, m_pinPorts[change.pin]);
+        changes.append(change);
+    }
+}
+
+/*
+ * Returns the HPWL change. New boxes of the affected nets are stored
+ * if nets and boxes are given.
+ */
+int
+HpwlEngine::evaluate(const QVector<PinChange> &changes, QVector<int> *nets, QVector<NetBox> *boxes) const
+{
+    QVector<int> affected;
+    foreach (const PinChange &change, changes)
+    {
+        int net = m_pinNets[change.pin];
+        if (!affected.contains(net)) affected.append(net);
+    }
+
+    int delta = 0;
+    foreach (int net, affected)
+    {
+        NetBox box = m_boxes[net];
+        if (!updateBox(box, net, changes))
+        {
+            scanBox(box, net, changes);
+        }
+        delta += boxLength(box) - boxLength(m_boxes[net]);
+
+        if (nets != 0) nets->append(net);
+        if (boxes != 0) boxes->append(box);
+    }
+    return delta;
+}
+
+void
+HpwlEngine::apply(const QVector<PinChange> &changes)
+{
+    QVector<int> nets;
+    QVector<NetBox> boxes;
+    m_hpwl += evaluate(changes, &nets, &boxes);
+
+    for (int i = 0; i < nets.size(); i++)
+    {
+        m_boxes[nets[i]] = boxes[i];
+    }
+    foreach (const PinChange &change, changes)
+    {
+        m_pinPositions[change.pin] = change.position;
+    }
+}
+
+/*
+ * Removes old positions of the changed pins of the net from the box, then
+ * adds the new ones. Fails if a face loses all its pins and no new pin
+ * lands on or beyond it.
+ */
+bool
+HpwlEngine::updateBox(NetBox &box, int net, const QVector<PinChange> &changes) const
+{
+    foreach (const PinChange &change, changes)
+    {
+        if (m_pinNets[change.pin] != net) continue;
+
+        const Vector<int> &old = m_pinPositions[change.pin];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            int c = component(old, axis);
+            if (c == box.min[axis]) box.minCount[axis]--;
+            if (c == box.max[axis]) box.maxCount[axis]--;
+        }
+    }
+
+    foreach (const PinChange &change, changes)
+    {
+        if (m_pinNets[change.pin] != net) continue;
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            int c = component(change.position, axis);
+            if (c < box.min[axis])
+            {
+                box.min[axis] = c;
+                box.minCount[axis] = 1;
+            }
+            else if (c == box.min[axis])
+            {
+                box.minCount[axis]++;
+            }
+
+            if (c > box.max[axis])
+            {
+                box.max[axis] = c;
+                box.maxCount[axis] = 1;
+            }
+            else if (c == box.max[axis])
+            {
+                box.maxCount[axis]++;
+            }
+        }
+    }
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if ((box.minCount[axis] == 0) || (box.maxCount[axis] == 0)) return false;
+    }
+    return true;
+}
+
+void
+HpwlEngine::scanBox(NetBox &box, int net, const QVector<PinChange> &changes) const
+{
+    for (int pin = m_netPointers[net]; pin < m_netPointers[net + 1]; pin++)
+    {
+        Vector<int> p = m_pinPositions[pin];
+        foreach (const PinChange &change, changes)
+        {
+            if (change.pin == pin) p = change.position;
+        }
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            int c = component(p, axis);
+            if ((pin == m_netPointers[net]) || (c < box.min[axis]))
+            {
+                box.min[axis] = c;
+                box.minCount[axis] = 1;
+            }
+            else if (c == box.min[axis])
+            {
+                box.minCount[axis]++;
+            }
+
+            if ((pin == m_netPointers[net]) || (c > box.max[axis]))
+            {
+                box.max[axis] = c;
+                box.maxCount[axis] = 1;
+            }
+            else if (c == box.max[axis])
+            {
+                box.maxCount[axis]++;
+            }
+        }
+    }
+}
+
+int
+HpwlEngine::boxLength(const NetBox &box)
+{
+    return (box.max[0] - box.min[0]) + (box.max[1] - box.min[1]) + (box.max[2] - box.min[2]);
+}
+
+HpwlEngine *
+HpwlEngine::build(const Netlist *netlist, const CellLibrary *library)
+{
+    QScopedPointer<HpwlEngine> engine(new HpwlEngine());
+    engine->m_library = library;
+
+    /* Netlist item -> item, cell types are resolved once  */
+    QVector<int> items(netlist->itemCount(), -1);
+    QVector<int> cells(netlist->cellTypeCount(), -1);
+    for (int id = 0; id < netlist->itemCount(); id++)
+    {
+        if (netlist->isDeleted(id)) continue;
+
+        int cellType = netlist->cellTypeId(id);
+        int cell = (cellType >= 0) ? cells[cellType] : -1;
+        if ((cell < 0) && (cellType >= 0))
+        {
+            cell = cells[cellType] = library->cellIndex(netlist->cellTypeName(cellType));
+        }
+        if (cell < 0)
+        {
+            qWarning("Can't get variant list for cell %s", qPrintable(netlist->cellType(netlist->itemName(id))));
+            return 0;
+        }
+
+        int variantId = netlist->variantId(id);
+        int variant = (variantId >= 0) ? library->variantIndex(cell, netlist->variantName(variantId)) : -1;
+        if (variant < 0)
+        {
+            qWarning("Can't get variant for item %s", qPrintable(netlist->itemName(id)));
+            return 0;
+        }
+
+        if (!netlist->hasPosition(id))
+        {
+            qWarning("Can't get position for item %s", qPrintable(netlist->itemName(id)));
+            return 0;
+        }
+
+        items[id] = engine->m_itemNames.size();
+        engine->m_itemIndexes[netlist->itemName(id)] = items[id];
+        engine->m_itemNames.append(netlist->itemName(id));
+        engine->m_netlistItems.append(id);
+        engine->m_itemCells.append(cell);
+        engine->m_variants.append(variant);
+        engine->m_positions.append(netlist->position(id));
+    }
+
+    /* Net -> pins, items deleted from the netlist are skipped  */
+    engine->m_netPointers.append(0);
+    for (int net = 0; net < netlist->netCount(); net++)
+    {
+        for (int pin = netlist->netPinBegin(net); pin < netlist->netPinEnd(net); pin++)
+        {
+            int item = items[netlist->pinItem(pin)];
+            if (item < 0) continue;
+
+            int cell = engine->m_itemCells[item];
+            int port = library->portIndex(cell, netlist->pinPort(pin));
+            if (port < 0)
+            {
+                qWarning("Can't get port %s of cell %s", qPrintable(netlist->pinPort(pin)), qPrintable(library->cellName(cell)));
+                return 0;
+            }
+
+            engine->m_pinItems.append(item);
+            engine->m_pinNets.append(net);
+            engine->m_pinPorts.append(port);
+            engine->m_pinPositions.append(engine->m_positions[item] + library->portOffset(cell, engine->m_variants[item], port));
+        }
+        engine->m_netPointers.append(engine->m_pinItems.size());
+    }
+
+    /* Item -> pins  */
+    int itemCount = engine->itemCount();
+    engine->m_itemPinPointers.fill(0, itemCount + 1);
+    foreach (int item, engine->m_pinItems)
+    {
+        engine->m_itemPinPointers[item + 1]++;
+    }
+    for (int i = 0; i < itemCount; i++)
+    {
+        engine->m_itemPinPointers[i + 1] += engine->m_itemPinPointers[i];
+    }
+
+    QVector<int> fill = engine->m_itemPinPointers;
+    engine->m_itemPins.resize(engine->m_pinItems.size());
+    for (int pin = 0; pin < engine->m_pinItems.size(); pin++)
+    {
+        engine->m_itemPins[fill[engine->m_pinItems[pin]]++] = pin;
+    }
+
+    /* Boxes, empty nets have zero length  */
+    int netCount = engine->m_netPointers.size() - 1;
+    NetBox empty;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        empty.min[axis] = empty.max[axis] = 0;
+        empty.minCount[axis] = empty.maxCount[axis] = 0;
+    }
+    engine->m_boxes.fill(empty, netCount);
+    for (int net = 0; net < netCount; net++)
+    {
+        if (engine->m_netPointers[net] == engine->m_netPointers[net + 1]) continue;
+
+        engine->scanBox(engine->m_boxes[net], net, QVector<PinChange>());
+        engine->m_hpwl += boxLength(engine->m_boxes[net]);
+    }
+
+    return engine.take();
+}
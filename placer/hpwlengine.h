@@ -0,0 +1,157 @@
+#ifndef HPWLENGINE_H
+#define HPWLENGINE_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include "common/vector.h"
+
+class Netlist;
+class CellLibrary;
+
+/*
+ * Incremental half-perimeter wirelength of a placed netlist (x, y and z).
+ *
+ * Absolute pin positions and the bounding box of every net are cached, boxes
+ * also count the pins on each of their faces. Moving, swapping and changing
+ * the variant of items are evaluated and applied in O(pins of the items),
+ * a net is rescanned only if the last pin leaves one of its faces.
+ *
+ * Items are indexed in the order of Netlist::allItems(), variants as in
+ * the library, which must outlive the engine.
+ * Const methods may run concurrently, modifications need exclusive access.
+ */
+class HpwlEngine
+{
+public:
+    int
+    itemCount() const;
+
+    QString
+    itemName(int item) const;
+
+    // -1 if there is no such item
+    int
+    itemIndex(const QString &name) const;
+
+    Vector<int>
+    position(int item) const;
+
+    int
+    variant(int item) const;
+
+    // Dimensions of the cell of the item
+    Vector<int>
+    dimensions(int item) const;
+
+    int
+    variantCount(int item) const;
+
+    QString
+    variantName(int item, int variant) const;
+
+    int
+    netCount() const;
+
+    // Nets the item has pins on, each net once
+    QVector<int>
+    itemNets(int item) const;
+
+    int
+    netPinCount(int net) const;
+
+    // Bounding box of the pins of the net (inclusive)
+    void
+    netBox(int net, Vector<int> &min, Vector<int> &max) const;
+
+public:
+    int
+    hpwl() const;
+
+    // HPWL changes, nothing is modified
+    int
+    moveDelta(int item, const Vector<int> &position) const;
+
+    int
+    swapDelta(int item1, int item2) const;
+
+    int
+    variantDelta(int item, int variant) const;
+
+    void
+    move(int item, const Vector<int> &position);
+
+    // Exchanges positions of two items
+    void
+    swap(int item1, int item2);
+
+    void
+    setVariant(int item, int variant);
+
+public:
+    // Writes positions and variants to the netlist
+    void
+    save(Netlist *netlist) const;
+
+public:
+    static HpwlEngine *
+    build(const Netlist *netlist, const CellLibrary *library);
+
+private:
+    struct NetBox
+    {
+        int min[3], max[3];
+        int minCount[3], maxCount[3];
+    };
+
+    struct PinChange
+    {
+        int pin;
+        Vector<int> position;
+    };
+
+    HpwlEngine();
+
+    void
+    changeItem(QVector<PinChange> &changes, int item, const Vector<int> &position, int variant) const;
+
+    int
+    evaluate(const QVector<PinChange> &changes, QVector<int> *nets, QVector<NetBox> *boxes) const;
+
+    void
+    apply(const QVector<PinChange> &changes);
+
+    bool
+    updateBox(NetBox &box, int net, const QVector<PinChange> &changes) const;
+
+    void
+    scanBox(NetBox &box, int net, const QVector<PinChange> &changes) const;
+
+    static int
+    boxLength(const NetBox &box);
+
+private:
+    QVector<QString> m_itemNames;
+    QHash<QString, int> m_itemIndexes;
+    QVector<int> m_netlistItems;
+    QVector<Vector<int> > m_positions;
+    QVector<int> m_variants;
+    QVector<int> m_itemCells;
+    const CellLibrary *m_library;
+
+    // Pins of item i are m_itemPins[m_itemPinPointers[i]; m_itemPinPointers[i + 1])
+    QVector<int> m_itemPinPointers;
+    QVector<int> m_itemPins;
+
+    // Pins of net n are [m_netPointers[n]; m_netPointers[n + 1])
+    QVector<int> m_netPointers;
+    QVector<int> m_pinItems;
+    QVector<int> m_pinNets;
+    QVector<int> m_pinPorts; // Port indexes of the library
+    QVector<Vector<int> > m_pinPositions;
+
+    QVector<NetBox> m_boxes;
+    int m_hpwl;
+};
+
+#endif // HPWLENGINE_H
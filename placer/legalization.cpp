@@ -1,10 +1,478 @@
 #include "legalization.h"
 #include "common/netlist.h"
+#include "common/celllibrary.h"
 #include "placementjob.h"
+#include <QVector>
+#include <QHash>
+#include <QPointF>
+#include <algorithm>
 #include <math.h>
+#include <float.h>
+#include <limits.h>
 
+// Gates are matched to sites inside windows of windowSize x windowSize sites
+const int windowSize = 4;
+const int maxMatchingPasses = 4;
+const int maxTierPasses = 4;
+
+/*
+ * Legalization sites form a grid of columns, column = zi * xBlocks + xi,
+ * stacked on tiers, site = tier * columns + column.
+ * The grid itself is the spatial index of the placed gates.
+ */
+typedef struct {
+    int xBlocks, zBlocks;
+    int tiers;
+    QPointF origin; // Center of site 0
+
+    QVector<QPointF> positions; // gate -> global placement position (x, z)
+    QVector<int> siteGates;     // site -> gate, -1 if free
+    QVector<int> gateSites;     // gate -> site
+} SiteGrid;
+
+QPointF
+siteCenter(const SiteGrid &grid, int site)
+{
+    int column = site % (grid.xBlocks * grid.zBlocks);
+    return grid.origin + QPointF(column % grid.xBlocks, column / grid.xBlocks) * legalizationBlockSize;
+}
+
+// Lowest free site of the column, -1 if the column is full
+int
+freeSite(const SiteGrid &grid, int column)
+{
+    for (int site = column; site < grid.siteGates.size(); site += grid.xBlocks * grid.zBlocks)
+    {
+        if (grid.siteGates[site] < 0) return site;
+    }
+    return -1;
+}
+
+double
+displacement(const SiteGrid &grid, int gate, int site)
+{
+    QPointF d = siteCenter(grid, site) - grid.positions[gate];
+    return sqrt(d.x() * d.x() + d.y() * d.y());
+}
+
+// Closest site (clamped to the grid)
+void
+nearestCell(const SiteGrid &grid, const QPointF &p, int &xi, int &zi)
+{
+    xi = qBound(0, qRound((p.x() - grid.origin.x()) / legalizationBlockSize), grid.xBlocks - 1);
+    zi = qBound(0, qRound((p.y() - grid.origin.y()) / legalizationBlockSize), grid.zBlocks - 1);
+}
+
+/*
+ * Searches rings of sites around the gate. Sites of ring r are at least
+ * (r - 1/2) blocks away, so the search stops when the best free site is closer.
+ */
+int
+nearestFreeSite(const SiteGrid &grid, int gate)
+{
+    int cx, cz;
+    nearestCell(grid, grid.positions[gate], cx, cz);
+
+    int best = -1;
+    double bestDistance = DBL_MAX;
+    int maxRadius = qMax(grid.xBlocks, grid.zBlocks);
+    for (int r = 0; r <= maxRadius; r++)
+    {
+        if ((best >= 0) && (bestDistance <= (r - 0.5) * legalizationBlockSize)) break;
+
+        for (int zi = cz - r; zi <= cz + r; zi++)
+        {
+            if ((zi < 0) || (zi >= grid.zBlocks)) continue;
+
+            // Inner rows of the ring have only two sites
+            int step = ((zi == cz - r) || (zi == cz + r)) ? 1 : qMax(1, 2 * r);
+            for (int xi = cx - r; xi <= cx + r; xi += step)
+            {
+                if ((xi < 0) || (xi >= grid.xBlocks)) continue;
+
+                int site = freeSite(grid, zi * grid.xBlocks + xi);
+                if (site < 0) continue;
+
+                double d = displacement(grid, gate, site);
+                if (d < bestDistance)
+                {
+                    bestDistance = d;
+                    best = site;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+/*
+ * Minimum cost assignment of n rows to m >= n columns (Hungarian method with potentials).
+ * cost is row-major n x m, result[row] is the column of the row.
+ */
+void
+solveAssignment(const QVector<double> &cost, int n, int m, QVector<int> &result)
+{
+    Q_ASSERT(n <= m);
+
+    // 1-based, row 0 and column 0 are sentinels
+    QVector<double> u(n + 1, 0.0);
+    QVector<double> v(m + 1, 0.0);
+    QVector<int> p(m + 1, 0);
+    QVector<int> way(m + 1, 0);
+    QVector<double> minv(m + 1);
+    QVector<bool> used(m + 1);
+
+    for (int i = 1; i <= n; i++)
+    {
+        p[0] = i;
+        int j0 = 0;
+        minv.fill(DBL_MAX);
+        used.fill(false);
+        do
+        {
+            used[j0] = true;
+            int i0 = p[j0];
+            int j1 = 0;
+            double delta = DBL_MAX;
+            for (int j = 1; j <= m; j++)
+            {
+                if (used[j]) continue;
+
+                double c = cost[(i0 - 1) * m + (j - 1)] - u[i0] - v[j];
+                if (c < minv[j])
+                {
+                    minv[j] = c;
+                    way[j] = j0;
+                }
+                if (minv[j] < delta)
+                {
+                    delta = minv[j];
+                    j1 = j;
+                }
+            }
+            for (int j = 0; j <= m; j++)
+            {
+                if (used[j])
+                {
+                    u[p[j]] += delta;
+                    v[j] -= delta;
+                }
+                else
+                {
+                    minv[j] -= delta;
+                }
+            }
+            j0 = j1;
+        } while (p[j0] != 0);
+
+        do
+        {
+            int j1 = way[j0];
+            p[j0] = p[j1];
+            j0 = j1;
+        } while (j0 != 0);
+    }
+
+    result.resize(n);
+    for (int j = 1; j <= m; j++)
+    {
+        if (p[j] != 0) result[p[j] - 1] = j - 1;
+    }
+}
+
+/*
+ * Reassigns gates of the window to its sites with minimum total displacement.
+ * Returns true if the displacement has been reduced.
+ */
+bool
+matchWindow(SiteGrid &grid, int x0, int z0)
+{
+    QVector<int> sites;
+    QVector<int> gates;
+    for (int zi = qMax(0, z0); zi < qMin(grid.zBlocks, z0 + windowSize); zi++)
+    {
+        for (int xi = qMax(0, x0); xi < qMin(grid.xBlocks, x0 + windowSize); xi++)
+        {
+            for (int tier = 0; tier < grid.tiers; tier++)
+            {
+                int site = (tier * grid.zBlocks + zi) * grid.xBlocks + xi;
+                sites.append(site);
+                if (grid.siteGates[site] >= 0) gates.append(grid.siteGates[site]);
+            }
+        }
+    }
+    if (gates.isEmpty() || ((gates.size() == 1) && (sites.size() == 1))) return false;
+
+    double oldCost = 0.0;
+    QVector<double> cost(gates.size() * sites.size());
+    for (int i = 0; i < gates.size(); i++)
+    {
+        oldCost += displacement(grid, gates[i], grid.gateSites[gates[i]]);
+        for (int j = 0; j < sites.size(); j++)
+        {
+            cost[i * sites.size() + j] = displacement(grid, gates[i], sites[j]);
+        }
+    }
+
+    QVector<int> assignment;
+    solveAssignment(cost, gates.size(), sites.size(), assignment);
+
+    double newCost = 0.0;
+    for (int i = 0; i < gates.size(); i++)
+    {
+        newCost += cost[i * sites.size() + assignment[i]];
+    }
+    if (newCost >= oldCost - 1e-6) return false;
+
+    foreach (int site, sites)
+    {
+        grid.siteGates[site] = -1;
+    }
+    for (int i = 0; i < gates.size(); i++)
+    {
+        int site = sites[assignment[i]];
+        grid.siteGates[site] = gates[i];
+        grid.gateSites[gates[i]] = site;
+    }
+    return true;
+}
+
+/*
+ * Gates of a row that touch each other. The cluster sits at q / count,
+ * the mean of the left edges its gates want minus their offsets in it.
+ */
+typedef struct {
+    int count;
+    int width;
+    double q;
+    double x;
+} RowCluster;
+
+typedef struct {
+    QVector<RowCluster> clusters;
+    QVector<int> gates; // in the order of the row
+    int width;
+} LegalRow;
+
+typedef struct {
+    QVector<LegalRow> rows;
+    int left, right; // x range of the rows
+} RowSet;
+
+/*
+ * Appends the gate to the end of the row and merges the clusters it
+ * overlaps. x gets the left edge of the gate. Without apply the row stays
+ * as it is. Returns false if the row is full.
+ */
+bool
+appendGate(RowSet &rows, int row, double wantedX, int width, bool apply, double &x)
+{
+    LegalRow &legalRow = rows.rows[row];
+    if (legalRow.width + width > rows.right - rows.left) return false;
+
+    RowCluster cluster = {1, width, wantedX, 0.0};
+    int last = legalRow.clusters.size();
+    for (;;)
+    {
+        cluster.x = qBound(double(rows.left), cluster.q / cluster.count, double(rows.right - cluster.width));
+        if (last == 0) break;
+
+        const RowCluster &previous = legalRow.clusters[last - 1];
+        if (previous.x + previous.width <= cluster.x) break;
+
+        RowCluster merged = {previous.count + cluster.count, previous.width + cluster.width,
+                             previous.q + cluster.q - cluster.count * previous.width, 0.0};
+        cluster = merged;
+        last--;
+    }
+    x = cluster.x + cluster.width - width;
+
+    if (apply)
+    {
+        legalRow.clusters.resize(last);
+        legalRow.clusters.append(cluster);
+        legalRow.width += width;
+    }
+    return true;
+}
+
+/*
+ * Pins of the nets of the gates: gates of the grid and the y range of the pads
+ */
+typedef struct {
+    QVector<QVector<int> > gateNets;
+    QVector<QVector<int> > netGates;
+    QVector<int> padMin, padMax;
+} TierNets;
+
+void
+readTierNets(TierNets &nets, const QList<QString> &gateNames, const Netlist *netlist)
+{
+    QHash<int, int> itemGates;
+    for (int gate = 0; gate < gateNames.size(); gate++)
+    {
+        itemGates[netlist->itemId(gateNames[gate])] = gate;
+    }
+
+    nets.gateNets.resize(gateNames.size());
+    nets.netGates.resize(netlist->netCount());
+    nets.padMin.fill(INT_MAX, netlist->netCount());
+    nets.padMax.fill(INT_MIN, netlist->netCount());
+    for (int net = 0; net < netlist->netCount(); net++)
+    {
+        for (int pin = netlist->netPinBegin(net); pin < netlist->netPinEnd(net); pin++)
+        {
+            int item = netlist->pinItem(pin);
+            if (netlist->isDeleted(item)) continue;
+
+            if (itemGates.contains(item))
+            {
+                int gate = itemGates.value(item);
+                if (!nets.netGates[net].contains(gate)) nets.netGates[net].append(gate);
+                if (!nets.gateNets[gate].contains(net)) nets.gateNets[gate].append(net);
+            }
+            else if (netlist->isPad(item) && netlist->hasPosition(item))
+            {
+                int y = netlist->position(item).y;
+                nets.padMin[net] = qMin(nets.padMin[net], y);
+                nets.padMax[net] = qMax(nets.padMax[net], y);
+            }
+        }
+    }
+}
+
+/*
+ * y part of the HPWL of the nets of the gate on tier y, the other pins stay
+ */
+int
+tierCost(const SiteGrid &grid, const TierNets &nets, int gate, int y, int minY, int pitch)
+{
+    int columns = grid.xBlocks * grid.zBlocks;
+    int cost = 0;
+    foreach (int net, nets.gateNets[gate])
+    {
+        int low = nets.padMin[net];
+        int high = nets.padMax[net];
+        foreach (int other, nets.netGates[net])
+        {
+            if (other == gate) continue;
+            int otherY = minY + (grid.gateSites[other] / columns) * pitch;
+            low = qMin(low, otherY);
+            high = qMax(high, otherY);
+        }
+        if (low > high) continue;
+
+        cost += qMax(0, low - y) + qMax(0, y - high);
+    }
+    return cost;
+}
+
+/*
+ * Gates of every column are matched to its tiers, the pins of the other
+ * columns stay. Passes repeat while the cost goes down.
+ */
+void
+assignTiers(SiteGrid &grid, const QList<QString> &gateNames, const Netlist *netlist, int minY, int pitch)
+{
+    TierNets nets;
+    readTierNets(nets, gateNames, netlist);
+
+    int columns = grid.xBlocks * grid.zBlocks;
+    int passes = 0;
+    while (passes < maxTierPasses)
+    {
+        passes++;
+        bool improved = false;
+        for (int column = 0; column < columns; column++)
+        {
+            QVector<int> gates;
+            for (int tier = 0; tier < grid.tiers; tier++)
+            {
+                int gate = grid.siteGates[tier * columns + column];
+                if (gate >= 0) gates.append(gate);
+            }
+            if (gates.isEmpty()) continue;
+
+            int oldCost = 0;
+            QVector<double> cost(gates.size() * grid.tiers);
+            for (int i = 0; i < gates.size(); i++)
+            {
+                oldCost += tierCost(grid, nets, gates[i], minY + (grid.gateSites[gates[i]] / columns) * pitch, minY, pitch);
+                for (int tier = 0; tier < grid.tiers; tier++)
+                {
+                    cost[i * grid.tiers + tier] = tierCost(grid, nets, gates[i], minY + tier * pitch, minY, pitch);
+                }
+            }
+
+            QVector<int> assignment;
+            solveAssignment(cost, gates.size(), grid.tiers, assignment);
+
+            double newCost = 0.0;
+            for (int i = 0; i < gates.size(); i++)
+            {
+                newCost += cost[i * grid.tiers + assignment[i]];
+            }
+            if (newCost >= oldCost) continue;
+
+            for (int tier = 0; tier < grid.tiers; tier++)
+            {
+                grid.siteGates[tier * columns + column] = -1;
+            }
+            for (int i = 0; i < gates.size(); i++)
+            {
+                int site = assignment[i] * columns + column;
+                grid.siteGates[site] = gates[i];
+                grid.gateSites[gates[i]] = site;
+            }
+            improved = true;
+        }
+        if (!improved) break;
+    }
+    qDebug("Tier passes: %d", passes);
+}
+
+struct GateOrder
+{
+    GateOrder(const QVector<double> &keys)
+        : m_keys(keys)
+    {
+    }
+
+    bool operator()(int a, int b) const
+    {
+        if (m_keys[a] != m_keys[b]) return m_keys[a] < m_keys[b];
+        return a < b;
+    }
+
+    const QVector<double> &m_keys;
+};
+
+/*
+ * Footprint of the cell of the gate in the (x, z) plane, with the halo on every side
+ */
+bool
+gateFootprint(Vector<int> &footprint, const QString &gateName, const Netlist *netlist, const CellLibrary *library, int halo)
+{
+    int cell = library->cellIndex(netlist->cellType(gateName));
+    if (cell < 0)
+    {
+        qWarning("Can't get cell of gate %s", qPrintable(gateName));
+        return false;
+    }
+
+    footprint = library->dimensions(cell);
+    footprint.x += 2 * halo;
+    footprint.z += 2 * halo;
+    return true;
+}
+
+/*
+ * Gates closest to a site take the nearest free site first. Local min-cost
+ * matching in overlapping windows then removes most of the displacement the
+ * greedy order causes.
+ */
 bool
-legalize(NetPlacement &p, const Netlist *netlist, const PlacementJob *placementJob)
+legalizeGrid(NetPlacement &p, const Netlist *netlist, const CellLibrary *library, const PlacementJob *placementJob)
 {
     Vector<int> min = placementJob->minCoordinates();
     Vector<int> max = placementJob->maxCoordinates();
@@ -14,62 +482,298 @@ legalize(NetPlacement &p, const Netlist *netlist, const PlacementJob *placementJ
     int xSize = max.x - min.x + 1;
     int zSize = max.z - min.z + 1;
 
-    int blockSize = 3;
+    int blockSize = legalizationBlockSize;
 
     int xBlocks = xSize / blockSize;
     int zBlocks = zSize / blockSize;
 
     qDebug("Blocks: %dx%d", xBlocks, zBlocks);
 
-    if ((xBlocks * zBlocks) < p.size())
+    int tiers = placementJob->tierCount();
+    int pitch = 0;
+    if (tiers > 1)
+    {
+        pitch = tierPitch(netlist, library, placementJob);
+        if (pitch == 0) return false;
+        qDebug("Tiers: %d, pitch %d", tiers, pitch);
+    }
+
+    if ((xBlocks * zBlocks * tiers) < p.size())
     {
         qDebug("No enough place for legalization");
         return false;
     }
 
-    QSet<QString> unplacedGates = p.keys().toSet();
-    for (int xi = 0; xi < xBlocks; xi++)
+    QList<QString> gateNames = p.keys();
+    int gateCount = gateNames.size();
+
+    foreach (const QString &gateName, gateNames)
+    {
+        Vector<int> footprint;
+        if (!gateFootprint(footprint, gateName, netlist, library, 0)) return false;
+        if ((footprint.x > blockSize) || (footprint.z > blockSize))
+        {
+            qWarning("Gate %s doesn't fit into a site, use row legalization", qPrintable(gateName));
+            return false;
+        }
+    }
+
+    SiteGrid grid;
+    grid.xBlocks = xBlocks;
+    grid.zBlocks = zBlocks;
+    grid.tiers = tiers;
+    grid.origin = QPointF(min.x + blockSize / 2, min.z + blockSize / 2);
+    grid.positions.resize(gateCount);
+    grid.siteGates.fill(-1, xBlocks * zBlocks * tiers);
+    grid.gateSites.fill(-1, gateCount);
+
+    QVector<double> keys(gateCount);
+    QVector<int> order(gateCount);
+    for (int gate = 0; gate < gateCount; gate++)
+    {
+        const GatePlacement &gp = p[gateNames[gate]];
+        grid.positions[gate] = QPointF(gp.x, gp.z);
+
+        int xi, zi;
+        nearestCell(grid, grid.positions[gate], xi, zi);
+        keys[gate] = displacement(grid, gate, zi * xBlocks + xi);
+        order[gate] = gate;
+    }
+    std::sort(order.begin(), order.end(), GateOrder(keys));
+
+    foreach (int gate, order)
+    {
+        int site = nearestFreeSite(grid, gate);
+        if (site < 0)
+        {
+            qDebug("Can't legalize");
+            return false;
+        }
+        grid.siteGates[site] = gate;
+        grid.gateSites[gate] = site;
+    }
+
+    // Shifted windows let gates cross window borders
+    for (int pass = 0; pass < maxMatchingPasses; pass++)
     {
-        for (int zi = 0; zi < zBlocks; zi++)
+        bool improved = false;
+        int shift = (pass % 2) ? windowSize / 2 : 0;
+        for (int z0 = -shift; z0 < zBlocks; z0 += windowSize)
         {
-            int xc = min.x + xi * blockSize + (blockSize / 2);
-            int zc = min.z + zi * blockSize + (blockSize / 2);
+            for (int x0 = -shift; x0 < xBlocks; x0 += windowSize)
+            {
+                if (matchWindow(grid, x0, z0)) improved = true;
+            }
+        }
+        if (!improved && (pass > 0)) break;
+    }
+
+    if (tiers > 1) assignTiers(grid, gateNames, netlist, min.y, pitch);
+
+    double total = 0.0;
+    for (int gate = 0; gate < gateCount; gate++)
+    {
+        int site = grid.gateSites[gate];
+        int column = site % (xBlocks * zBlocks);
+        total += displacement(grid, gate, site);
+
+        GatePlacement &gp = p[gateNames[gate]];
+        gp.x = min.x + (column % xBlocks) * blockSize;
+        gp.y = min.y + (site / (xBlocks * zBlocks)) * pitch;
+        gp.z = min.z + (column / xBlocks) * blockSize;
+    }
+    qDebug("Displacement: %0.1f", total);
+
+    return true;
+}
+
+/*
+ * Abacus: rows are as high as the highest footprint, gates sorted by their
+ * left edges are appended to the row where they move least. Gates that
+ * overlap in a row form a cluster, which sits at the mean of the positions
+ * its gates want, so earlier gates make room instead of pushing the new one
+ * out of the row. Rows farther away than the best candidate are not tried.
+ */
+bool
+legalizeRows(NetPlacement &p, const Netlist *netlist, const CellLibrary *library, const PlacementJob *placementJob)
+{
+    if (placementJob->tierCount() > 1)
+    {
+        qWarning("Row legalization places gates on one tier only");
+        return false;
+    }
+
+    Vector<int> min = placementJob->minCoordinates();
+    Vector<int> max = placementJob->maxCoordinates();
+    int spacing = placementJob->legalizationSpacing();
+    int rowSpacing = placementJob->rowSpacing();
+
+    QList<QString> gateNames = p.keys();
+    int gateCount = gateNames.size();
+
+    /* Widths include the spacing to the next gate, so does the row  */
+    QVector<int> widths(gateCount);
+    QVector<int> depths(gateCount);
+    QVector<int> halos(gateCount);
+    int rowHeight = 1;
+    qint64 area = 0;
+    for (int gate = 0; gate < gateCount; gate++)
+    {
+        Vector<int> footprint;
+        halos[gate] = placementJob->cellHalo(netlist->cellType(gateNames[gate]));
+        if (!gateFootprint(footprint, gateNames[gate], netlist, library, halos[gate])) return false;
 
-            float minDistance = xSize + zSize;
-            QString minGate;
+        widths[gate] = footprint.x + spacing;
+        depths[gate] = footprint.z;
+        rowHeight = qMax(rowHeight, footprint.z);
+        area += widths[gate];
+    }
+
+    int rowPitch = rowHeight + rowSpacing;
+    int rowCount = (max.z - min.z + 1 + rowSpacing) / rowPitch;
+
+    RowSet rows;
+    rows.left = min.x;
+    rows.right = max.x + 1 + spacing;
+    LegalRow empty;
+    empty.width = 0;
+    rows.rows.fill(empty, rowCount);
+
+    qDebug("Rows: %d of height %d", rowCount, rowHeight);
+
+    if (area > qint64(rowCount) * (rows.right - rows.left))
+    {
+        qDebug("No enough place for legalization");
+        return false;
+    }
+
+    QVector<double> xs(gateCount); // left edges the gates want
+    QVector<double> zs(gateCount);
+    QVector<int> order(gateCount);
+    for (int gate = 0; gate < gateCount; gate++)
+    {
+        const GatePlacement &gp = p[gateNames[gate]];
+        xs[gate] = gp.x - (widths[gate] - spacing) / 2.0;
+        zs[gate] = gp.z - depths[gate] / 2.0;
+        order[gate] = gate;
+    }
+    std::sort(order.begin(), order.end(), GateOrder(xs));
 
-            foreach (const QString &gateName, unplacedGates)
+    foreach (int gate, order)
+    {
+        int row = qBound(0, qRound((zs[gate] - min.z) / rowPitch), rowCount - 1);
+
+        int best = -1;
+        double bestCost = DBL_MAX;
+        for (int r = 0; r < rowCount; r++)
+        {
+            bool searched = false;
+            for (int side = -1; side <= 1; side += 2)
             {
-                GatePlacement gp = p[gateName];
+                int candidate = row + side * r;
+                if ((candidate < 0) || (candidate >= rowCount) || ((r == 0) && (side > 0))) continue;
+
+                double dz = qAbs(min.z + candidate * rowPitch - zs[gate]);
+                if (dz >= bestCost) continue;
+                searched = true;
 
-                float dx = xc - gp.x;
-                float dz = zc - gp.z;
-                float d = sqrtf(dx*dx + dz*dz);
-                if (d < minDistance)
+                double x;
+                if (!appendGate(rows, candidate, xs[gate], widths[gate], false, x)) continue;
+
+                double cost = qAbs(x - xs[gate]) + dz;
+                if (cost < bestCost)
                 {
-                    minDistance = d;
-                    minGate = gateName;
+                    bestCost = cost;
+                    best = candidate;
                 }
             }
+            if (!searched && (best >= 0)) break;
+        }
+
+        if (best < 0)
+        {
+            qDebug("Can't legalize");
+            return false;
+        }
 
-            Q_ASSERT(!minGate.isEmpty());
+        double x;
+        appendGate(rows, best, xs[gate], widths[gate], true, x);
+        rows.rows[best].gates.append(gate);
+    }
 
-            GatePlacement &gp = p[minGate];
-            gp.x = xc - 1;
-            gp.y = min.y;
-            gp.z = zc - 1;
-            unplacedGates.remove(minGate);
+    /* Clusters are left aligned to whole blocks, gates follow each other inside  */
+    double total = 0.0;
+    for (int row = 0; row < rowCount; row++)
+    {
+        const LegalRow &legalRow = rows.rows[row];
+        int gate = 0;
+        foreach (const RowCluster &cluster, legalRow.clusters)
+        {
+            int x = qBound(rows.left, qRound(cluster.x), rows.right - cluster.width);
+            for (int end = gate + cluster.count; gate < end; gate++)
+            {
+                int g = legalRow.gates[gate];
+                GatePlacement &gp = p[gateNames[g]];
+                total += qAbs(x - xs[g]) + qAbs(min.z + row * rowPitch - zs[g]);
 
-            if (unplacedGates.isEmpty()) break;
+                gp.x = x + halos[g];
+                gp.y = min.y;
+                gp.z = min.z + row * rowPitch + halos[g];
+                x += widths[g];
+            }
         }
-        if (unplacedGates.isEmpty()) break;
     }
+    qDebug("Displacement: %0.1f", total);
+
+    return true;
+}
 
-    if (!unplacedGates.isEmpty())
+bool
+legalize(NetPlacement &p, const Netlist *netlist, const CellLibrary *library, const PlacementJob *placementJob)
+{
+    if (placementJob->legalizationMode() == PlacementJob::RowLegalization)
     {
-        qDebug("Can't legalize");
-        return false;
+        return legalizeRows(p, netlist, library, placementJob);
     }
+    return legalizeGrid(p, netlist, library, placementJob);
+}
+
+bool
+centerPlacement(NetPlacement &p, const Netlist *netlist, const CellLibrary *library)
+{
+    foreach (const QString &gateName, p.keys())
+    {
+        Vector<int> footprint;
+        if (!gateFootprint(footprint, gateName, netlist, library, 0)) return false;
 
+        GatePlacement &gp = p[gateName];
+        gp.x += footprint.x / 2.0;
+        gp.z += footprint.z / 2.0;
+    }
     return true;
 }
+
+int
+tierPitch(const Netlist *netlist, const CellLibrary *library, const PlacementJob *placementJob)
+{
+    int height = 1;
+    foreach (const QString &gateName, netlist->allGates())
+    {
+        int cell = library->cellIndex(netlist->cellType(gateName));
+        if (cell < 0)
+        {
+            qWarning("Can't get cell of gate %s", qPrintable(gateName));
+            return 0;
+        }
+        height = qMax(height, library->dimensions(cell).y);
+    }
+
+    int pitch = height + placementJob->tierSpacing();
+    int ySize = placementJob->maxCoordinates().y - placementJob->minCoordinates().y + 1;
+    if ((placementJob->tierCount() - 1) * pitch + height > ySize)
+    {
+        qWarning("Area has room for %d tiers only", qMax(1, (ySize - height) / pitch + 1));
+        return 0;
+    }
+    return pitch;
+}
@@ -4,9 +4,34 @@
 #include "placement.h"
 
 class Netlist;
+class CellLibrary;
 class PlacementJob;
 
+// Gates are legalized into a grid of square blocks of this size
+const int legalizationBlockSize = 3;
+
+/*
+ * Global positions of p are gate centers, legal ones are the minimal
+ * corners. The grid gives every gate a site, cells must fit into a block.
+ * Rows pack the footprints of the library (plus the halos of the job) from
+ * left to right, gates take the row where they move least (Abacus).
+ *
+ * With several tiers every grid column has a site on each of them. Gates
+ * are legalized into columns, then the gates of every column are matched
+ * to its tiers by the HPWL in y, a few passes over all columns.
+ */
+bool
+legalize(NetPlacement &p, const Netlist *netlist, const CellLibrary *library, const PlacementJob *placementJob);
+
+// Moves legal positions (minimal corners) back to the centers legalize() takes
 bool
-legalize(NetPlacement &p, const Netlist *netlist, const PlacementJob *placementJob);
+centerPlacement(NetPlacement &p, const Netlist *netlist, const CellLibrary *library);
+
+/*
+ * Distance in y of neighbouring tiers: the highest gate plus the tier
+ * spacing. 0 if the tiers of the job don't fit into the area.
+ */
+int
+tierPitch(const Netlist *netlist, const CellLibrary *library, const PlacementJob *placementJob);
 
 #endif // LEGALIZATION_H
@@ -0,0 +1,44 @@
+#include "linearsolver.h"
+#include "cgsolver.h"
+#include "blockcgsolver.h"
+#include "choleskysolver.h"
+
+void
+LinearSolver::setTolerance(double tolerance)
+{
+    Q_UNUSED(tolerance);
+}
+
+void
+LinearSolver::solve(const Array &b1, const Array &b2, Array &x1, Array &x2)
+{
+    solve(b1, x1);
+    solve(b2, x2);
+}
+
+Array
+LinearSolver::solve(const Array &b)
+{
+    Array x;
+    solve(b, x);
+    return x;
+}
+
+LinearSolver *
+LinearSolver::create(LinearSolver::Type type, const CsrMatrix &matrix, Preconditioner::Type preconditionerType)
+{
+    if (type == Cholesky)
+    {
+        CholeskySolver *solver = new CholeskySolver(matrix);
+        if (solver->isValid()) return solver;
+
+        qWarning("LinearSolver: Cholesky factorization failed, using CG");
+        delete solver;
+    }
+    else if (type == BlockConjugateGradient)
+    {
+        return new BlockCgSolver(matrix, preconditionerType);
+    }
+
+    return new CgSolver(matrix, preconditionerType);
+}
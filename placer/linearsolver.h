@@ -0,0 +1,53 @@
+#ifndef LINEARSOLVER_H
+#define LINEARSOLVER_H
+
+#include "array.h"
+#include "preconditioner.h"
+
+class CsrMatrix;
+
+/*
+ * Solver for "b = Ax" with a fixed symmetric positive definite matrix A.
+ */
+class LinearSolver
+{
+public:
+    enum Type
+    {
+        ConjugateGradient,
+        BlockConjugateGradient,
+        Cholesky
+    };
+
+public:
+    virtual ~LinearSolver() {}
+
+    // Iterative solvers stop when |b - Ax| <= tolerance * |b|, direct solvers ignore it
+    virtual void
+    setTolerance(double tolerance);
+
+    /*
+     * Solve "b = Ax".
+     * Iterative solvers start from x if it has the size of the matrix, from zero otherwise.
+     */
+    virtual void
+    solve(const Array &b, Array &x) = 0;
+
+    // Solve "b1 = A x1" and "b2 = A x2", x1 and x2 are initial guesses as above
+    virtual void
+    solve(const Array &b1, const Array &b2, Array &x1, Array &x2);
+
+    // Solve "b = Ax" starting from zero
+    Array
+    solve(const Array &b);
+
+public:
+    /*
+     * Preconditioner is used by iterative solvers only.
+     * Falls back to conjugate gradient if the matrix can't be factored.
+     */
+    static LinearSolver *
+    create(Type type, const CsrMatrix &matrix, Preconditioner::Type preconditionerType);
+};
+
+#endif // LINEARSOLVER_H
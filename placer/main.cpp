@@ -6,11 +6,33 @@
 #include <QPointF>
 #include <QSizeF>
 #include <QSet>
+#include <QScopedPointer>
+#include <QThread>
+#include <math.h>
 #include "common/netlist.h"
 #include "common/cellvariantfile.h"
+#include "common/celllibrary.h"
 #include "placementjob.h"
 #include "qp.h"
+#include "eplace.h"
 #include "legalization.h"
+#include "hpwlengine.h"
+#include "congestionmap.h"
+#include "timinganalysis.h"
+#include "buffering.h"
+#include "multistart.h"
+#include "random.h"
+#include "variantoptimizer.h"
+#include "taskpool.h"
+
+const int maxVariantPasses = 10;
+
+// Inflation of a gate per congestion round and in total
+const double maxInflationStep = 1.5;
+const double maxInflation = 2.5;
+
+// Net weights grow with this power of the criticality
+const double criticalityExponent = 2.0;
 
 bool
 fixNetlist(Netlist * netlist, PlacementJob * job)
@@ -54,15 +76,17 @@ generateRandomPlacement(Netlist * netlist, const PlacementJob *placementJob)
 
     Vector<int> min = placementJob->minCoordinates();
     Vector<int> max = placementJob->maxCoordinates();
-    Vector<int> size = max - min;
+    Vector<int> size = max - min + Vector<int>(1, 1, 1); // Coordinates are inclusive
+
+    Random random(placementJob->seed());
 
     QList<QString> gates = netlist->allGates();
     foreach (const QString &gateName, gates)
     {
         GatePlacement gp;
-        gp.x = min.x + qrand() % size.x;
-        gp.y = min.y + qrand() % size.y;
-        gp.z = min.z + qrand() % size.z;
+        gp.x = min.x + random.bounded(size.x);
+        gp.y = min.y + random.bounded(size.y);
+        gp.z = min.z + random.bounded(size.z);
         placement[gateName] = gp;
     }
 
@@ -80,98 +104,80 @@ applyPlacement(Netlist * netlist, NetPlacement &p)
 }
 
 int
-calculateHPWL(Netlist * netlist, CellVariantFile * variants)
+calculateHPWL(Netlist * netlist, const CellLibrary *library)
 {
-    int hpwl = 0;
-    foreach (const QString &netName, netlist->allNets())
-    {
-        QList<QPair<QString, QString> > itemsAndPorts = netlist->itemsAndPortsByNet(netName);
+    QScopedPointer<HpwlEngine> engine(HpwlEngine::build(netlist, library));
+    if (engine.isNull()) return -1;
 
-        QList<Vector<int> > points;
+    return engine->hpwl();
+}
 
-        for (int i = 0; i < itemsAndPorts.size(); i++)
-        {
-            Vector<int> p;
-            QString itemName = itemsAndPorts[i].first;
-            QString portName = itemsAndPorts[i].second;
-            QString cellType = netlist->cellType(itemName);
-            QString variant = netlist->variant(itemName);
-            netlist->position(itemName, p.x, p.y, p.z);
+NetPlacement
+placeGlobally(Netlist * netlist, const PlacementJob *placementJob, const CellLibrary *library,
+              const GateInflation &inflation, const NetWeights &netWeights)
+{
+    if (placementJob->globalPlacer() == PlacementJob::ElectrostaticPlacer)
+    {
+        return placeElectrostatic(netlist, placementJob, inflation, netWeights);
+    }
+    return placeQuad(netlist, placementJob, library, inflation, netWeights);
+}
 
-            CellVariantList list = variants->variantList(cellType);
-            CellVariant var = list.variant(variant);
+CongestionMap *
+mapCongestion(Netlist * netlist, const CellLibrary *library, const PlacementJob *placementJob)
+{
+    QScopedPointer<HpwlEngine> engine(HpwlEngine::build(netlist, library));
+    if (engine.isNull()) return 0;
 
-            Vector<int> pp;
-            var.portPosition(pp, portName);
+    CongestionMap *map = CongestionMap::build(engine.data(), placementJob->routingMinCoordinates(),
+                                              placementJob->routingMaxCoordinates(), legalizationBlockSize);
+    qDebug("Congestion: max %0.2f, overflow %0.3f", map->maxCongestion(), map->overflow());
+    return map;
+}
 
-            pp = pp + p;
-            points.append(pp);
-        }
+/* Grows the gates of bins above the target congestion, false if there are none  */
+bool
+inflateGates(const Netlist *netlist, const CongestionMap *map, double target, GateInflation &inflation)
+{
+    bool inflated = false;
+    foreach (const QString &gateName, netlist->allGates())
+    {
+        Vector<int> p;
+        if (!netlist->position(gateName, p.x, p.y, p.z)) continue;
 
-        Vector<int> max = points.first();
-        Vector<int> min = points.first();
+        double congestion = map->congestion(map->bin(p.x, p.z));
+        if (congestion <= target) continue;
 
-        for (int i = 1; i < points.size(); i++)
-        {
-            Vector<int> p = points[i];
-            if (p.x < min.x) min.x = p.x;
-            if (p.x > max.x) max.x = p.x;
-            if (p.y < min.y) min.y = p.y;
-            if (p.y > max.y) max.y = p.y;
-            if (p.z < min.z) min.z = p.z;
-            if (p.z > max.z) max.z = p.z;
-        }
+        double factor = inflation.value(gateName, 1.0);
+        inflation[gateName] = qMin(maxInflation, factor * qMin(maxInflationStep, congestion / target));
+        inflated = true;
+    }
+    return inflated;
+}
 
-        hpwl += qAbs(max.x - min.x) + qAbs(max.y - min.y) + qAbs(max.z - min.z);
+TimingAnalysis *
+analyzeTiming(Netlist * netlist, const CellLibrary *library, const PlacementJob *placementJob)
+{
+    TimingAnalysis *timing = TimingAnalysis::run(netlist, library, placementJob);
+    if (timing != 0)
+    {
+        qDebug("Critical path: %d ticks", timing->criticalPathDelay());
     }
-    return hpwl;
+    return timing;
 }
 
 void
-optimizePlacementHPWL(Netlist * netlist, CellVariantFile * variants, int iterations)
+weightNets(const TimingAnalysis *timing, double weight, NetWeights &netWeights)
 {
-    QVector<QString> gates = netlist->allGates().toVector();
-    if (gates.size() <= 1) return;
-
-    int lastHPWL = calculateHPWL(netlist, variants);
-
-    int goodSwaps = 0;
-    for (int i = 0; i < iterations; i++)
+    netWeights.resize(timing->netCount());
+    for (int net = 0; net < netWeights.size(); net++)
     {
-        int i1 = qrand() % gates.size();
-        int i2 = qrand() % gates.size();
-        while (i1 != i2) i2 = qrand() % gates.size();
-
-        int x1, y1, z1;
-        int x2, y2, z2;
-
-        netlist->position(gates[i1], x1, y1, z1);
-        netlist->position(gates[i2], x2, y2, z2);
-
-        // Swap gates
-        netlist->setPosition(gates[i1], x2, y2, z2);
-        netlist->setPosition(gates[i2], x1, y1, z1);
-
-        int newHPWL = calculateHPWL(netlist, variants);
-        if (newHPWL < lastHPWL)
-        {
-            // Confirm swap
-            lastHPWL = newHPWL;
-            goodSwaps++;
-            continue;
-        }
-        else
-        {
-            // Undo swap
-            netlist->setPosition(gates[i1], x1, y1, z1);
-            netlist->setPosition(gates[i2], x2, y2, z2);
-        }
+        netWeights[net] = 1.0 + weight * pow(timing->criticality(net), criticalityExponent);
     }
-    qDebug("Good swaps: %d", goodSwaps);
 }
 
 bool
-fixGateVariants(Netlist * netlist, CellVariantFile * variantFile)
+fixGateVariants(Netlist * netlist, const CellLibrary *library)
 {
     // Just take first cell variant for each gate
 
@@ -185,65 +191,95 @@ fixGateVariants(Netlist * netlist, CellVariantFile * variantFile)
             return false;
         }
 
-        CellVariantList varList = variantFile->variantList(cellType);
-        if (!varList.isValid())
+        int cell = library->cellIndex(cellType);
+        if (cell < 0)
         {
             qWarning("Can't get variant list for cell %s", qPrintable(cellType));
             return false;
         }
 
-        QList<CellVariant> vars = varList.allVariants();
-        CellVariant variant = varList.allVariants().first();
-        netlist->setVariant(itemName, variant.name());
+        netlist->setVariant(itemName, library->variantName(cell, 0));
     }
 
     return true;
 }
 
 bool
-optimizeVariants(Netlist * netlist, CellVariantFile * variantFile)
+optimizeVariants(Netlist * netlist, const CellLibrary *library, TaskPool *pool)
 {
-    QList<QString> items = netlist->allItems();
-    foreach (const QString &itemName, items)
+    QScopedPointer<HpwlEngine> engine(HpwlEngine::build(netlist, library));
+    if (engine.isNull()) return false;
+
+    int passes = selectVariants(engine.data(), pool, maxVariantPasses);
+    qDebug("Variant passes: %d", passes);
+
+    engine->save(netlist);
+
+    return true;
+}
+
+/*
+ * Every start places globally, legalizes and anneals with its own seed,
+ * start 0 takes the legal placement it gets. The start with the lowest
+ * annealed HPWL is saved to the netlist, ties go to the lower start.
+ */
+bool
+placeStarts(Netlist * netlist, const NetPlacement &placement, const CellLibrary *library, const PlacementJob *placementJob,
+            const GateInflation &inflation, const NetWeights &netWeights, TaskPool *pool)
+{
+    QScopedPointer<HpwlEngine> best;
+    for (int start = 0; start < placementJob->annealingStarts(); start++)
     {
-        QString cellType = netlist->cellType(itemName);
-        if (cellType.isEmpty())
+        NetPlacement p = placement;
+        if (start > 0)
         {
-            qWarning("Can't get cell type for item %s", qPrintable(itemName));
-            return false;
+            p = placeElectrostatic(netlist, placementJob, inflation, netWeights, start);
+            if (!legalize(p, netlist, library, placementJob))
+            {
+                qWarning("Can't legalize placement");
+                return false;
+            }
         }
 
-        CellVariantList varList = variantFile->variantList(cellType);
-        if (!varList.isValid())
+        applyPlacement(netlist, p);
+        if (!fixGateVariants(netlist, library))
         {
-            qWarning("Can't get variant list for cell %s", qPrintable(cellType));
+            qWarning("Can't optimize variants");
             return false;
         }
+        int legalHpwl = calculateHPWL(netlist, library);
 
-        QList<CellVariant> variants = varList.allVariants();
+        if (!optimizeVariants(netlist, library, pool))
+        {
+            qWarning("Can't optimize variants");
+            return false;
+        }
+        if (!annealStart(netlist, library, placementJob, start, pool))
+        {
+            qWarning("Can't anneal placement");
+            return false;
+        }
 
-        QString minVariant = netlist->variant(itemName);
-        int minHPWL = calculateHPWL(netlist, variantFile);
+        HpwlEngine *engine = HpwlEngine::build(netlist, library);
+        if (engine == 0) return false;
 
-        foreach (const CellVariant &v, variants)
+        qDebug("Start %d: legalized HPWL %d, annealed HPWL %d", start, legalHpwl, engine->hpwl());
+        if (best.isNull() || (engine->hpwl() < best->hpwl()))
         {
-            netlist->setVariant(itemName, v.name());
-            int hpwl = calculateHPWL(netlist, variantFile);
-            if (hpwl < minHPWL)
-            {
-                minHPWL = hpwl;
-                minVariant = v.name();
-            }
+            best.reset(engine);
+        }
+        else
+        {
+            delete engine;
         }
-
-        netlist->setVariant(itemName, minVariant);
     }
 
+    best->save(netlist);
     return true;
 }
 
 bool
-writeItems(QXmlStreamWriter &stream, const Netlist *netlist, CellVariantFile *variantFile)
+writeItems(QXmlStreamWriter &stream, const Netlist *netlist, const CellLibrary *library)
 {
     QMap<QString, Vector<int> > positions;
     QMap<QString, QString> variantNames;
@@ -286,13 +322,19 @@ writeItems(QXmlStreamWriter &stream, const Netlist *netlist, CellVariantFile *va
 
         QList<QString> ports = netlist->itemPorts(name);
 
-        CellVariantList lst = variantFile->variantList(cellType);
-        CellVariant v = lst.variant(variantName);
+        int cell = library->cellIndex(cellType);
+        int v = (cell >= 0) ? library->variantIndex(cell, variantName) : -1;
+        if (v < 0)
+        {
+            qWarning("Can't get variant %s of cell %s", qPrintable(variantName), qPrintable(cellType));
+            return false;
+        }
 
         foreach (const QString &portName, ports)
         {
             Vector<int> p2;
-            if (!v.portPosition(p2, portName))
+            int port = library->portIndex(cell, portName);
+            if ((port < 0) || !library->portPosition(p2, cell, v, port))
             {
                 qWarning("Can't get port position for port %s (gate %s)", qPrintable(portName), qPrintable(name));
             }
@@ -307,15 +349,14 @@ writeItems(QXmlStreamWriter &stream, const Netlist *netlist, CellVariantFile *va
             stream.writeEndElement();
         }
 
-        QList<CellVariant::Block> gateBlocks = v.allBlocks();
-        for (int i = 0; i < gateBlocks.size(); i++)
+        for (int i = 0; i < library->blockCount(cell, v); i++)
         {
-            CellVariant::Block &block = gateBlocks[i];
+            CellVariant::Block block = library->block(cell, v, i);
             block.position.x += p.x;
             block.position.y += p.y;
             block.position.z += p.z;
+            allBlocks.append(block);
         }
-        allBlocks.append(gateBlocks);
     }
 
     stream.writeEndElement();
@@ -337,7 +378,7 @@ writeItems(QXmlStreamWriter &stream, const Netlist *netlist, CellVariantFile *va
 }
 
 bool
-writeNets(QXmlStreamWriter &stream, const Netlist *netlist)
+writeNets(QXmlStreamWriter &stream, const Netlist *netlist, const TimingAnalysis *timing)
 {
     stream.writeStartElement("nets");
 
@@ -347,6 +388,10 @@ writeNets(QXmlStreamWriter &stream, const Netlist *netlist)
 
         stream.writeStartElement("net");
         stream.writeAttribute("name", netName);
+        if (timing != 0)
+        {
+            stream.writeAttribute("criticality", QString::number(timing->criticality(netlist->netId(netName)), 'f', 3));
+        }
 
         for (int i = 0; i < net.size(); i++)
         {
@@ -369,7 +414,7 @@ writeNets(QXmlStreamWriter &stream, const Netlist *netlist)
 }
 
 bool
-saveRountingTask(const QString &filePath, const Netlist *netlist, CellVariantFile *variants)
+saveRountingTask(const QString &filePath, const Netlist *netlist, const CellLibrary *library, const TimingAnalysis *timing)
 {
     QFile fo(filePath);
     if (!fo.open(QFile::WriteOnly | QFile::Truncate))
@@ -385,8 +430,8 @@ saveRountingTask(const QString &filePath, const Netlist *netlist, CellVariantFil
     stream.writeStartDocument();
     stream.writeStartElement("placement");
 
-    if (!writeItems(stream, netlist, variants)) err = true;
-    if (!writeNets(stream, netlist)) err = true;
+    if (!writeItems(stream, netlist, library)) err = true;
+    if (!writeNets(stream, netlist, timing)) err = true;
 
     stream.writeEndElement();
     stream.writeEndDocument();
@@ -428,28 +473,120 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    CellVariantFile * variants = CellVariantFile::readFromFile(args[2]);
-    if (variants == 0)
+    CellVariantFile * variantFile = CellVariantFile::readFromFile(args[2]);
+    if (variantFile == 0)
     {
         qWarning("Can't load variant list");
         return 1;
     }
 
+    CellLibrary * variants = CellLibrary::build(variantFile);
+    if (variants == 0)
+    {
+        qWarning("Can't compile variant list");
+        return 1;
+    }
+
     if (!fixNetlist(netlist, job))
     {
         return 1;
     }
 
-    NetPlacement placement = placeQuad(netlist, job);
-    NetPlacement rp = generateRandomPlacement(netlist, job);
+    NetPlacement placement;
+    GateInflation inflation;
+    NetWeights netWeights;
+    if (job->timingDriven())
+    {
+        /* Nothing is placed yet, criticality follows from the logic depth  */
+        QScopedPointer<TimingAnalysis> timing(analyzeTiming(netlist, variants, job));
+        if (timing.isNull())
+        {
+            qWarning("Can't analyze timing");
+            return 1;
+        }
+        weightNets(timing.data(), job->timingWeight(), netWeights);
+    }
 
-    if (!legalize(placement, netlist, job))
+    int feedbackRounds = qMax(job->congestionIterations(), job->timingIterations());
+    for (int round = 0; ; round++)
     {
-        qWarning("Can't legalize placement");
-        return 1;
+        placement = placeGlobally(netlist, job, variants, inflation, netWeights);
+        if (!legalize(placement, netlist, variants, job))
+        {
+            qWarning("Can't legalize placement");
+            return 1;
+        }
+
+        if (round >= feedbackRounds) break;
+
+        /* Feedback: inflate the gates of congested bins, weight critical nets and place again  */
+        applyPlacement(netlist, placement);
+        if (!fixGateVariants(netlist, variants))
+        {
+            qWarning("Can't optimize variants");
+            return 1;
+        }
+
+        bool feedback = false;
+        if (round < job->congestionIterations())
+        {
+            QScopedPointer<CongestionMap> map(mapCongestion(netlist, variants, job));
+            if (map.isNull())
+            {
+                qWarning("Can't estimate congestion");
+                return 1;
+            }
+            if (inflateGates(netlist, map.data(), job->congestionTarget(), inflation)) feedback = true;
+        }
+        if (round < job->timingIterations())
+        {
+            QScopedPointer<TimingAnalysis> timing(analyzeTiming(netlist, variants, job));
+            if (timing.isNull())
+            {
+                qWarning("Can't analyze timing");
+                return 1;
+            }
+            weightNets(timing.data(), job->timingWeight(), netWeights);
+            feedback = true;
+        }
+        if (!feedback) break;
     }
 
-    if (!legalize(rp, netlist, job))
+    if (!job->bufferCell().isEmpty())
+    {
+        /* Buffers go next to the legal gates, then everything is legalized again  */
+        applyPlacement(netlist, placement);
+        if (!fixGateVariants(netlist, variants))
+        {
+            qWarning("Can't optimize variants");
+            return 1;
+        }
+
+        /* Buffering and legalize() take centers  */
+        if (!centerPlacement(placement, netlist, variants))
+        {
+            qWarning("Can't insert buffers");
+            return 1;
+        }
+
+        int buffers;
+        if (!insertBuffers(netlist, placement, variants, job, buffers))
+        {
+            qWarning("Can't insert buffers");
+            return 1;
+        }
+        qDebug("Buffers: %d", buffers);
+
+        if (!legalize(placement, netlist, variants, job))
+        {
+            qWarning("Can't legalize placement");
+            return 1;
+        }
+    }
+
+    NetPlacement rp = generateRandomPlacement(netlist, job);
+
+    if (!legalize(rp, netlist, variants, job))
     {
         qWarning("Can't legalize placement");
         return 1;
@@ -474,19 +611,74 @@ int main(int argc, char *argv[])
 
     qDebug("Optimized HPWL: %d", calculateHPWL(netlist, variants));
 
-    optimizeVariants(netlist, variants);
+    int threads = job->threadCount();
+    if (threads <= 0)
+    {
+        threads = QThread::idealThreadCount();
+    }
+    TaskPool pool(threads);
+    TaskPool *parallel = (pool.threadCount() > 1) ? &pool : 0;
 
-    qDebug("Optimized HPWL2: %d", calculateHPWL(netlist, variants));
+    if ((job->annealingStarts() > 1) && (job->globalPlacer() == PlacementJob::ElectrostaticPlacer) &&
+        job->bufferCell().isEmpty())
+    {
+        /* ePlace depends on the seed, so every start runs its own flow  */
+        if (!placeStarts(netlist, placement, variants, job, inflation, netWeights, parallel))
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        if (!optimizeVariants(netlist, variants, parallel))
+        {
+            qWarning("Can't optimize variants");
+            return 1;
+        }
 
-    //optimizePlacementHPWL(netlist, variants, 10000);
-    //qDebug("Optimized HPWL3: %d", calculateHPWL(netlist, variants));
+        qDebug("Optimized HPWL2: %d", calculateHPWL(netlist, variants));
+
+        if (!annealPlacement(netlist, variants, job, parallel))
+        {
+            qWarning("Can't anneal placement");
+            return 1;
+        }
+    }
+
+    qDebug("Annealed HPWL: %d", calculateHPWL(netlist, variants));
+
+    if ((job->congestionIterations() > 0) || !job->congestionReport().isEmpty())
+    {
+        QScopedPointer<CongestionMap> map(mapCongestion(netlist, variants, job));
+        if (map.isNull())
+        {
+            qWarning("Can't estimate congestion");
+            return 1;
+        }
+        if (!job->congestionReport().isEmpty() && !map->save(job->congestionReport()))
+        {
+            qWarning("Can't save congestion report");
+            return 1;
+        }
+    }
 
     /*foreach (GatePlacement p, placement)
     {
         qDebug("%0.3f;%0.3f", p.x, p.z);
     }*/
 
-    if (!saveRountingTask(args[3], netlist, variants))
+    QScopedPointer<TimingAnalysis> timing;
+    if (job->timingDriven())
+    {
+        timing.reset(analyzeTiming(netlist, variants, job));
+        if (timing.isNull())
+        {
+            qWarning("Can't analyze timing");
+            return 1;
+        }
+    }
+
+    if (!saveRountingTask(args[3], netlist, variants, timing.data()))
     {
         qWarning("Can't save routing task");
         return 1;
@@ -0,0 +1,158 @@
+#include "multistart.h"
+#include <QRunnable>
+#include <QScopedPointer>
+#include "common/netlist.h"
+#include "placementjob.h"
+#include "legalization.h"
+#include "hpwlengine.h"
+#include "annealer.h"
+#include "taskpool.h"
+
+class StartTask : public QRunnable
+{
+public:
+    StartTask(Annealer *annealer, bool &result)
+        : m_annealer(annealer),
+          m_result(result)
+    {
+    }
+
+    void
+    run()
+    {
+        m_result = m_annealer->run();
+    }
+
+private:
+    Annealer *m_annealer;
+    bool &m_result;
+};
+
+/*
+ * Annealer of the gates of the engine on the sites of legalize()
+ */
+Annealer *
+createAnnealer(HpwlEngine *engine, const Netlist *netlist, const PlacementJob *placementJob, int pitch, TaskPool *pool, quint32 seed)
+{
+    QVector<int> gates;
+    foreach (const QString &gateName, netlist->allGates())
+    {
+        gates.append(engine->itemIndex(gateName));
+    }
+
+    Vector<int> min = placementJob->minCoordinates();
+    Vector<int> max = placementJob->maxCoordinates();
+    int xBlocks = (max.x - min.x + 1) / legalizationBlockSize;
+    int zBlocks = (max.z - min.z + 1) / legalizationBlockSize;
+
+    Annealer *annealer = new Annealer(engine, gates, min, xBlocks, zBlocks, legalizationBlockSize);
+    annealer->setTiers(placementJob->tierCount(), pitch);
+    annealer->setEffort(placementJob->annealingEffort());
+    annealer->setVariantMoves(placementJob->annealingVariants());
+    annealer->setPool(pool);
+    annealer->setSeed(seed);
+    return annealer;
+}
+
+/*
+ * Pitch of the annealer tiers, -1 on error
+ */
+int
+annealerPitch(const Netlist *netlist, const CellLibrary *library, const PlacementJob *placementJob)
+{
+    if (placementJob->tierCount() == 1) return 0;
+
+    int pitch = tierPitch(netlist, library, placementJob);
+    return (pitch > 0) ? pitch : -1;
+}
+
+bool
+annealStart(Netlist *netlist, const CellLibrary *library, const PlacementJob *placementJob, int start, TaskPool *pool)
+{
+    if (placementJob->legalizationMode() != PlacementJob::GridLegalization)
+    {
+        qDebug("Annealing needs the site grid, skipped");
+        return true;
+    }
+
+    int pitch = annealerPitch(netlist, library, placementJob);
+    if (pitch < 0) return false;
+
+    QScopedPointer<HpwlEngine> engine(HpwlEngine::build(netlist, library));
+    if (engine.isNull()) return false;
+
+    QScopedPointer<Annealer> annealer(createAnnealer(engine.data(), netlist, placementJob, pitch, pool,
+                                                     placementJob->seed() + start));
+    if (!annealer->run()) return false;
+
+    engine->save(netlist);
+    return true;
+}
+
+bool
+annealPlacement(Netlist *netlist, const CellLibrary *library, const PlacementJob *placementJob, TaskPool *pool)
+{
+    if (placementJob->legalizationMode() != PlacementJob::GridLegalization)
+    {
+        qDebug("Annealing needs the site grid, skipped");
+        return true;
+    }
+
+    int pitch = annealerPitch(netlist, library, placementJob);
+    if (pitch < 0) return false;
+
+    int starts = placementJob->annealingStarts();
+
+    QList<HpwlEngine *> engines;
+    QList<Annealer *> annealers;
+    for (int start = 0; start < starts; start++)
+    {
+        HpwlEngine *engine = HpwlEngine::build(netlist, library);
+        if (engine == 0)
+        {
+            qDeleteAll(annealers);
+            qDeleteAll(engines);
+            return false;
+        }
+
+        /* The pool runs several starts at once, so every start anneals its tiles sequentially  */
+        engines.append(engine);
+        annealers.append(createAnnealer(engine, netlist, placementJob, pitch, (starts == 1) ? pool : 0, placementJob->seed() + start));
+    }
+
+    QVector<bool> results(starts, false);
+    if ((pool == 0) || (starts == 1))
+    {
+        for (int start = 0; start < starts; start++)
+        {
+            results[start] = annealers[start]->run();
+        }
+    }
+    else
+    {
+        TaskGroup group(pool);
+        for (int start = 0; start < starts; start++)
+        {
+            group.run(new StartTask(annealers[start], results[start]));
+        }
+        group.wait();
+    }
+
+    int best = -1;
+    for (int start = 0; start < starts; start++)
+    {
+        if (!results[start]) continue;
+
+        if (starts > 1)
+        {
+            qDebug("Start %d: HPWL %d", start, engines[start]->hpwl());
+        }
+        if ((best < 0) || (engines[start]->hpwl() < engines[best]->hpwl())) best = start;
+    }
+    if (best >= 0) engines[best]->save(netlist);
+
+    qDeleteAll(annealers);
+    qDeleteAll(engines);
+
+    return best >= 0;
+}
@@ -0,0 +1,25 @@
+#ifndef MULTISTART_H
+#define MULTISTART_H
+
+class Netlist;
+class CellLibrary;
+class PlacementJob;
+class TaskPool;
+
+/*
+ * Anneals the legal placement of the netlist and saves the result to it.
+ *
+ * With several starts every start anneals its own copy of the same legal
+ * placement with its own seed, only the annealing restarts. The starts run
+ * at the same time on the pool. The start with the lowest HPWL wins, ties
+ * go to the lower seed, so the result doesn't depend on the thread count.
+ * Gates legalized into rows are not annealed, the annealer swaps sites.
+ */
+bool
+annealPlacement(Netlist *netlist, const CellLibrary *library, const PlacementJob *placementJob, TaskPool *pool);
+
+// Anneals the legal placement of the netlist once with the seed seed() + start, for starts that place on their own
+bool
+annealStart(Netlist *netlist, const CellLibrary *library, const PlacementJob *placementJob, int start, TaskPool *pool);
+
+#endif // MULTISTART_H
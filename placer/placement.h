@@ -3,8 +3,15 @@
 
 #include "common/vector.h"
 #include <QMap>
+#include <QVector>
 
 typedef Vector<float> GatePlacement;
 typedef QMap<QString, GatePlacement> NetPlacement;
 
+// Gate -> area factor for global placement, missing gates have 1
+typedef QMap<QString, double> GateInflation;
+
+// Netlist net -> weight of its wirelength in global placement, empty: all nets have 1
+typedef QVector<double> NetWeights;
+
 #endif // PLACEMENT_H
@@ -0,0 +1,249 @@
+#include "placementdb.h"
+#include "common/netlist.h"
+#include <QHash>
+#include <QScopedPointer>
+
+PlacementDb::PlacementDb()
+{
+    m_gateCount = 0;
+}
+
+int
+PlacementDb::cellCount() const
+{
+    return m_cellNames.size();
+}
+
+int
+PlacementDb::gateCount() const
+{
+    return m_gateCount;
+}
+
+int
+PlacementDb::netCount() const
+{
+    return m_netPointers.size() - 1;
+}
+
+int
+PlacementDb::pinCount() const
+{
+    return m_pinCells.size();
+}
+
+bool
+PlacementDb::isGate(int cell) const
+{
+    return cell < m_gateCount;
+}
+
+QString
+PlacementDb::cellName(int cell) const
+{
+    return m_cellNames[cell];
+}
+
+const QVector<int> &
+PlacementDb::netPointers() const
+{
+    return m_netPointers;
+}
+
+const QVector<int> &
+PlacementDb::pinCells() const
+{
+    return m_pinCells;
+}
+
+const QVector<int> &
+PlacementDb::cellNetPointers() const
+{
+    return m_cellNetPointers;
+}
+
+const QVector<int> &
+PlacementDb::cellNets() const
+{
+    return m_cellNets;
+}
+
+QVector<QPointF> &
+PlacementDb::positions()
+{
+    return m_positions;
+}
+
+const QVector<QPointF> &
+PlacementDb::positions() const
+{
+    return m_positions;
+}
+
+QVector<double> &
+PlacementDb::netWeights()
+{
+    return m_netWeights;
+}
+
+const QVector<double> &
+PlacementDb::netWeights() const
+{
+    return m_netWeights;
+}
+
+double
+PlacementDb::netWeight(int net) const
+{
+    return m_netWeights.isEmpty() ? 1.0 : m_netWeights[net];
+}
+
+PlacementDb *
+PlacementDb::build(const Netlist *netlist)
+{
+    QScopedPointer<PlacementDb> db(new PlacementDb());
+
+    /* Netlist IDs follow the names, so cell IDs don't depend on hash order  */
+    QVector<int> gates;
+    QVector<int> pads;
+    for (int item = 0; item < netlist->itemCount(); item++)
+    {
+        if (netlist->isDeleted(item)) continue;
+
+        if (netlist->isPad(item))
+        {
+            pads.append(item);
+        }
+        else
+        {
+            gates.append(item);
+        }
+    }
+
+    QVector<int> cellIndexes(netlist->itemCount(), -1);
+    foreach (int item, gates)
+    {
+        cellIndexes[item] = db->m_cellNames.size();
+        db->m_cellNames.append(netlist->itemName(item));
+    }
+    db->m_gateCount = gates.size();
+    foreach (int item, pads)
+    {
+        cellIndexes[item] = db->m_cellNames.size();
+        db->m_cellNames.append(netlist->itemName(item));
+    }
+
+    db->m_positions.fill(QPointF(), db->m_cellNames.size());
+    foreach (int item, pads)
+    {
+        if (!netlist->hasPosition(item))
+        {
+            qWarning("Can't get pad coordinates for %s", qPrintable(netlist->itemName(item)));
+            return 0;
+        }
+        Vector<int> p = netlist->position(item);
+        db->m_positions[cellIndexes[item]] = QPointF(p.x, p.z);
+    }
+
+    /* Net -> pins, one pin per cell of the net, cells deleted from the netlist are skipped  */
+    int netCount = netlist->netCount();
+    db->m_netPointers.reserve(netCount + 1);
+    db->m_netPointers.append(0);
+    for (int net = 0; net < netCount; net++)
+    {
+        QVector<int> items;
+        for (int pin = netlist->netPinBegin(net); pin < netlist->netPinEnd(net); pin++)
+        {
+            if (cellIndexes[netlist->pinItem(pin)] >= 0) items.append(netlist->pinItem(pin));
+        }
+        qSort(items);
+        for (int i = 0; i < items.size(); i++)
+        {
+            if ((i == 0) || (items[i] != items[i - 1])) db->m_pinCells.append(cellIndexes[items[i]]);
+        }
+        db->m_netPointers.append(db->m_pinCells.size());
+    }
+
+    db->buildCellNets();
+
+    return db.take();
+}
+
+PlacementDb *
+PlacementDb::cluster(const PlacementDb *db, const QVector<int> &clusters, int clusterCount)
+{
+    QScopedPointer<PlacementDb> coarse(new PlacementDb());
+
+    /* Clusters are named after their first gate, pads follow them  */
+    QVector<int> cellIndexes(db->cellCount());
+    coarse->m_cellNames.resize(clusterCount);
+    for (int gate = db->gateCount() - 1; gate >= 0; gate--)
+    {
+        cellIndexes[gate] = clusters[gate];
+        coarse->m_cellNames[clusters[gate]] = db->m_cellNames[gate];
+    }
+    coarse->m_gateCount = clusterCount;
+    coarse->m_positions.fill(QPointF(), clusterCount);
+    for (int cell = db->gateCount(); cell < db->cellCount(); cell++)
+    {
+        cellIndexes[cell] = coarse->m_cellNames.size();
+        coarse->m_cellNames.append(db->m_cellNames[cell]);
+        coarse->m_positions.append(db->m_positions[cell]);
+    }
+
+    /* Nets inside a cluster are dropped  */
+    QVector<int> marks(coarse->cellCount(), -1);
+    coarse->m_netPointers.append(0);
+    for (int net = 0; net < db->netCount(); net++)
+    {
+        int start = coarse->m_pinCells.size();
+        for (int pin = db->m_netPointers[net]; pin < db->m_netPointers[net + 1]; pin++)
+        {
+            int cell = cellIndexes[db->m_pinCells[pin]];
+            if (marks[cell] == net) continue;
+
+            marks[cell] = net;
+            coarse->m_pinCells.append(cell);
+        }
+
+        if (coarse->m_pinCells.size() - start < 2)
+        {
+            coarse->m_pinCells.resize(start);
+            continue;
+        }
+        coarse->m_netPointers.append(coarse->m_pinCells.size());
+        if (!db->m_netWeights.isEmpty()) coarse->m_netWeights.append(db->m_netWeights[net]);
+    }
+
+    coarse->buildCellNets();
+
+    return coarse.take();
+}
+
+/*
+ * Cell -> nets, transposed net -> pins
+ */
+void
+PlacementDb::buildCellNets()
+{
+    int cellCount = m_cellNames.size();
+    m_cellNetPointers.fill(0, cellCount + 1);
+    foreach (int cell, m_pinCells)
+    {
+        m_cellNetPointers[cell + 1]++;
+    }
+    for (int i = 0; i < cellCount; i++)
+    {
+        m_cellNetPointers[i + 1] += m_cellNetPointers[i];
+    }
+
+    QVector<int> fill = m_cellNetPointers;
+    m_cellNets.resize(m_pinCells.size());
+    for (int net = 0; net < netCount(); net++)
+    {
+        for (int pin = m_netPointers[net]; pin < m_netPointers[net + 1]; pin++)
+        {
+            m_cellNets[fill[m_pinCells[pin]]++] = net;
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef PLACEMENTDB_H
+#define PLACEMENTDB_H
+
+#include <QString>
+#include <QVector>
+#include <QPointF>
+
+class Netlist;
+
+/*
+ * Flat placement database with dense integer IDs.
+ *
+ * Cells: gates are [0; gateCount()), pads follow them.
+ * Nets are stored in CSR form: pins of net n are
+ * [netPointers()[n]; netPointers()[n + 1]) and pinCells()[pin] is the cell of the pin.
+ * Nets of a cell are stored the same way (cellNetPointers(), cellNets()).
+ *
+ * Net IDs of build() are the net IDs of the netlist.
+ * Names are kept only to read the netlist and to save the placement.
+ */
+class PlacementDb
+{
+public:
+    PlacementDb();
+
+    int
+    cellCount() const;
+
+    int
+    gateCount() const;
+
+    int
+    netCount() const;
+
+    int
+    pinCount() const;
+
+    bool
+    isGate(int cell) const;
+
+    QString
+    cellName(int cell) const;
+
+public:
+    const QVector<int> &
+    netPointers() const;
+
+    const QVector<int> &
+    pinCells() const;
+
+    const QVector<int> &
+    cellNetPointers() const;
+
+    const QVector<int> &
+    cellNets() const;
+
+public:
+    // Positions in the (x, z) plane, pads keep their netlist coordinates
+    QVector<QPointF> &
+    positions();
+
+    const QVector<QPointF> &
+    positions() const;
+
+public:
+    // Net -> weight of its wirelength, empty: all nets weigh 1
+    QVector<double> &
+    netWeights();
+
+    const QVector<double> &
+    netWeights() const;
+
+    double
+    netWeight(int net) const;
+
+public:
+    static PlacementDb *
+    build(const Netlist *netlist);
+
+    // Gates of db merged into clusters[gate], pads are kept, nets inside a cluster are dropped
+    static PlacementDb *
+    cluster(const PlacementDb *db, const QVector<int> &clusters, int clusterCount);
+
+private:
+    void
+    buildCellNets();
+
+private:
+    int m_gateCount;
+
+    QVector<QString> m_cellNames;
+
+    QVector<int> m_netPointers;
+    QVector<int> m_pinCells;
+
+    QVector<int> m_cellNetPointers;
+    QVector<int> m_cellNets;
+
+    QVector<QPointF> m_positions;
+    QVector<double> m_netWeights;
+};
+
+#endif // PLACEMENTDB_H
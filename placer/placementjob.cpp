@@ -1,10 +1,62 @@
 #include "placementjob.h"
 #include <QFile>
+#include "legalization.h"
 
 PlacementJob::PlacementJob()
 {
     m_minX = m_minY = m_minZ = 0;
     m_maxX = m_maxY = m_maxZ = 0;
+
+    m_globalPlacer = QuadraticPlacer;
+    m_targetDensity = 1.0;
+    m_targetOverflow = 0.1;
+    m_globalIterations = 1000;
+
+    m_solver = LinearSolver::BlockConjugateGradient;
+    m_preconditioner = Preconditioner::IncompleteCholesky;
+
+    m_netModel = StarNetModel;
+    m_netModelIterations = 2;
+
+    m_partitionBalance = CountBalance;
+    m_partitionPasses = 4;
+    m_partitionTolerance = 0.02;
+    m_coarseningThreshold = 1000;
+
+    m_clusteringThreshold = 5000;
+
+    m_legalizationMode = GridLegalization;
+    m_legalizationSpacing = 0;
+    m_rowSpacing = 0;
+    m_defaultHalo = 0;
+
+    m_tierCount = 1;
+    m_tierSpacing = 2;
+
+    m_annealingEffort = 0.5;
+    m_annealingVariants = true;
+    m_annealingStarts = 1;
+
+    m_hasRoutingArea = false;
+    m_congestionIterations = 0;
+    m_congestionTarget = 1.0;
+
+    m_timingDriven = false;
+    m_defaultTiming.delay = 1;
+    m_defaultTiming.output = "Y";
+    m_maxWireLength = 15;
+    m_repeaterDelay = 1;
+    m_timingIterations = 0;
+    m_timingWeight = 2.0;
+
+    m_maxFanout = 8;
+    m_bufferSpacing = 0.0;
+    m_bufferUtilization = 0.8;
+
+    m_threadCount = 0;
+    m_parallelCutoff = 64;
+
+    m_seed = 0;
 }
 
 void
@@ -51,6 +103,246 @@ PlacementJob::maxCoordinates() const
     return Vector<int>(m_maxX, m_maxY, m_maxZ);
 }
 
+PlacementJob::GlobalPlacer
+PlacementJob::globalPlacer() const
+{
+    return m_globalPlacer;
+}
+
+double
+PlacementJob::targetDensity() const
+{
+    return m_targetDensity;
+}
+
+double
+PlacementJob::targetOverflow() const
+{
+    return m_targetOverflow;
+}
+
+int
+PlacementJob::globalIterations() const
+{
+    return m_globalIterations;
+}
+
+LinearSolver::Type
+PlacementJob::solver() const
+{
+    return m_solver;
+}
+
+Preconditioner::Type
+PlacementJob::preconditioner() const
+{
+    return m_preconditioner;
+}
+
+PlacementJob::NetModel
+PlacementJob::netModel() const
+{
+    return m_netModel;
+}
+
+int
+PlacementJob::netModelIterations() const
+{
+    return m_netModelIterations;
+}
+
+PlacementJob::PartitionBalance
+PlacementJob::partitionBalance() const
+{
+    return m_partitionBalance;
+}
+
+int
+PlacementJob::partitionPasses() const
+{
+    return m_partitionPasses;
+}
+
+double
+PlacementJob::partitionTolerance() const
+{
+    return m_partitionTolerance;
+}
+
+int
+PlacementJob::coarseningThreshold() const
+{
+    return m_coarseningThreshold;
+}
+
+int
+PlacementJob::clusteringThreshold() const
+{
+    return m_clusteringThreshold;
+}
+
+PlacementJob::LegalizationMode
+PlacementJob::legalizationMode() const
+{
+    return m_legalizationMode;
+}
+
+int
+PlacementJob::legalizationSpacing() const
+{
+    return m_legalizationSpacing;
+}
+
+int
+PlacementJob::rowSpacing() const
+{
+    return m_rowSpacing;
+}
+
+int
+PlacementJob::cellHalo(const QString &cellType) const
+{
+    return m_cellHalos.value(cellType, m_defaultHalo);
+}
+
+int
+PlacementJob::tierCount() const
+{
+    return m_tierCount;
+}
+
+int
+PlacementJob::tierSpacing() const
+{
+    return m_tierSpacing;
+}
+
+double
+PlacementJob::annealingEffort() const
+{
+    return m_annealingEffort;
+}
+
+bool
+PlacementJob::annealingVariants() const
+{
+    return m_annealingVariants;
+}
+
+int
+PlacementJob::annealingStarts() const
+{
+    return m_annealingStarts;
+}
+
+Vector<int>
+PlacementJob::routingMinCoordinates() const
+{
+    return m_hasRoutingArea ? m_routingMin : minCoordinates();
+}
+
+Vector<int>
+PlacementJob::routingMaxCoordinates() const
+{
+    return m_hasRoutingArea ? m_routingMax : maxCoordinates();
+}
+
+int
+PlacementJob::congestionIterations() const
+{
+    return m_congestionIterations;
+}
+
+double
+PlacementJob::congestionTarget() const
+{
+    return m_congestionTarget;
+}
+
+QString
+PlacementJob::congestionReport() const
+{
+    return m_congestionReport;
+}
+
+bool
+PlacementJob::timingDriven() const
+{
+    return m_timingDriven;
+}
+
+PlacementJob::CellTiming
+PlacementJob::cellTiming(const QString &cellType) const
+{
+    return m_cellTimings.value(cellType, m_defaultTiming);
+}
+
+int
+PlacementJob::maxWireLength() const
+{
+    return m_maxWireLength;
+}
+
+int
+PlacementJob::repeaterDelay() const
+{
+    return m_repeaterDelay;
+}
+
+int
+PlacementJob::timingIterations() const
+{
+    return m_timingIterations;
+}
+
+double
+PlacementJob::timingWeight() const
+{
+    return m_timingWeight;
+}
+
+QString
+PlacementJob::bufferCell() const
+{
+    return m_bufferCell;
+}
+
+int
+PlacementJob::maxFanout() const
+{
+    return m_maxFanout;
+}
+
+double
+PlacementJob::bufferSpacing() const
+{
+    return (m_bufferSpacing > 0.0) ? m_bufferSpacing : m_maxWireLength;
+}
+
+double
+PlacementJob::bufferUtilization() const
+{
+    return m_bufferUtilization;
+}
+
+int
+PlacementJob::threadCount() const
+{
+    return m_threadCount;
+}
+
+int
+PlacementJob::parallelCutoff() const
+{
+    return m_parallelCutoff;
+}
+
+quint32
+PlacementJob::seed() const
+{
+    return m_seed;
+}
+
 PlacementJob *
 PlacementJob::readFromFile(const QString &filePath)
 {
@@ -81,6 +373,58 @@ PlacementJob::readFromFile(const QString &filePath)
             {
                 if (!job->parsePads(xml)) return 0;
             }
+            else if (xml.name() == "globalPlacement")
+            {
+                if (!job->parseGlobalPlacement(xml)) return 0;
+            }
+            else if (xml.name() == "solver")
+            {
+                if (!job->parseSolver(xml)) return 0;
+            }
+            else if (xml.name() == "netModel")
+            {
+                if (!job->parseNetModel(xml)) return 0;
+            }
+            else if (xml.name() == "partition")
+            {
+                if (!job->parsePartition(xml)) return 0;
+            }
+            else if (xml.name() == "clustering")
+            {
+                if (!job->parseClustering(xml)) return 0;
+            }
+            else if (xml.name() == "legalization")
+            {
+                if (!job->parseLegalization(xml)) return 0;
+            }
+            else if (xml.name() == "tiers")
+            {
+                if (!job->parseTiers(xml)) return 0;
+            }
+            else if (xml.name() == "annealing")
+            {
+                if (!job->parseAnnealing(xml)) return 0;
+            }
+            else if (xml.name() == "congestion")
+            {
+                if (!job->parseCongestion(xml)) return 0;
+            }
+            else if (xml.name() == "timing")
+            {
+                if (!job->parseTiming(xml)) return 0;
+            }
+            else if (xml.name() == "buffering")
+            {
+                if (!job->parseBuffering(xml)) return 0;
+            }
+            else if (xml.name() == "parallel")
+            {
+                if (!job->parseParallel(xml)) return 0;
+            }
+            else if (xml.name() == "random")
+            {
+                if (!job->parseRandom(xml)) return 0;
+            }
         }
     }
 
@@ -104,29 +448,8 @@ PlacementJob::parseArea(QXmlStreamReader &xml)
         {
             if ((xml.name() == "max") || (xml.name() == "min"))
             {
-                QXmlStreamAttributes attributes = xml.attributes();
-                QString sx = attributes.value("x").toString();
-                QString sy = attributes.value("y").toString();
-                QString sz = attributes.value("z").toString();
-
-                if (sx.isEmpty() || sy.isEmpty() || sz.isEmpty())
-                {
-                    parserError(xml, "area coordinates are invalid");
-                    return false;
-                }
-
-                bool okX, okY, okZ;
                 int x, y, z;
-
-                x = sx.toInt(&okX);
-                y = sy.toInt(&okY);
-                z = sz.toInt(&okZ);
-
-                if (!okX || !okY || !okZ)
-                {
-                    parserError(xml, "can't convert area coordinates into numbers");
-                    return false;
-                }
+                if (!parseCoordinates(xml, x, y, z)) return false;
 
                 if (xml.name() == "max")
                 {
@@ -146,6 +469,34 @@ PlacementJob::parseArea(QXmlStreamReader &xml)
     return true;
 }
 
+bool
+PlacementJob::parseCoordinates(QXmlStreamReader &xml, int &x, int &y, int &z)
+{
+    QXmlStreamAttributes attributes = xml.attributes();
+    QString sx = attributes.value("x").toString();
+    QString sy = attributes.value("y").toString();
+    QString sz = attributes.value("z").toString();
+
+    if (sx.isEmpty() || sy.isEmpty() || sz.isEmpty())
+    {
+        parserError(xml, "area coordinates are invalid");
+        return false;
+    }
+
+    bool okX, okY, okZ;
+
+    x = sx.toInt(&okX);
+    y = sy.toInt(&okY);
+    z = sz.toInt(&okZ);
+
+    if (!okX || !okY || !okZ)
+    {
+        parserError(xml, "can't convert area coordinates into numbers");
+        return false;
+    }
+    return true;
+}
+
 bool
 PlacementJob::parsePads(QXmlStreamReader &xml)
 {
@@ -216,6 +567,652 @@ PlacementJob::parsePads(QXmlStreamReader &xml)
     return true;
 }
 
+bool
+PlacementJob::parseSolver(QXmlStreamReader &xml)
+{
+    QXmlStreamAttributes attributes = xml.attributes();
+
+    QString type = attributes.value("type").toString();
+    if (type == "cg")
+    {
+        m_solver = LinearSolver::ConjugateGradient;
+    }
+    else if (type.isEmpty() || (type == "blockcg"))
+    {
+        m_solver = LinearSolver::BlockConjugateGradient;
+    }
+    else if (type == "cholesky")
+    {
+        m_solver = LinearSolver::Cholesky;
+    }
+    else
+    {
+        parserError(xml, "unknown solver type");
+        return false;
+    }
+
+    QString preconditioner = attributes.value("preconditioner").toString();
+    if (preconditioner.isEmpty() || (preconditioner == "ic"))
+    {
+        m_preconditioner = Preconditioner::IncompleteCholesky;
+    }
+    else if (preconditioner == "jacobi")
+    {
+        m_preconditioner = Preconditioner::Jacobi;
+    }
+    else if (preconditioner == "none")
+    {
+        m_preconditioner = Preconditioner::None;
+    }
+    else
+    {
+        parserError(xml, "unknown preconditioner");
+        return false;
+    }
+
+    return true;
+}
+
+bool
+PlacementJob::parseGlobalPlacement(QXmlStreamReader &xml)
+{
+    QXmlStreamAttributes attributes = xml.attributes();
+
+    QString type = attributes.value("type").toString();
+    if (type.isEmpty() || (type == "quadratic"))
+    {
+        m_globalPlacer = QuadraticPlacer;
+    }
+    else if (type == "electrostatic")
+    {
+        m_globalPlacer = ElectrostaticPlacer;
+    }
+    else
+    {
+        parserError(xml, "unknown global placer");
+        return false;
+    }
+
+    QString density = attributes.value("density").toString();
+    if (!density.isEmpty())
+    {
+        bool ok;
+        m_targetDensity = density.toDouble(&ok);
+        if (!ok || (m_targetDensity <= 0.0) || (m_targetDensity > 1.0))
+        {
+            parserError(xml, "invalid target density");
+            return false;
+        }
+    }
+
+    QString overflow = attributes.value("overflow").toString();
+    if (!overflow.isEmpty())
+    {
+        bool ok;
+        m_targetOverflow = overflow.toDouble(&ok);
+        if (!ok || (m_targetOverflow < 0.0))
+        {
+            parserError(xml, "invalid target overflow");
+            return false;
+        }
+    }
+
+    QString iterations = attributes.value("iterations").toString();
+    if (!iterations.isEmpty())
+    {
+        bool ok;
+        m_globalIterations = iterations.toInt(&ok);
+        if (!ok || (m_globalIterations < 0))
+        {
+            parserError(xml, "invalid number of global placement iterations");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+PlacementJob::parseNetModel(QXmlStreamReader &xml)
+{
+    QXmlStreamAttributes attributes = xml.attributes();
+
+    QString type = attributes.value("type").toString();
+    if (type == "clique")
+    {
+        m_netModel = CliqueNetModel;
+    }
+    else if (type.isEmpty() || (type == "star"))
+    {
+        m_netModel = StarNetModel;
+    }
+    else if (type == "b2b")
+    {
+        m_netModel = Bound2BoundNetModel;
+    }
+    else
+    {
+        parserError(xml, "unknown net model");
+        return false;
+    }
+
+    QString iterations = attributes.value("iterations").toString();
+    if (!iterations.isEmpty())
+    {
+        bool ok;
+        m_netModelIterations = iterations.toInt(&ok);
+        if (!ok || (m_netModelIterations < 0))
+        {
+            parserError(xml, "invalid number of net model iterations");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+PlacementJob::parsePartition(QXmlStreamReader &xml)
+{
+    QXmlStreamAttributes attributes = xml.attributes();
+
+    QString balance = attributes.value("balance").toString();
+    if (balance.isEmpty() || (balance == "count"))
+    {
+        m_partitionBalance = CountBalance;
+    }
+    else if (balance == "area")
+    {
+        m_partitionBalance = AreaBalance;
+    }
+    else
+    {
+        parserError(xml, "unknown partition balance");
+        return false;
+    }
+
+    QString passes = attributes.value("passes").toString();
+    if (!passes.isEmpty())
+    {
+        bool ok;
+        m_partitionPasses = passes.toInt(&ok);
+        if (!ok || (m_partitionPasses < 0))
+        {
+            parserError(xml, "invalid number of partition passes");
+            return false;
+        }
+    }
+
+    QString tolerance = attributes.value("tolerance").toString();
+    if (!tolerance.isEmpty())
+    {
+        bool ok;
+        m_partitionTolerance = tolerance.toDouble(&ok);
+        if (!ok || (m_partitionTolerance < 0.0) || (m_partitionTolerance >= 0.5))
+        {
+            parserError(xml, "invalid partition tolerance");
+            return false;
+        }
+    }
+
+    QString multilevel = attributes.value("multilevel").toString();
+    if (!multilevel.isEmpty())
+    {
+        bool ok;
+        m_coarseningThreshold = multilevel.toInt(&ok);
+        if (!ok || (m_coarseningThreshold < 0))
+        {
+            parserError(xml, "invalid coarsening threshold");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+PlacementJob::parseClustering(QXmlStreamReader &xml)
+{
+    QXmlStreamAttributes attributes = xml.attributes();
+
+    QString threshold = attributes.value("threshold").toString();
+    if (!threshold.isEmpty())
+    {
+        bool ok;
+        m_clusteringThreshold = threshold.toInt(&ok);
+        if (!ok || (m_clusteringThreshold < 0))
+        {
+            parserError(xml, "invalid clustering threshold");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+PlacementJob::parseLegalization(QXmlStreamReader &xml)
+{
+    QXmlStreamAttributes attributes = xml.attributes();
+
+    QString mode = attributes.value("mode").toString();
+    if (mode.isEmpty() || (mode == "grid"))
+    {
+        m_legalizationMode = GridLegalization;
+    }
+    else if (mode == "rows")
+    {
+        m_legalizationMode = RowLegalization;
+    }
+    else
+    {
+        parserError(xml, "unknown legalization mode");
+        return false;
+    }
+
+    QString spacing = attributes.value("spacing").toString();
+    if (!spacing.isEmpty())
+    {
+        bool ok;
+        m_legalizationSpacing = spacing.toInt(&ok);
+        if (!ok || (m_legalizationSpacing < 0))
+        {
+            parserError(xml, "invalid legalization spacing");
+            return false;
+        }
+    }
+
+    QString rowSpacing = attributes.value("rowSpacing").toString();
+    if (!rowSpacing.isEmpty())
+    {
+        bool ok;
+        m_rowSpacing = rowSpacing.toInt(&ok);
+        if (!ok || (m_rowSpacing < 0))
+        {
+            parserError(xml, "invalid row spacing");
+            return false;
+        }
+    }
+
+    QString halo = attributes.value("halo").toString();
+    if (!halo.isEmpty())
+    {
+        bool ok;
+        m_defaultHalo = halo.toInt(&ok);
+        if (!ok || (m_defaultHalo < 0))
+        {
+            parserError(xml, "invalid cell halo");
+            return false;
+        }
+    }
+
+    /* Halos of single cells: <cell name="XOR2" halo="1"/>  */
+    while (!(xml.tokenType() == QXmlStreamReader::EndElement && xml.name() == "legalization"))
+    {
+        QXmlStreamReader::TokenType token = xml.readNext();
+        if (xml.hasError()) return false;
+
+        if ((token == QXmlStreamReader::StartElement) && (xml.name() == "cell"))
+        {
+            QString name = xml.attributes().value("name").toString();
+            bool ok;
+            int cellHalo = xml.attributes().value("halo").toString().toInt(&ok);
+            if (name.isEmpty() || !ok || (cellHalo < 0))
+            {
+                parserError(xml, "invalid legalization cell");
+                return false;
+            }
+            m_cellHalos[name] = cellHalo;
+        }
+    }
+
+    return true;
+}
+
+bool
+PlacementJob::parseTiers(QXmlStreamReader &xml)
+{
+    QXmlStreamAttributes attributes = xml.attributes();
+
+    QString count = attributes.value("count").toString();
+    if (!count.isEmpty())
+    {
+        bool ok;
+        m_tierCount = count.toInt(&ok);
+        if (!ok || (m_tierCount < 1))
+        {
+            parserError(xml, "invalid tier count");
+            return false;
+        }
+    }
+
+    QString spacing = attributes.value("spacing").toString();
+    if (!spacing.isEmpty())
+    {
+        bool ok;
+        m_tierSpacing = spacing.toInt(&ok);
+        if (!ok || (m_tierSpacing < 0))
+        {
+            parserError(xml, "invalid tier spacing");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+PlacementJob::parseAnnealing(QXmlStreamReader &xml)
+{
+    QXmlStreamAttributes attributes = xml.attributes();
+
+    QString effort = attributes.value("effort").toString();
+    if (!effort.isEmpty())
+    {
+        bool ok;
+        m_annealingEffort = effort.toDouble(&ok);
+        if (!ok || (m_annealingEffort < 0.0))
+        {
+            parserError(xml, "invalid annealing effort");
+            return false;
+        }
+    }
+
+    QString variants = attributes.value("variants").toString();
+    if (variants.isEmpty() || (variants == "true"))
+    {
+        m_annealingVariants = true;
+    }
+    else if (variants == "false")
+    {
+        m_annealingVariants = false;
+    }
+    else
+    {
+        parserError(xml, "invalid annealing variants flag");
+        return false;
+    }
+
+    QString starts = attributes.value("starts").toString();
+    if (!starts.isEmpty())
+    {
+        bool ok;
+        m_annealingStarts = starts.toInt(&ok);
+        if (!ok || (m_annealingStarts < 1))
+        {
+            parserError(xml, "invalid number of annealing starts");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+PlacementJob::parseCongestion(QXmlStreamReader &xml)
+{
+    QXmlStreamAttributes attributes = xml.attributes();
+
+    QString iterations = attributes.value("iterations").toString();
+    if (!iterations.isEmpty())
+    {
+        bool ok;
+        m_congestionIterations = iterations.toInt(&ok);
+        if (!ok || (m_congestionIterations < 0))
+        {
+            parserError(xml, "invalid number of congestion iterations");
+            return false;
+        }
+    }
+
+    QString target = attributes.value("target").toString();
+    if (!target.isEmpty())
+    {
+        bool ok;
+        m_congestionTarget = target.toDouble(&ok);
+        if (!ok || (m_congestionTarget <= 0.0))
+        {
+            parserError(xml, "invalid congestion target");
+            return false;
+        }
+    }
+
+    m_congestionReport = attributes.value("report").toString();
+
+    /* Optional routing area, same form as <area>  */
+    while (!(xml.tokenType() == QXmlStreamReader::EndElement && xml.name() == "congestion"))
+    {
+        QXmlStreamReader::TokenType token = xml.readNext();
+        if (xml.hasError()) return false;
+
+        if (token == QXmlStreamReader::StartElement)
+        {
+            if ((xml.name() == "max") || (xml.name() == "min"))
+            {
+                int x, y, z;
+                if (!parseCoordinates(xml, x, y, z)) return false;
+
+                m_hasRoutingArea = true;
+                if (xml.name() == "max")
+                {
+                    m_routingMax = Vector<int>(x, y, z);
+                }
+                else
+                {
+                    m_routingMin = Vector<int>(x, y, z);
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+bool
+PlacementJob::parseTiming(QXmlStreamReader &xml)
+{
+    QXmlStreamAttributes attributes = xml.attributes();
+
+    m_timingDriven = true;
+    if (!parseCellTiming(xml, m_defaultTiming)) return false;
+
+    QString maxWireLength = attributes.value("maxWireLength").toString();
+    if (!maxWireLength.isEmpty())
+    {
+        bool ok;
+        m_maxWireLength = maxWireLength.toInt(&ok);
+        if (!ok || (m_maxWireLength <= 0))
+        {
+            parserError(xml, "invalid maximal wire length");
+            return false;
+        }
+    }
+
+    QString repeaterDelay = attributes.value("repeaterDelay").toString();
+    if (!repeaterDelay.isEmpty())
+    {
+        bool ok;
+        m_repeaterDelay = repeaterDelay.toInt(&ok);
+        if (!ok || (m_repeaterDelay < 0))
+        {
+            parserError(xml, "invalid repeater delay");
+            return false;
+        }
+    }
+
+    QString iterations = attributes.value("iterations").toString();
+    if (!iterations.isEmpty())
+    {
+        bool ok;
+        m_timingIterations = iterations.toInt(&ok);
+        if (!ok || (m_timingIterations < 0))
+        {
+            parserError(xml, "invalid number of timing iterations");
+            return false;
+        }
+    }
+
+    QString weight = attributes.value("weight").toString();
+    if (!weight.isEmpty())
+    {
+        bool ok;
+        m_timingWeight = weight.toDouble(&ok);
+        if (!ok || (m_timingWeight < 0.0))
+        {
+            parserError(xml, "invalid timing weight");
+            return false;
+        }
+    }
+
+    /* Cell library: <cell name="NOT" delay="1" output="Y"/>  */
+    while (!(xml.tokenType() == QXmlStreamReader::EndElement && xml.name() == "timing"))
+    {
+        QXmlStreamReader::TokenType token = xml.readNext();
+        if (xml.hasError()) return false;
+
+        if ((token == QXmlStreamReader::StartElement) && (xml.name() == "cell"))
+        {
+            QString name = xml.attributes().value("name").toString();
+            if (name.isEmpty())
+            {
+                parserError(xml, "timing cell name is invalid");
+                return false;
+            }
+
+            CellTiming timing = m_defaultTiming;
+            if (!parseCellTiming(xml, timing)) return false;
+            m_cellTimings[name] = timing;
+        }
+    }
+
+    return true;
+}
+
+bool
+PlacementJob::parseCellTiming(QXmlStreamReader &xml, CellTiming &timing)
+{
+    QXmlStreamAttributes attributes = xml.attributes();
+
+    QString delay = attributes.value("delay").toString();
+    if (!delay.isEmpty())
+    {
+        bool ok;
+        timing.delay = delay.toInt(&ok);
+        if (!ok || (timing.delay < 0))
+        {
+            parserError(xml, "invalid cell delay");
+            return false;
+        }
+    }
+
+    QString output = attributes.value("output").toString();
+    if (!output.isEmpty())
+    {
+        timing.output = output;
+    }
+
+    return true;
+}
+
+bool
+PlacementJob::parseBuffering(QXmlStreamReader &xml)
+{
+    QXmlStreamAttributes attributes = xml.attributes();
+
+    m_bufferCell = attributes.value("cell").toString();
+    if (m_bufferCell.isEmpty()) m_bufferCell = "BUF";
+
+    QString maxFanout = attributes.value("maxFanout").toString();
+    if (!maxFanout.isEmpty())
+    {
+        bool ok;
+        m_maxFanout = maxFanout.toInt(&ok);
+        if (!ok || (m_maxFanout < 2))
+        {
+            parserError(xml, "invalid maximal fanout");
+            return false;
+        }
+    }
+
+    QString spacing = attributes.value("spacing").toString();
+    if (!spacing.isEmpty())
+    {
+        bool ok;
+        m_bufferSpacing = spacing.toDouble(&ok);
+        if (!ok || (m_bufferSpacing < legalizationBlockSize))
+        {
+            parserError(xml, "invalid buffer spacing");
+            return false;
+        }
+    }
+
+    QString utilization = attributes.value("utilization").toString();
+    if (!utilization.isEmpty())
+    {
+        bool ok;
+        m_bufferUtilization = utilization.toDouble(&ok);
+        if (!ok || (m_bufferUtilization <= 0.0) || (m_bufferUtilization > 1.0))
+        {
+            parserError(xml, "invalid buffer utilization");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+PlacementJob::parseParallel(QXmlStreamReader &xml)
+{
+    QXmlStreamAttributes attributes = xml.attributes();
+
+    QString threads = attributes.value("threads").toString();
+    if (!threads.isEmpty())
+    {
+        bool ok;
+        m_threadCount = threads.toInt(&ok);
+        if (!ok || (m_threadCount < 0))
+        {
+            parserError(xml, "invalid thread count");
+            return false;
+        }
+    }
+
+    QString cutoff = attributes.value("cutoff").toString();
+    if (!cutoff.isEmpty())
+    {
+        bool ok;
+        m_parallelCutoff = cutoff.toInt(&ok);
+        if (!ok || (m_parallelCutoff < 2))
+        {
+            parserError(xml, "invalid parallel cutoff");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+PlacementJob::parseRandom(QXmlStreamReader &xml)
+{
+    QXmlStreamAttributes attributes = xml.attributes();
+
+    QString seed = attributes.value("seed").toString();
+    if (!seed.isEmpty())
+    {
+        bool ok;
+        m_seed = seed.toUInt(&ok);
+        if (!ok)
+        {
+            parserError(xml, "invalid random seed");
+            return false;
+        }
+    }
+
+    return true;
+}
+
 void
 PlacementJob::parserError(QXmlStreamReader &xml, const char *msg)
 {
@@ -5,6 +5,8 @@
 #include <QMap>
 #include <QXmlStreamReader>
 #include "common/vector.h"
+#include "preconditioner.h"
+#include "linearsolver.h"
 
 class PlacementJob
 {
@@ -15,6 +17,37 @@ public:
         int x, y, z;
     };
 
+    struct CellTiming
+    {
+        int delay;      // ticks from the inputs to the output
+        QString output; // output port
+    };
+
+    enum NetModel
+    {
+        CliqueNetModel,
+        StarNetModel,
+        Bound2BoundNetModel
+    };
+
+    enum PartitionBalance
+    {
+        CountBalance,
+        AreaBalance
+    };
+
+    enum GlobalPlacer
+    {
+        QuadraticPlacer,
+        ElectrostaticPlacer
+    };
+
+    enum LegalizationMode
+    {
+        GridLegalization,
+        RowLegalization
+    };
+
 public:
     PlacementJob();
 
@@ -38,6 +71,165 @@ public:
     Vector<int>
     maxCoordinates() const;
 
+public:
+    GlobalPlacer
+    globalPlacer() const;
+
+    // Electrostatic placer: target gate density of the bins (fraction of the bin area)
+    double
+    targetDensity() const;
+
+    // Electrostatic placer stops when the overflow of the bins falls below this fraction of the gate area
+    double
+    targetOverflow() const;
+
+    // Electrostatic placer iteration limit
+    int
+    globalIterations() const;
+
+public:
+    LinearSolver::Type
+    solver() const;
+
+    Preconditioner::Type
+    preconditioner() const;
+
+    NetModel
+    netModel() const;
+
+    // Number of Bound2Bound reweighting iterations
+    int
+    netModelIterations() const;
+
+    // What the halves of a bisection get equal amounts of
+    PartitionBalance
+    partitionBalance() const;
+
+    // FM refinement passes per bisection, 0 disables refinement
+    int
+    partitionPasses() const;
+
+    // Allowed imbalance of a refined bisection (fraction of the total)
+    double
+    partitionTolerance() const;
+
+    // Bisections of at least this number of gates are refined on a coarsened netlist first, 0 disables coarsening
+    int
+    coarseningThreshold() const;
+
+    // Netlists with more gates are clustered into levels of at most this number of gates before QP, 0 disables clustering
+    int
+    clusteringThreshold() const;
+
+    // Sites of legalizationBlockSize blocks or rows of cell footprints, see legalize()
+    LegalizationMode
+    legalizationMode() const;
+
+    // Row legalization: free blocks between neighbouring gates of a row
+    int
+    legalizationSpacing() const;
+
+    // Row legalization: free blocks between rows
+    int
+    rowSpacing() const;
+
+    // Row legalization: free blocks around every side of the cells of this type
+    int
+    cellHalo(const QString &cellType) const;
+
+    // Grid legalization stacks gates on this many tiers of the area, see tierPitch()
+    int
+    tierCount() const;
+
+    // Free blocks above every tier for the wires between the gates of neighbouring tiers
+    int
+    tierSpacing() const;
+
+    // Moves per temperature step in units of gates^(4/3), 0 disables annealing
+    double
+    annealingEffort() const;
+
+    // Whether annealing also changes gate variants
+    bool
+    annealingVariants() const;
+
+    // Annealing runs with the seeds seed(), seed() + 1, ..., the best one is kept. With ePlace and
+    // without buffering every start also places globally and legalizes with its seed, otherwise all
+    // starts anneal the same legal placement.
+    int
+    annealingStarts() const;
+
+    // Area of the router for the congestion estimate, the placement area by default
+    Vector<int>
+    routingMinCoordinates() const;
+
+    Vector<int>
+    routingMaxCoordinates() const;
+
+    // Global placements repeated with the gates of congested bins inflated, 0 disables the feedback
+    int
+    congestionIterations() const;
+
+    // Congestion (demand / capacity) above which gates are inflated
+    double
+    congestionTarget() const;
+
+    // Congestion report of the final placement, empty: no report
+    QString
+    congestionReport() const;
+
+    // Whether the job has a <timing> library, see TimingAnalysis
+    bool
+    timingDriven() const;
+
+    // Cells missing from the library get the defaults of <timing>
+    CellTiming
+    cellTiming(const QString &cellType) const;
+
+    // Redstone signal reaches maxWireLength blocks, longer wires need repeaters
+    int
+    maxWireLength() const;
+
+    // Ticks per repeater
+    int
+    repeaterDelay() const;
+
+    // Global placements repeated with net weights from the placed timing, 0: logic depth only
+    int
+    timingIterations() const;
+
+    // A net on the critical path weighs 1 + timingWeight, nets with full slack 1
+    double
+    timingWeight() const;
+
+    // Buffer cell of insertBuffers(), empty disables buffering
+    QString
+    bufferCell() const;
+
+    // Nets with more sinks are split into buffer trees
+    int
+    maxFanout() const;
+
+    // Largest distance from a driver to its sinks after buffering, maxWireLength() by default
+    double
+    bufferSpacing() const;
+
+    // Buffers fill the legalization sites up to this fraction
+    double
+    bufferUtilization() const;
+
+    // 0 means the number of CPU cores
+    int
+    threadCount() const;
+
+    // Smallest number of gates for which the QP recursion is split between threads
+    int
+    parallelCutoff() const;
+
+    // Seed of every random choice of the placer
+    quint32
+    seed() const;
+
 public:
     static PlacementJob *
     readFromFile(const QString &filePath);
@@ -46,9 +238,54 @@ private:
     bool
     parseArea(QXmlStreamReader &xml);
 
+    static bool
+    parseCoordinates(QXmlStreamReader &xml, int &x, int &y, int &z);
+
     bool
     parsePads(QXmlStreamReader &xml);
 
+    bool
+    parseGlobalPlacement(QXmlStreamReader &xml);
+
+    bool
+    parseSolver(QXmlStreamReader &xml);
+
+    bool
+    parseNetModel(QXmlStreamReader &xml);
+
+    bool
+    parsePartition(QXmlStreamReader &xml);
+
+    bool
+    parseClustering(QXmlStreamReader &xml);
+
+    bool
+    parseLegalization(QXmlStreamReader &xml);
+
+    bool
+    parseTiers(QXmlStreamReader &xml);
+
+    bool
+    parseAnnealing(QXmlStreamReader &xml);
+
+    bool
+    parseCongestion(QXmlStreamReader &xml);
+
+    bool
+    parseTiming(QXmlStreamReader &xml);
+
+    static bool
+    parseCellTiming(QXmlStreamReader &xml, CellTiming &timing);
+
+    bool
+    parseBuffering(QXmlStreamReader &xml);
+
+    bool
+    parseParallel(QXmlStreamReader &xml);
+
+    bool
+    parseRandom(QXmlStreamReader &xml);
+
     static void
     parserError(QXmlStreamReader &xml, const char* msg);
 
@@ -61,6 +298,61 @@ private:
     QString m_padCellNameProperty;
 
     QMap<QString, PadInfo> m_pads;
+
+    GlobalPlacer m_globalPlacer;
+    double m_targetDensity;
+    double m_targetOverflow;
+    int m_globalIterations;
+
+    LinearSolver::Type m_solver;
+    Preconditioner::Type m_preconditioner;
+
+    NetModel m_netModel;
+    int m_netModelIterations;
+
+    PartitionBalance m_partitionBalance;
+    int m_partitionPasses;
+    double m_partitionTolerance;
+    int m_coarseningThreshold;
+
+    int m_clusteringThreshold;
+
+    LegalizationMode m_legalizationMode;
+    int m_legalizationSpacing;
+    int m_rowSpacing;
+    int m_defaultHalo;
+    QMap<QString, int> m_cellHalos;
+
+    int m_tierCount;
+    int m_tierSpacing;
+
+    double m_annealingEffort;
+    bool m_annealingVariants;
+    int m_annealingStarts;
+
+    bool m_hasRoutingArea;
+    Vector<int> m_routingMin, m_routingMax;
+    int m_congestionIterations;
+    double m_congestionTarget;
+    QString m_congestionReport;
+
+    bool m_timingDriven;
+    CellTiming m_defaultTiming;
+    QMap<QString, CellTiming> m_cellTimings;
+    int m_maxWireLength;
+    int m_repeaterDelay;
+    int m_timingIterations;
+    double m_timingWeight;
+
+    QString m_bufferCell;
+    int m_maxFanout;
+    double m_bufferSpacing;
+    double m_bufferUtilization;
+
+    int m_threadCount;
+    int m_parallelCutoff;
+
+    quint32 m_seed;
 };
 
 #endif // PLACEMENTJOB_H
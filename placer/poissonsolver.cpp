@@ -0,0 +1,270 @@
+#include "poissonsolver.h"
+#include "taskpool.h"
+#include <QRunnable>
+#include <math.h>
+
+// Smallest number of lines transformed by one task
+const int minLinesPerTask = 8;
+
+class TransformTask : public QRunnable
+{
+public:
+    TransformTask(const PoissonSolver *solver, QVector<double> &grid, PoissonSolver::Transform type, bool rows, int first, int last)
+        : m_solver(solver), m_grid(grid), m_type(type), m_rows(rows), m_first(first), m_last(last)
+    {
+    }
+
+    virtual void
+    run()
+    {
+        int size = m_solver->size();
+        QVector<double> line(size);
+        QVector<std::complex<double> > buffer(2 * size);
+        double *grid = m_grid.data();
+
+        for (int l = m_first; l < m_last; l++)
+        {
+            // Row l is contiguous, column l has stride size
+            int offset = m_rows ? l * size : l;
+            int stride = m_rows ? 1 : size;
+
+            for (int n = 0; n < size; n++)
+            {
+                line[n] = grid[offset + n * stride];
+            }
+            m_solver->transform(m_type, line.data(), buffer.data());
+            for (int n = 0; n < size; n++)
+            {
+                grid[offset + n * stride] = line[n];
+            }
+        }
+    }
+
+private:
+    const PoissonSolver *m_solver;
+    QVector<double> &m_grid;
+    PoissonSolver::Transform m_type;
+    bool m_rows;
+    int m_first, m_last;
+};
+
+PoissonSolver::PoissonSolver(int size)
+{
+    Q_ASSERT((size > 0) && ((size & (size - 1)) == 0));
+
+    m_size = size;
+    m_binWidth = m_binHeight = 1.0;
+    m_pool = 0;
+
+    int n = 2 * size;
+    int bits = 0;
+    while ((1 << bits) < n) bits++;
+
+    m_bitReversal.resize(n);
+    for (int i = 0; i < n; i++)
+    {
+        int r = 0;
+        for (int b = 0; b < bits; b++)
+        {
+            if (i & (1 << b)) r |= 1 << (bits - 1 - b);
+        }
+        m_bitReversal[i] = r;
+    }
+
+    m_twiddles.resize(n / 2);
+    for (int k = 0; k < n / 2; k++)
+    {
+        m_twiddles[k] = std::polar(1.0, -2.0 * M_PI * k / n);
+    }
+
+    m_shifts.resize(size);
+    for (int u = 0; u < size; u++)
+    {
+        m_shifts[u] = std::polar(1.0, -M_PI * u / n);
+    }
+}
+
+int
+PoissonSolver::size() const
+{
+    return m_size;
+}
+
+void
+PoissonSolver::setBinSize(double width, double height)
+{
+    m_binWidth = width;
+    m_binHeight = height;
+}
+
+void
+PoissonSolver::setPool(TaskPool *pool)
+{
+    m_pool = pool;
+}
+
+/*
+ * Iterative radix-2 FFT of 2 * size values,
+ * the inverse transform is not normalized.
+ */
+void
+PoissonSolver::fft(std::complex<double> *data, bool inverse) const
+{
+    int n = 2 * m_size;
+    for (int i = 0; i < n; i++)
+    {
+        int r = m_bitReversal[i];
+        if (i < r) std::swap(data[i], data[r]);
+    }
+
+    for (int length = 2; length <= n; length *= 2)
+    {
+        int half = length / 2;
+        int step = n / length;
+        for (int first = 0; first < n; first += length)
+        {
+            for (int k = 0; k < half; k++)
+            {
+                std::complex<double> w = m_twiddles[k * step];
+                if (inverse) w = std::conj(w);
+
+                std::complex<double> a = data[first + k];
+                std::complex<double> b = data[first + k + half] * w;
+                data[first + k] = a + b;
+                data[first + k + half] = a - b;
+            }
+        }
+    }
+}
+
+/*
+ * Cosine sums are real parts of a DFT of 2 * size points: the line is padded
+ * with zeros, the half-sample shift is applied in the frequency domain.
+ * A sine sum is a cosine sum of the reversed coefficients with alternating
+ * signs, sin(pi u (n + 1/2) / N) = (-1)^n cos(pi (N - u) (n + 1/2) / N).
+ */
+void
+PoissonSolver::transform(Transform type, double *line, std::complex<double> *buffer) const
+{
+    int n = 2 * m_size;
+
+    if (type == Cosine)
+    {
+        for (int i = 0; i < m_size; i++)
+        {
+            buffer[i] = line[i];
+        }
+        for (int i = m_size; i < n; i++)
+        {
+            buffer[i] = 0.0;
+        }
+
+        fft(buffer, false);
+
+        for (int u = 0; u < m_size; u++)
+        {
+            line[u] = (buffer[u] * m_shifts[u]).real();
+        }
+        return;
+    }
+
+    if (type == CosineSum)
+    {
+        for (int u = 0; u < m_size; u++)
+        {
+            buffer[u] = line[u] * std::conj(m_shifts[u]);
+        }
+    }
+    else
+    {
+        buffer[0] = 0.0;
+        for (int u = 1; u < m_size; u++)
+        {
+            buffer[u] = line[m_size - u] * std::conj(m_shifts[u]);
+        }
+    }
+    for (int i = m_size; i < n; i++)
+    {
+        buffer[i] = 0.0;
+    }
+
+    fft(buffer, true);
+
+    for (int i = 0; i < m_size; i++)
+    {
+        double v = buffer[i].real();
+        line[i] = ((type == SineSum) && (i % 2)) ? -v : v;
+    }
+}
+
+void
+PoissonSolver::transformLines(QVector<double> &grid, Transform type, bool rows) const
+{
+    int perTask = (m_pool != 0) ? qMax(minLinesPerTask, m_size / (4 * m_pool->threadCount())) : m_size;
+    if (perTask >= m_size)
+    {
+        TransformTask(this, grid, type, rows, 0, m_size).run();
+        return;
+    }
+
+    TaskGroup group(m_pool);
+    for (int first = 0; first < m_size; first += perTask)
+    {
+        group.run(new TransformTask(this, grid, type, rows, first, qMin(first + perTask, m_size)));
+    }
+    group.wait();
+}
+
+/*
+ * With w_u = pi u / (size * width) the density is sum a_uv cos(w_u x) cos(w_v y),
+ * the potential takes a_uv / (w_u^2 + w_v^2) and the field
+ * a_uv w_u / (w_u^2 + w_v^2) with sin(w_u x) (y direction likewise).
+ */
+void
+PoissonSolver::solve(const QVector<double> &density, QVector<double> &fieldX, QVector<double> &fieldY, QVector<double> *potential)
+{
+    Q_ASSERT(density.size() == m_size * m_size);
+
+    QVector<double> a = density;
+    transformLines(a, Cosine, true);
+    transformLines(a, Cosine, false);
+
+    fieldX.resize(a.size());
+    fieldY.resize(a.size());
+    if (potential != 0) potential->resize(a.size());
+
+    double scale = 1.0 / (double(m_size) * m_size);
+    for (int v = 0; v < m_size; v++)
+    {
+        double wv = M_PI * v / (m_size * m_binHeight);
+        for (int u = 0; u < m_size; u++)
+        {
+            int i = v * m_size + u;
+            if ((u == 0) && (v == 0))
+            {
+                fieldX[i] = fieldY[i] = 0.0;
+                if (potential != 0) (*potential)[i] = 0.0;
+                continue;
+            }
+
+            // Inverse of the unnormalized cosine transform
+            double coefficient = a[i] * scale * ((u == 0) ? 1.0 : 2.0) * ((v == 0) ? 1.0 : 2.0);
+
+            double wu = M_PI * u / (m_size * m_binWidth);
+            double w2 = wu * wu + wv * wv;
+            fieldX[i] = coefficient * wu / w2;
+            fieldY[i] = coefficient * wv / w2;
+            if (potential != 0) (*potential)[i] = coefficient / w2;
+        }
+    }
+
+    transformLines(fieldX, SineSum, true);
+    transformLines(fieldX, CosineSum, false);
+    transformLines(fieldY, CosineSum, true);
+    transformLines(fieldY, SineSum, false);
+    if (potential != 0)
+    {
+        transformLines(*potential, CosineSum, true);
+        transformLines(*potential, CosineSum, false);
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef POISSONSOLVER_H
+#define POISSONSOLVER_H
+
+#include <QVector>
+#include <complex>
+
+class TaskPool;
+
+/*
+ * Spectral solver of the Poisson equation "laplace(psi) = -rho" on a
+ * square grid of bins with Neumann boundaries (electrostatic density model
+ * of ePlace). The density is expanded into cosine waves, the potential and
+ * the field are sums of the scaled waves. All transforms are computed with
+ * a radix-2 FFT of twice the grid size, lines are split between threads.
+ *
+ * Grids are row-major, bin (i, j) is [j * size + i]. Bins are 1 x 1 unless
+ * setBinSize() is called. The mean density doesn't produce a field.
+ */
+class PoissonSolver
+{
+public:
+    // size must be a power of 2
+    PoissonSolver(int size);
+
+    int
+    size() const;
+
+    void
+    setBinSize(double width, double height);
+
+    // 0: sequential
+    void
+    setPool(TaskPool *pool);
+
+    // Field is -grad(psi), potential is optional
+    void
+    solve(const QVector<double> &density, QVector<double> &fieldX, QVector<double> &fieldY, QVector<double> *potential = 0);
+
+private:
+    enum Transform
+    {
+        // X[u] = sum x[n] cos(pi u (n + 1/2) / size)
+        Cosine,
+        // x[n] = sum X[u] cos(pi u (n + 1/2) / size)
+        CosineSum,
+        // x[n] = sum X[u] sin(pi u (n + 1/2) / size)
+        SineSum
+    };
+
+    // One line of the grid, buffer holds 2 * size values
+    void
+    transform(Transform type, double *line, std::complex<double> *buffer) const;
+
+    // Transforms rows (along i) or columns (along j) in place
+    void
+    transformLines(QVector<double> &grid, Transform type, bool rows) const;
+
+    void
+    fft(std::complex<double> *data, bool inverse) const;
+
+private:
+    int m_size;
+    double m_binWidth, m_binHeight;
+    TaskPool *m_pool;
+
+    QVector<int> m_bitReversal;                 // FFT of 2 * size
+    QVector<std::complex<double> > m_twiddles;  // exp(-2 pi i k / (2 * size))
+    QVector<std::complex<double> > m_shifts;    // exp(-i pi u / (2 * size))
+
+    friend class TransformTask;
+};
+
+#endif // POISSONSOLVER_H
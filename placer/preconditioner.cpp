@@ -0,0 +1,217 @@
+#include "preconditioner.h"
+#include "csrmatrix.h"
+#include <math.h>
+
+Preconditioner *
+Preconditioner::create(Preconditioner::Type type, const CsrMatrix &matrix)
+{
+    switch (type)
+    {
+    case Jacobi:
+        return new JacobiPreconditioner(matrix);
+    case IncompleteCholesky:
+        return new IncompleteCholeskyPreconditioner(matrix);
+    default:
+        return new IdentityPreconditioner();
+    }
+}
+
+void
+IdentityPreconditioner::apply(const Array &r, Array &z) const
+{
+    z = r;
+}
+
+JacobiPreconditioner::JacobiPreconditioner(const CsrMatrix &matrix)
+{
+    m_inverseDiagonal = matrix.diagonal();
+    for (int i = 0; i < m_inverseDiagonal.size(); i++)
+    {
+        double d = m_inverseDiagonal[i];
+        m_inverseDiagonal[i] = (d != 0.0) ? (1.0 / d) : 1.0;
+    }
+}
+
+void
+JacobiPreconditioner::apply(const Array &r, Array &z) const
+{
+    Q_ASSERT(r.size() == m_inverseDiagonal.size());
+
+    z.resize(r.size());
+    for (int i = 0; i < r.size(); i++)
+    {
+        z[i] = r[i] * m_inverseDiagonal[i];
+    }
+}
+
+IncompleteCholeskyPreconditioner::IncompleteCholeskyPreconditioner(const CsrMatrix &matrix)
+{
+    m_n = matrix.n();
+
+    /* IC(0) may break down even for SPD matrices. Retry with a growing diagonal shift.  */
+    double shift = 0.0;
+    int attempt = 0;
+    while (!factorize(matrix, shift))
+    {
+        attempt++;
+        if (attempt == 20)
+        {
+            qWarning("IncompleteCholeskyPreconditioner: factorization failed, using diagonal");
+            factorizeDiagonal(matrix);
+            return;
+        }
+        shift = (shift == 0.0) ? 1e-3 : shift * 2;
+    }
+    if (shift != 0.0)
+    {
+        qDebug("IncompleteCholeskyPreconditioner: used diagonal shift %g", shift);
+    }
+}
+
+void
+IncompleteCholeskyPreconditioner::factorizeDiagonal(const CsrMatrix &matrix)
+{
+    Array diagonal = matrix.diagonal();
+
+    m_rowPointers.resize(m_n + 1);
+    m_columnIndexes.resize(m_n);
+    m_values.resize(m_n);
+    for (int row = 0; row < m_n; row++)
+    {
+        double d = qAbs(diagonal[row]);
+
+        m_rowPointers[row] = row;
+        m_columnIndexes[row] = row;
+        m_values[row] = (d != 0.0) ? sqrt(d) : 1.0;
+    }
+    m_rowPointers[m_n] = m_n;
+}
+
+bool
+IncompleteCholeskyPreconditioner::factorize(const CsrMatrix &matrix, double shift)
+{
+    const QVector<int> &rowPointers = matrix.rowPointers();
+    const QVector<int> &columnIndexes = matrix.columnIndexes();
+    const QVector<double> &values = matrix.values();
+
+    /* Copy lower triangle, diagonal goes last in each row.  */
+    m_rowPointers.fill(0, m_n + 1);
+    m_columnIndexes.clear();
+    m_values.clear();
+    for (int row = 0; row < m_n; row++)
+    {
+        double diagonal = 0.0;
+        for (int i = rowPointers[row]; i < rowPointers[row + 1]; i++)
+        {
+            int col = columnIndexes[i];
+            if (col < row)
+            {
+                m_columnIndexes.append(col);
+                m_values.append(values[i]);
+            }
+            else if (col == row)
+            {
+                diagonal = values[i];
+            }
+        }
+        m_columnIndexes.append(row);
+        m_values.append(diagonal * (1.0 + shift));
+        m_rowPointers[row + 1] = m_columnIndexes.size();
+    }
+
+    /* Row-oriented IC(0).  */
+    for (int row = 0; row < m_n; row++)
+    {
+        int rowStart = m_rowPointers[row];
+        int rowEnd = m_rowPointers[row + 1] - 1; // Diagonal index
+
+        for (int i = rowStart; i < rowEnd; i++)
+        {
+            int k = m_columnIndexes[i];
+
+            /* sum_{j<k} L(row,j) * L(k,j) over the common pattern.  */
+            double sum = 0.0;
+            int a = rowStart;
+            int b = m_rowPointers[k];
+            int bEnd = m_rowPointers[k + 1] - 1;
+            while ((a < i) && (b < bEnd))
+            {
+                int ca = m_columnIndexes[a];
+                int cb = m_columnIndexes[b];
+                if (ca == cb)
+                {
+                    sum += m_values[a] * m_values[b];
+                    a++;
+                    b++;
+                }
+                else if (ca < cb)
+                {
+                    a++;
+                }
+                else
+                {
+                    b++;
+                }
+            }
+
+            m_values[i] = (m_values[i] - sum) / m_values[bEnd];
+        }
+
+        double d = m_values[rowEnd];
+        for (int i = rowStart; i < rowEnd; i++)
+        {
+            d -= m_values[i] * m_values[i];
+        }
+
+        if (d <= 0.0)
+        {
+            /* Unconnected rows have zero diagonal, keep them as identity.  */
+            if ((rowStart == rowEnd) && (d == 0.0))
+            {
+                d = 1.0;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        m_values[rowEnd] = sqrt(d);
+    }
+
+    return true;
+}
+
+void
+IncompleteCholeskyPreconditioner::apply(const Array &r, Array &z) const
+{
+    Q_ASSERT(r.size() == m_n);
+
+    z.resize(m_n);
+
+    /* Forward substitution "L y = r".  */
+    for (int row = 0; row < m_n; row++)
+    {
+        int diagonalIndex = m_rowPointers[row + 1] - 1;
+
+        double sum = r[row];
+        for (int i = m_rowPointers[row]; i < diagonalIndex; i++)
+        {
+            sum -= m_values[i] * z[m_columnIndexes[i]];
+        }
+        z[row] = sum / m_values[diagonalIndex];
+    }
+
+    /* Backward substitution "L^T z = y" (column-oriented).  */
+    for (int row = m_n - 1; row >= 0; row--)
+    {
+        int diagonalIndex = m_rowPointers[row + 1] - 1;
+
+        z[row] /= m_values[diagonalIndex];
+
+        double v = z[row];
+        for (int i = m_rowPointers[row]; i < diagonalIndex; i++)
+        {
+            z[m_columnIndexes[i]] -= m_values[i] * v;
+        }
+    }
+}
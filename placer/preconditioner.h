@@ -0,0 +1,76 @@
+#ifndef PRECONDITIONER_H
+#define PRECONDITIONER_H
+
+#include <QVector>
+#include "array.h"
+
+class CsrMatrix;
+
+class Preconditioner
+{
+public:
+    enum Type
+    {
+        None,
+        Jacobi,
+        IncompleteCholesky
+    };
+
+public:
+    virtual ~Preconditioner() {}
+
+    // Calculate "z = M^{-1} r"
+    virtual void
+    apply(const Array &r, Array &z) const = 0;
+
+public:
+    static Preconditioner *
+    create(Type type, const CsrMatrix &matrix);
+};
+
+class IdentityPreconditioner : public Preconditioner
+{
+public:
+    virtual void
+    apply(const Array &r, Array &z) const;
+};
+
+class JacobiPreconditioner : public Preconditioner
+{
+public:
+    JacobiPreconditioner(const CsrMatrix &matrix);
+
+    virtual void
+    apply(const Array &r, Array &z) const;
+
+private:
+    Array m_inverseDiagonal;
+};
+
+/*
+ * Zero fill-in incomplete Cholesky factorization "A ~ L L^T".
+ * L has the sparsity pattern of the lower triangle of A.
+ */
+class IncompleteCholeskyPreconditioner : public Preconditioner
+{
+public:
+    IncompleteCholeskyPreconditioner(const CsrMatrix &matrix);
+
+    virtual void
+    apply(const Array &r, Array &z) const;
+
+private:
+    bool
+    factorize(const CsrMatrix &matrix, double shift);
+
+    void
+    factorizeDiagonal(const CsrMatrix &matrix);
+
+private:
+    int             m_n;
+    QVector<int>    m_rowPointers;
+    QVector<int>    m_columnIndexes; // Diagonal element is the last one in the row
+    QVector<double> m_values;
+};
+
+#endif // PRECONDITIONER_H
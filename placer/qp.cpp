@@ -1,24 +1,54 @@
 #include "qp.h"
-#include <QString>
-#include <QMap>
-#include <QMultiMap>
-#include <QSet>
+#include <QVector>
 #include <QPointF>
 #include <QSizeF>
+#include <QRectF>
+#include <QScopedPointer>
+#include <QThread>
+#include <algorithm>
 #include "coomatrix.h"
+#include "csrmatrix.h"
+#include "linearsolver.h"
+#include "taskpool.h"
+#include "fmpartitioner.h"
+#include "placementdb.h"
 #include "common/netlist.h"
+#include "common/celllibrary.h"
 #include "placementjob.h"
-#include <QStringList>
+#include "legalization.h"
+#include "clustering.h"
 
+// Heaviest cluster of a level in average gate weights of the finer level
+const double maxClusterWeight = 3.0;
+// Coarsening stops when a level would have more than this fraction of the gates of the finer level
+const double maxCoarseningRatio = 0.9;
+
+/*
+ * Gates of the design in bisection order. Every job owns a range of it,
+ * ranges of different jobs never overlap.
+ */
+typedef struct {
+    PlacementDb *db;
+    QVector<int> gates;     // index -> gate
+    QVector<int> gateSlots; // gate -> index
+    QVector<double> areas;  // gate -> footprint, empty: bisection balances gate counts
+    QVector<QRectF> regions; // gate -> region of its leaf job, empty: not recorded
+} QpData;
+
+/*
+ * Movable gates of the job are QpData::gates[begin; end).
+ * Every net of the job has at least one gate of the job. Pins of nets[i] are
+ * split into the gates of the job, gateCells[gatePointers[i]; gatePointers[i + 1]),
+ * and everything else, fixed at fixedPins[fixedPointers[i]; fixedPointers[i + 1]).
+ */
 typedef struct {
-    //int n, nGates, nPads;
-    //QMap<int, QString> indexToName;
-    //QMap<QString, int> nameToIndex;
-    QSet<QString> gates;
-    QSet<QString> pads;
+    int begin, end;
 
-    QMap<QString, QPointF> coords; // index->point
-    QMultiMap<QString, QString> nets; // net->index
+    QVector<int> nets;
+    QVector<int> gatePointers;
+    QVector<int> gateCells;
+    QVector<int> fixedPointers;
+    QVector<QPointF> fixedPins;
 
     // Geometrical parameters
     QPointF topLeft;
@@ -26,41 +56,78 @@ typedef struct {
     QSizeF size;
 } Job;
 
-bool
-readJob(Job &job, const Netlist *netlist, const PlacementJob *placementJob)
+typedef struct {
+    LinearSolver::Type solver;
+    Preconditioner::Type preconditioner;
+
+    PlacementJob::NetModel netModel;
+    int netModelIterations;
+
+    // Required accuracy of QP positions (in blocks)
+    double accuracy;
+
+    // FM refinement of bisections, no passes: plain geometric cut
+    int partitionPasses;
+    double partitionTolerance;
+    int coarseningThreshold;
+
+    // Jobs with at least parallelCutoff gates solve their children in parallel (no pool: sequential)
+    TaskPool *pool;
+    int parallelCutoff;
+} QpSettings;
+
+int
+gateCount(const Job &job)
 {
-    QList<QString> gates = netlist->allGates();
-    QList<QString> pads = netlist->allPads();
+    return job.end - job.begin;
+}
 
-    job.gates = gates.toSet();
-    job.pads = pads.toSet();
+void
+readJob(Job &job, QpData &data, const PlacementJob *placementJob)
+{
+    const PlacementDb *db = data.db;
+    const QVector<int> &netPointers = db->netPointers();
+    const QVector<int> &pinCells = db->pinCells();
 
-    foreach (const QString &padName, pads)
+    data.gates.resize(db->gateCount());
+    data.gateSlots.resize(db->gateCount());
+    for (int i = 0; i < db->gateCount(); i++)
     {
-        int x, y, z;
-        if (!netlist->position(padName, x, y, z))
-        {
-            qWarning("Can't get pad coordinates for %s", qPrintable(padName));
-            return false;
-        }
-        job.coords[padName] = QPointF(x, y);
+        data.gates[i] = i;
+        data.gateSlots[i] = i;
     }
 
-    QList<QString> nets = netlist->allNets();
-    for (int i = 0; i < nets.size(); i++)
-    {
-        QString netName = nets[i];
+    job.begin = 0;
+    job.end = db->gateCount();
 
-        QList<QString> items = netlist->itemsByNet(netName);
-        foreach (const QString &item, items)
+    job.gatePointers.append(0);
+    job.fixedPointers.append(0);
+    for (int net = 0; net < db->netCount(); net++)
+    {
+        int gates = job.gateCells.size();
+        int fixed = job.fixedPins.size();
+        for (int pin = netPointers[net]; pin < netPointers[net + 1]; pin++)
         {
-            if (!job.gates.contains(item) && !job.pads.contains(item))
+            int cell = pinCells[pin];
+            if (db->isGate(cell))
             {
-                qWarning("Can't find item %s", qPrintable(item));
-                return false;
+                job.gateCells.append(cell);
             }
-            job.nets.insertMulti(netName, item);
+            else
+            {
+                job.fixedPins.append(db->positions()[cell]);
+            }
+        }
+
+        if (job.gateCells.size() == gates)
+        {
+            job.fixedPins.resize(fixed);
+            continue;
         }
+
+        job.nets.append(net);
+        job.gatePointers.append(job.gateCells.size());
+        job.fixedPointers.append(job.fixedPins.size());
     }
 
     Vector<int> min = placementJob->minCoordinates();
@@ -70,183 +137,633 @@ readJob(Job &job, const Netlist *netlist, const PlacementJob *placementJob)
     job.bottomRight = QPointF(max.x, max.z);
     job.size = QSizeF(job.bottomRight.x() - job.topLeft.x(), job.bottomRight.y() - job.topLeft.y());
 
-    return true;
+    // Initial guess for the first QP
+    QPointF center = (job.topLeft + job.bottomRight) / 2;
+    for (int i = 0; i < db->gateCount(); i++)
+    {
+        data.db->positions()[i] = center;
+    }
 }
 
 void
-savePlacement(NetPlacement &placement, const Job &job)
+savePlacement(NetPlacement &placement, const PlacementDb *db)
 {
-    foreach (const QString &gateName, job.gates)
+    for (int gate = 0; gate < db->gateCount(); gate++)
     {
-        QPointF p = job.coords[gateName];
+        QPointF p = db->positions()[gate];
 
         GatePlacement gp(p.x(), 0, p.y());
-        placement[gateName] = gp;
+        placement[db->cellName(gate)] = gp;
+    }
+}
+
+QPointF
+projectPoint(const QPointF &point, const Job &job)
+{
+    QPointF p = point;
+
+    p.setX(qMin(p.x(), job.bottomRight.x()));
+    p.setX(qMax(p.x(), job.topLeft.x()));
+    p.setY(qMin(p.y(), job.bottomRight.y()));
+    p.setY(qMax(p.y(), job.topLeft.y()));
+
+    return p;
+}
+
+/*
+ * Pin of a QP net: a variable of the system or a fixed point.
+ * Coordinates are relative to the top left corner of the job.
+ */
+typedef struct {
+    int index; // -1 for fixed pins
+    QPointF position;
+} QpPin;
+
+/*
+ * Pins of the job nets in CSR form, nets with less than two pins are skipped,
+ * weights[i] is the weight of the i-th collected net.
+ * Gates start from their positions in the parent job, projected into the region.
+ */
+void
+collectPins(QVector<int> &pinPointers, QVector<QpPin> &pins, QVector<double> &weights, const Job &job, const QpData &data)
+{
+    const QVector<QPointF> &positions = data.db->positions();
+
+    pinPointers.append(0);
+    for (int i = 0; i < job.nets.size(); i++)
+    {
+        int count = (job.gatePointers[i + 1] - job.gatePointers[i]) + (job.fixedPointers[i + 1] - job.fixedPointers[i]);
+        if (count <= 1) continue;
+
+        for (int g = job.gatePointers[i]; g < job.gatePointers[i + 1]; g++)
+        {
+            int gate = job.gateCells[g];
+
+            QpPin pin;
+            pin.index = data.gateSlots[gate] - job.begin;
+            pin.position = projectPoint(positions[gate], job) - job.topLeft;
+            pins.append(pin);
+        }
+        for (int f = job.fixedPointers[i]; f < job.fixedPointers[i + 1]; f++)
+        {
+            QpPin pin;
+            pin.index = -1;
+            pin.position = job.fixedPins[f] - job.topLeft;
+            pins.append(pin);
+        }
+        pinPointers.append(pins.size());
+        weights.append(data.db->netWeight(job.nets[i]));
     }
 }
 
-void solveQP(Job &job)
+/*
+ * Spring of weight w between two pins, for both axes at once.
+ */
+void
+connect(CooMatrix &A, QVector<double> &diagonal, Array &bx, Array &by, const QpPin &p1, const QpPin &p2, double w)
 {
-    // Build equivalent graph
-    QMap<QPair<QString, QString>, double> edgeWeights;
-    foreach (const QString &net, job.nets.keys().toSet())
+    if (p1.index >= 0)
     {
-        QList<QString> points = job.nets.values(net);
-        if (points.size() <= 1) continue;
-        if (points.size() == 2)
+        diagonal[p1.index] += w;
+        if (p2.index >= 0)
         {
-            QString p1 = points.first();
-            QString p2 = points.last();
-            edgeWeights[qMakePair(p1, p2)] += 1.0;
-            edgeWeights[qMakePair(p2, p1)] += 1.0;
+            A.add(p1.index, p2.index, -w);
+        }
+        else
+        {
+            bx[p1.index] += w * p2.position.x();
+            by[p1.index] += w * p2.position.y();
+        }
+    }
+    if (p2.index >= 0)
+    {
+        diagonal[p2.index] += w;
+        if (p1.index >= 0)
+        {
+            A.add(p2.index, p1.index, -w);
+        }
+        else
+        {
+            bx[p2.index] += w * p1.position.x();
+            by[p2.index] += w * p1.position.y();
+        }
+    }
+}
+
+/*
+ * Spring of weight w between two pins along one axis.
+ */
+void
+connect(CooMatrix &A, QVector<double> &diagonal, Array &b, const QpPin &p1, double c1, const QpPin &p2, double c2, double w)
+{
+    if (p1.index >= 0)
+    {
+        diagonal[p1.index] += w;
+        if (p2.index >= 0)
+        {
+            A.add(p1.index, p2.index, -w);
+        }
+        else
+        {
+            b[p1.index] += w * c2;
+        }
+    }
+    if (p2.index >= 0)
+    {
+        diagonal[p2.index] += w;
+        if (p1.index >= 0)
+        {
+            A.add(p2.index, p1.index, -w);
+        }
+        else
+        {
+            b[p2.index] += w * c1;
+        }
+    }
+}
+
+/*
+ * Clique model connects every pair of pins of a net with weight 1/(p - 1).
+ * Star model connects every pin of a net to an extra star variable with
+ * weight p/(p - 1), which is equivalent for the net but needs only p
+ * connections. Star is used for nets with more than starThreshold pins.
+ * Star variables follow the gates. x and y get the initial guess: current
+ * pin positions for gates and the centers of their nets for stars.
+ */
+void
+buildCliqueStarSystem(CooMatrix &A, Array &bx, Array &by, Array &x, Array &y, int n, const QVector<int> &pinPointers, const QVector<QpPin> &pins, const QVector<double> &weights, int starThreshold)
+{
+    int stars = 0;
+    for (int net = 0; net < pinPointers.size() - 1; net++)
+    {
+        if (pinPointers[net + 1] - pinPointers[net] > starThreshold) stars++;
+    }
+
+    A = CooMatrix(n + stars);
+    bx = Array(n + stars);
+    by = Array(n + stars);
+    x = Array(n + stars);
+    y = Array(n + stars);
+    QVector<double> diagonal(n + stars, 0.0);
+
+    for (int i = 0; i < pins.size(); i++)
+    {
+        if (pins[i].index < 0) continue;
+
+        x[pins[i].index] = pins[i].position.x();
+        y[pins[i].index] = pins[i].position.y();
+    }
+
+    int star = n;
+    for (int net = 0; net < pinPointers.size() - 1; net++)
+    {
+        int begin = pinPointers[net];
+        int end = pinPointers[net + 1];
+        int count = end - begin;
+
+        if (count > starThreshold)
+        {
+            QpPin center;
+            center.index = star++;
+
+            double w = weights[net] * count / (count - 1);
+            for (int i = begin; i < end; i++)
+            {
+                connect(A, diagonal, bx, by, pins[i], center, w);
+
+                x[center.index] += pins[i].position.x() / count;
+                y[center.index] += pins[i].position.y() / count;
+            }
         }
         else
         {
-            double k = 1.0 / (points.size() - 1);
-            for (int i = 0; i < points.size(); i++)
+            double w = weights[net] / (count - 1);
+            for (int i = begin; i < end; i++)
             {
-                for (int j = 0; j < points.size(); j++)
+                for (int j = i + 1; j < end; j++)
                 {
-                    if (i != j)
-                    {
-                        edgeWeights[qMakePair(points[i], points[j])] += k;
-                    }
+                    if ((pins[i].index >= 0) && (pins[i].index == pins[j].index)) continue;
+                    connect(A, diagonal, bx, by, pins[i], pins[j], w);
                 }
             }
         }
     }
 
-    // Build Connectivity matrix
-    CooMatrix C(job.gates.size());
-
-    QMap<QString, int> gateIndexes;
-    QMap<int, QString> gateIndexesRev;
-    foreach (const QString &gateName, job.gates)
+    for (int i = 0; i < n + stars; i++)
     {
-        int index = gateIndexes.size();
-        gateIndexes[gateName] = index;
-        gateIndexesRev[index] = gateName;
+        A.add(i, i, diagonal[i]);
     }
+}
+
+/*
+ * Bound2Bound model (Spindler et al., Kraftwerk2) for one axis.
+ * Every pin is connected to the two boundary pins of its net, and
+ * the boundary pins are connected to each other. Weight
+ * 2/((p - 1) * distance) makes the quadratic length of the net equal to
+ * its half-perimeter at the current positions.
+ */
+void
+buildBound2BoundSystem(CooMatrix &A, Array &b, int n, const QVector<int> &pinPointers, const QVector<QpPin> &pins, const QVector<double> &weights, bool xAxis)
+{
+    /* Distances below minDistance would make the weights explode.  */
+    const double minDistance = 0.5;
+
+    A = CooMatrix(n);
+    b = Array(n);
+    QVector<double> diagonal(n, 0.0);
 
-    QList<QPair<QString, QString> > edges = edgeWeights.keys();
-    for (int i = 0; i < edges.size(); i++)
+    for (int net = 0; net < pinPointers.size() - 1; net++)
     {
-        QPair<QString, QString> edge = edges[i];
-        if (job.gates.contains(edge.first) && job.gates.contains(edge.second))
+        int begin = pinPointers[net];
+        int end = pinPointers[net + 1];
+        int count = end - begin;
+
+        int minPin = begin;
+        int maxPin = begin;
+        for (int i = begin; i < end; i++)
+        {
+            double c = xAxis ? pins[i].position.x() : pins[i].position.y();
+            if (c < (xAxis ? pins[minPin].position.x() : pins[minPin].position.y())) minPin = i;
+            if (c > (xAxis ? pins[maxPin].position.x() : pins[maxPin].position.y())) maxPin = i;
+        }
+        if (minPin == maxPin)
+        {
+            maxPin = (minPin == begin) ? (begin + 1) : begin;
+        }
+
+        double k = 2.0 * weights[net] / (count - 1);
+        for (int i = begin; i < end; i++)
         {
-            int i1 = gateIndexes[edge.first];
-            int i2 = gateIndexes[edge.second];
-            C.add(i1, i2, edgeWeights[edge]);
+            double ci = xAxis ? pins[i].position.x() : pins[i].position.y();
+            for (int e = 0; e < 2; e++)
+            {
+                int j = (e == 0) ? minPin : maxPin;
+                if ((i == minPin) || (i == maxPin))
+                {
+                    // Bound to bound connection is added once
+                    if ((i != minPin) || (j != maxPin)) continue;
+                }
+                if ((pins[i].index >= 0) && (pins[i].index == pins[j].index)) continue;
+
+                double cj = xAxis ? pins[j].position.x() : pins[j].position.y();
+                double w = k / qMax(qAbs(ci - cj), minDistance);
+                connect(A, diagonal, b, pins[i], ci, pins[j], cj, w);
+            }
         }
     }
 
-    // Build matrix A
-    CooMatrix A(job.gates.size());
+    for (int i = 0; i < n; i++)
+    {
+        A.add(i, i, diagonal[i]);
+    }
+}
+
+void
+savePositions(QpData &data, const Job &job, const Array &x, const Array &y)
+{
+    QVector<QPointF> &positions = data.db->positions();
+    for (int i = 0; i < gateCount(job); i++)
+    {
+        positions[data.gates[job.begin + i]] = QPointF(x[i] + job.topLeft.x(), y[i] + job.topLeft.y());
+    }
+}
+
+void solveQP(Job &job, QpData &data, const QpSettings &settings)
+{
+    int n = gateCount(job);
+
+    QVector<int> pinPointers;
+    QVector<QpPin> pins;
+    QVector<double> weights;
+    collectPins(pinPointers, pins, weights, job, data);
+
+    /*
+     * Positions are needed only up to a fraction of the legalization grid.
+     * Relative tolerance follows from the size of the job region.
+     */
+    double extent = qMax(1.0, qMax(job.size.width(), job.size.height()));
+    double tolerance = qBound(1e-6, settings.accuracy / extent, 1e-3);
 
-    QMap<int, double> sums;
-    for (int i = 0; i < C.nnz(); i++)
+    // Initial solution, B2B needs pin positions to compute its weights
+    Array x, y;
     {
-        int x, y;
-        double v;
+        int starThreshold = (settings.netModel == PlacementJob::CliqueNetModel) ? pins.size() : 3;
+
+        CooMatrix A(0);
+        Array bx, by;
+        buildCliqueStarSystem(A, bx, by, x, y, n, pinPointers, pins, weights, starThreshold);
 
-        v = C.getElement(i, x, y);
-        A.add(x, y, -v);
+        CsrMatrix csr(A);
+        QScopedPointer<LinearSolver> solver(LinearSolver::create(settings.solver, csr, settings.preconditioner));
+        solver->setTolerance(tolerance);
 
-        sums[x] += v;
+        // Warm start from the current positions
+        solver->solve(bx, by, x, y);
+        savePositions(data, job, x, y);
+
+        for (int i = 0; i < pins.size(); i++)
+        {
+            if (pins[i].index >= 0) pins[i].position = QPointF(x[pins[i].index], y[pins[i].index]);
+        }
     }
-    for (int i = 0; i < edges.size(); i++)
+
+    if (settings.netModel != PlacementJob::Bound2BoundNetModel) return;
+
+    // Axes have different B2B matrices, so they are solved separately
+    // Star variables are not used by B2B
+    Array xy[2] = {x, y};
+    xy[0].resize(n);
+    xy[1].resize(n);
+    for (int iteration = 0; iteration < settings.netModelIterations; iteration++)
     {
-        QPair<QString, QString> edge = edges[i];
-        if (job.pads.contains(edge.first) && job.gates.contains(edge.second))
+        for (int axis = 0; axis < 2; axis++)
+        {
+            CooMatrix A(0);
+            Array b;
+            buildBound2BoundSystem(A, b, n, pinPointers, pins, weights, axis == 0);
+
+            CsrMatrix csr(A);
+            QScopedPointer<LinearSolver> solver(LinearSolver::create(settings.solver, csr, settings.preconditioner));
+            solver->setTolerance(tolerance);
+            solver->solve(b, xy[axis]);
+        }
+
+        savePositions(data, job, xy[0], xy[1]);
+
+        for (int i = 0; i < pins.size(); i++)
         {
-            int i2 = gateIndexes[edge.second];
-            sums[i2] += edgeWeights[edge];
+            if (pins[i].index >= 0) pins[i].position = QPointF(xy[0][pins[i].index], xy[1][pins[i].index]);
         }
     }
-    for (int i = 0; i < job.gates.size(); i++)
+}
+
+/*
+ * Footprint of a gate in the (x, z) plane. All variants of a cell have the same dimensions.
+ */
+bool
+readGateAreas(QpData &data, const Netlist *netlist, const CellLibrary *library)
+{
+    const PlacementDb *db = data.db;
+
+    data.areas.resize(db->gateCount());
+    for (int gate = 0; gate < db->gateCount(); gate++)
     {
-        A.add(i, i, sums[i]);
+        QString cellType = netlist->cellType(db->cellName(gate));
+        int cell = library->cellIndex(cellType);
+        if (cell < 0)
+        {
+            qWarning("Can't get variant list for cell %s", qPrintable(cellType));
+            return false;
+        }
+
+        Vector<int> dimensions = library->dimensions(cell);
+        data.areas[gate] = dimensions.x * dimensions.z;
     }
+    return true;
+}
 
-    // Build bx and by
-    Array bx(job.gates.size());
-    Array by(job.gates.size());
+struct GateComparer
+{
+    GateComparer(const QVector<QPointF> &positions, bool byX)
+        : m_positions(positions), m_byX(byX)
+    {
+    }
 
-    for (int i = 0; i < edges.size(); i++)
+    bool operator()(int a, int b) const
     {
-        QPair<QString, QString> edge = edges[i];
-        if (job.pads.contains(edge.first) && job.gates.contains(edge.second))
+        QPointF pa = m_positions[a];
+        QPointF pb = m_positions[b];
+        if (!m_byX)
         {
-            int i2 = gateIndexes[edge.second];
-            bx[i2] += edgeWeights[edge] * (job.coords[edge.first].x() - job.topLeft.x());
-            by[i2] += edgeWeights[edge] * (job.coords[edge.first].y() - job.topLeft.y());
+            pa = QPointF(pa.y(), pa.x());
+            pb = QPointF(pb.y(), pb.x());
         }
+
+        if (pa.x() != pb.x()) return pa.x() < pb.x();
+        if (pa.y() != pb.y()) return pa.y() < pb.y();
+        return a < b;
     }
 
-    // Solve
-    Array x = A.solve(bx);
-    Array y = A.solve(by);
-    for (int i = 0; i < job.gates.size(); i++)
+    const QVector<QPointF> &m_positions;
+    bool m_byX;
+};
+
+/*
+ * Nets of the child are the nets of the parent which have gates of the child.
+ * Gates of the sibling become fixed pins of the child.
+ */
+void
+splitNets(Job &childJob, const Job &parentJob, const QpData &data)
+{
+    const QVector<QPointF> &positions = data.db->positions();
+
+    childJob.gatePointers.append(0);
+    childJob.fixedPointers.append(0);
+    for (int i = 0; i < parentJob.nets.size(); i++)
     {
-        QPointF p(x[i] + job.topLeft.x(), y[i] + job.topLeft.y());
+        int gates = childJob.gateCells.size();
+        int fixed = childJob.fixedPins.size();
+        for (int g = parentJob.gatePointers[i]; g < parentJob.gatePointers[i + 1]; g++)
+        {
+            int gate = parentJob.gateCells[g];
+            int slot = data.gateSlots[gate];
+            if ((slot >= childJob.begin) && (slot < childJob.end))
+            {
+                childJob.gateCells.append(gate);
+            }
+            else
+            {
+                childJob.fixedPins.append(projectPoint(positions[gate], childJob));
+            }
+        }
+
+        if (childJob.gateCells.size() == gates)
+        {
+            childJob.fixedPins.resize(fixed);
+            continue;
+        }
 
-        QString gateName = gateIndexesRev[i];
-        job.coords[gateName] = p;
+        for (int f = parentJob.fixedPointers[i]; f < parentJob.fixedPointers[i + 1]; f++)
+        {
+            childJob.fixedPins.append(projectPoint(parentJob.fixedPins[f], childJob));
+        }
+
+        childJob.nets.append(parentJob.nets[i]);
+        childJob.gatePointers.append(childJob.gateCells.size());
+        childJob.fixedPointers.append(childJob.fixedPins.size());
     }
 }
 
-bool operator <(const QPointF &a, const QPointF &b)
+/*
+ * Partitions gates[first; last) around the point where the area of the smaller
+ * gates reaches targetArea and returns that point. Like nth_element(), but
+ * the rank is found by area. Halving the range every step keeps it O(n).
+ */
+int *
+selectByArea(int *first, int *last, double targetArea, const QVector<double> &areas, const GateComparer &comparer)
 {
-    if (a.x() < b.x()) return true;
-    if (a.x() > b.x()) return false;
-    return a.y() < b.y();
+    while (last - first > 1)
+    {
+        int *middle = first + (last - first) / 2;
+        std::nth_element(first, middle, last, comparer);
+
+        double area = 0.0;
+        for (int *gate = first; gate < middle; gate++)
+        {
+            area += areas[*gate];
+        }
+
+        if (area >= targetArea)
+        {
+            last = middle;
+        }
+        else
+        {
+            targetArea -= area;
+            first = middle;
+        }
+    }
+
+    // Cut before or after the remaining gate, whichever is closer to the target
+    return (targetArea > areas[*first] / 2) ? first + 1 : first;
 }
 
-struct QPairFirstComparer
+// Smaller jobs are cut by position only, moving a single gate would unbalance them too much
+const int minRefinedJobSize = 6;
+
+/*
+ * Refines the geometric cut of gates[first; last) at middle with FM to cut fewer nets.
+ * Fixed pins pull their nets to the side of the cut line they lie on.
+ * Returns the new middle, gates of each side keep their order.
+ */
+int *
+refineSplit(int *first, int *middle, int *last, const Job &parentJob, QpData &data, const QpSettings &settings, bool splitByX)
 {
-    template<typename T1, typename T2>
-    bool operator()(const QPair<T1,T2> & a, const QPair<T1,T2> & b) const
+    int n = last - first;
+
+    double cutLine = splitByX ? (parentJob.topLeft.x() + parentJob.bottomRight.x()) / 2
+                              : (parentJob.topLeft.y() + parentJob.bottomRight.y()) / 2;
+
+    Hypergraph graph;
+    QVector<int> sides(n);
+    if (data.areas.isEmpty())
     {
-        return a.first < b.first;
+        graph.weights.fill(1.0, n);
     }
-};
+    else
+    {
+        graph.weights.resize(n);
+    }
+    for (int i = 0; i < n; i++)
+    {
+        if (!data.areas.isEmpty()) graph.weights[i] = data.areas[first[i]];
+        sides[i] = (first + i < middle) ? 0 : 1;
+    }
+
+    QVector<int> marks(n, -1);
+    graph.netPointers.append(0);
+    for (int i = 0; i < parentJob.nets.size(); i++)
+    {
+        int start = graph.netCells.size();
+        for (int g = parentJob.gatePointers[i]; g < parentJob.gatePointers[i + 1]; g++)
+        {
+            int cell = data.gateSlots[parentJob.gateCells[g]] - parentJob.begin;
+            if (marks[cell] == i) continue;
+
+            marks[cell] = i;
+            graph.netCells.append(cell);
+        }
+
+        int fixed[2] = {0, 0};
+        for (int f = parentJob.fixedPointers[i]; f < parentJob.fixedPointers[i + 1]; f++)
+        {
+            double c = splitByX ? parentJob.fixedPins[f].x() : parentJob.fixedPins[f].y();
+            if (c < cutLine) fixed[0]++;
+            else if (c > cutLine) fixed[1]++;
+        }
+
+        if ((graph.netCells.size() - start == 1) && (fixed[0] + fixed[1] == 0))
+        {
+            graph.netCells.resize(start);
+            continue;
+        }
+
+        graph.netPointers.append(graph.netCells.size());
+        graph.fixedCounts[0].append(fixed[0]);
+        graph.fixedCounts[1].append(fixed[1]);
+    }
+
+    FmPartitioner partitioner;
+    partitioner.setMaxPasses(settings.partitionPasses);
+    partitioner.setTolerance(settings.partitionTolerance);
+    partitioner.setCoarseningThreshold(settings.coarseningThreshold);
+    partitioner.refine(graph, sides);
+
+    int count = n - sides.count(1);
+    if ((count == 0) || (count == n)) return middle;
+
+    QVector<int> reordered;
+    reordered.reserve(n);
+    for (int side = 0; side < 2; side++)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            if (sides[i] == side) reordered.append(first[i]);
+        }
+    }
+
+    std::copy(reordered.constBegin(), reordered.constEnd(), first);
+    return first + count;
+}
 
 void
-split(Job &childJob1, Job &childJob2, const Job &parentJob)
+split(Job &childJob1, Job &childJob2, const Job &parentJob, QpData &data, const QpSettings &settings)
 {
     bool splitByX = !(parentJob.size.height() > 1.5 * parentJob.size.width());
 
-    QList<QPair<QPointF, QString> > coords;
-    foreach (const QString &gateName, parentJob.gates)
+    // Partition gates of the parent in place, children get the parts of its range
+    int *first = data.gates.data() + parentJob.begin;
+    int *last = data.gates.data() + parentJob.end;
+    GateComparer comparer(data.db->positions(), splitByX);
+
+    int *middle;
+    if (data.areas.isEmpty())
     {
-        QPointF p = parentJob.coords.value(gateName);
-        QPointF p2 = splitByX?p:QPointF(p.y(), p.x());
-        coords.append(qMakePair(p2, gateName));
+        middle = first + gateCount(parentJob) / 2;
+        std::nth_element(first, middle, last, comparer);
     }
-    qSort(coords.begin(), coords.end(), QPairFirstComparer());
-
-    int half = coords.size() / 2;
-    QList<QString> gates1, gates2;
-    for (int i = 0; i < coords.size(); i++)
+    else
     {
-        QPair<QPointF, QString> p = coords[i];
-        if (i < half)
+        double area = 0.0;
+        for (int *gate = first; gate < last; gate++)
         {
-            gates1.append(p.second);
+            area += data.areas[*gate];
         }
-        else
+        middle = selectByArea(first, last, area / 2, data.areas, comparer);
+
+        // Both children need gates
+        middle = qBound(first + 1, middle, last - 1);
+    }
+
+    for (int i = parentJob.begin; i < parentJob.end; i++)
+    {
+        data.gateSlots[data.gates[i]] = i;
+    }
+
+    if ((settings.partitionPasses > 0) && (gateCount(parentJob) >= minRefinedJobSize))
+    {
+        middle = refineSplit(first, middle, last, parentJob, data, settings, splitByX);
+        for (int i = parentJob.begin; i < parentJob.end; i++)
         {
-            gates2.append(p.second);
+            data.gateSlots[data.gates[i]] = i;
         }
     }
 
-    // Create gates
-    childJob1.gates = gates1.toSet();
-    childJob2.gates = gates2.toSet();
-
-    // Create pads
-    childJob1.pads = parentJob.pads + childJob2.gates;
-    childJob2.pads = parentJob.pads + childJob1.gates;
+    int half = middle - first;
+    childJob1.begin = parentJob.begin;
+    childJob1.end = parentJob.begin + half;
+    childJob2.begin = parentJob.begin + half;
+    childJob2.end = parentJob.end;
 
     // Update geometrical parameters
     childJob1.topLeft = parentJob.topLeft;
@@ -266,171 +783,398 @@ split(Job &childJob1, Job &childJob2, const Job &parentJob)
     childJob1.size = QSizeF(childJob1.bottomRight.x() - childJob1.topLeft.x(), childJob1.bottomRight.y() - childJob1.topLeft.y());
     childJob2.size = QSizeF(childJob2.bottomRight.x() - childJob2.topLeft.x(), childJob2.bottomRight.y() - childJob2.topLeft.y());
 
-    // Recalculate coordinates
-    foreach (const QString &padName, childJob1.pads)
+    // Recalculate nets
+    splitNets(childJob1, parentJob, data);
+    splitNets(childJob2, parentJob, data);
+}
+
+float
+calculateHPWL(const Job &job, const QpData &data)
+{
+    const QVector<QPointF> &positions = data.db->positions();
+
+    float hpwl = 0;
+    for (int i = 0; i < job.nets.size(); i++)
     {
-        QPointF p = parentJob.coords.value(padName);
+        QList<QPointF> points;
+        for (int g = job.gatePointers[i]; g < job.gatePointers[i + 1]; g++)
+        {
+            points.append(positions[job.gateCells[g]]);
+        }
+        for (int f = job.fixedPointers[i]; f < job.fixedPointers[i + 1]; f++)
+        {
+            points.append(job.fixedPins[f]);
+        }
 
-        p.setX(qMin(p.x(), childJob1.bottomRight.x()));
-        p.setX(qMax(p.x(), childJob1.topLeft.x()));
-        p.setY(qMin(p.y(), childJob1.bottomRight.y()));
-        p.setY(qMax(p.y(), childJob1.topLeft.y()));
+        QPointF min = points.first();
+        QPointF max = min;
+        foreach (const QPointF &p, points)
+        {
+            min.setX(qMin(min.x(), p.x()));
+            min.setY(qMin(min.y(), p.y()));
+
+            max.setX(qMax(max.x(), p.x()));
+            max.setY(qMax(max.y(), p.y()));
+        }
 
-        childJob1.coords[padName] = p;
+        hpwl += qAbs(max.x() - min.x()) + qAbs(max.y() - min.y());
     }
-    foreach (const QString &padName, childJob2.pads)
+    return hpwl;
+}
+
+void
+printSolution(const Job &job, const QpData &data)
+{
+    for (int i = job.begin; i < job.end; i++)
     {
-        QPointF p = parentJob.coords.value(padName);
+        int gate = data.gates[i];
+        QPointF p = data.db->positions()[gate];
+        qDebug("%s [%5.2f;%5.2f]", qPrintable(data.db->cellName(gate)), p.x(), p.y());
+    }
+}
 
-        p.setX(qMin(p.x(), childJob2.bottomRight.x()));
-        p.setX(qMax(p.x(), childJob2.topLeft.x()));
-        p.setY(qMin(p.y(), childJob2.bottomRight.y()));
-        p.setY(qMax(p.y(), childJob2.topLeft.y()));
+void
+solveRecursively(Job &job, QpData &data, const QpSettings &settings);
 
-        childJob2.coords[padName] = p;
+class SolveTask : public QRunnable
+{
+public:
+    SolveTask(Job &job, QpData &data, const QpSettings &settings)
+        : m_job(job), m_data(data), m_settings(settings)
+    {
     }
 
-    // Recalculate nets
-    QSet<QString> nets = parentJob.nets.keys().toSet();
-    foreach (const QString &net, nets)
+    virtual void
+    run()
     {
-        QList<QString> itemNames = parentJob.nets.values(net);
-        bool hasGates1 = false;
-        bool hasGates2 = false;
-        QList<QString> names;
-        foreach (const QString &itemName, itemNames)
-        {
-            names.append(itemName);
+        solveRecursively(m_job, m_data, m_settings);
+    }
 
-            if (parentJob.gates.contains(itemName))
-            {
-                if (childJob1.gates.contains(itemName))
-                {
-                    hasGates1 = true;
-                }
+private:
+    Job &m_job;
+    QpData &m_data;
+    const QpSettings &m_settings;
+};
 
-                if (childJob2.gates.contains(itemName))
-                {
-                    hasGates2 = true;
-                }
-            }
-        }
-        if (hasGates1)
+/*
+ * Every job writes positions of its own gates only, so results of the
+ * children don't need to be merged and don't depend on the thread count.
+ */
+void
+solveRecursively(Job &job, QpData &data, const QpSettings &settings)
+{
+    //qDebug("QP[0]: %d gates, HPWL %0.2f", gateCount(job), calculateHPWL(job, data));
+    solveQP(job, data, settings);
+    //qDebug("QP[1]: %d gates, HPWL %0.2f", gateCount(job), calculateHPWL(job, data));
+    //printSolution(job, data);
+
+    if (gateCount(job) >= 2)
+    {
+        Job childJob1;
+        Job childJob2;
+
+        split(childJob1, childJob2, job, data, settings);
+
+        /* Children are independent after split(), the second one may be stolen by an idle thread.  */
+        if ((settings.pool != 0) && (gateCount(job) >= settings.parallelCutoff))
         {
-            foreach (const QString &name, names)
-            {
-                childJob1.nets.insertMulti(net, name);
-            }
+            TaskGroup group(settings.pool);
+            group.run(new SolveTask(childJob2, data, settings));
+            solveRecursively(childJob1, data, settings);
+            group.wait();
         }
-        if (hasGates2)
+        else
         {
-            foreach (const QString &name, names)
-            {
-                childJob2.nets.insertMulti(net, name);
-            }
+            solveRecursively(childJob1, data, settings);
+            solveRecursively(childJob2, data, settings);
         }
     }
+    else if (!data.regions.isEmpty() && (gateCount(job) == 1))
+    {
+        data.regions[data.gates[job.begin]] = QRectF(job.topLeft, job.bottomRight);
+    }
+
+    //qDebug("QP[2]: %d gates, HPWL %0.2f", gateCount(job), calculateHPWL(job, data));
+    //printSolution(job, data);
 }
 
 void
-backAnnotate(Job &parentJob, const Job &childJob)
+readSettings(QpSettings &settings, const PlacementJob *placementJob)
 {
-    foreach (const QString &gateName, childJob.gates)
-    {
-        parentJob.coords[gateName] = childJob.coords[gateName];
-    }
+    settings.solver = placementJob->solver();
+    settings.preconditioner = placementJob->preconditioner();
+    settings.netModel = placementJob->netModel();
+    settings.netModelIterations = placementJob->netModelIterations();
+    settings.accuracy = 0.1 * legalizationBlockSize;
+    settings.partitionPasses = placementJob->partitionPasses();
+    settings.partitionTolerance = placementJob->partitionTolerance();
+    settings.coarseningThreshold = placementJob->coarseningThreshold();
+    settings.pool = 0;
+    settings.parallelCutoff = placementJob->parallelCutoff();
 }
 
-float
-calculateHPWL(Job &job)
+/*
+ * Jobs of a finer level, one per gate of the coarser level (in its slot order):
+ * gates of a cluster start at its position, and their job gets the region
+ * of the leaf job of the cluster. Pins of other jobs are fixed.
+ */
+void
+readClusterJobs(QVector<Job> &jobs, QpData &data, const QpData &coarse, const QVector<int> &clusters)
 {
-    float hpwl = 0;
+    PlacementDb *db = data.db;
+    const QVector<int> &netPointers = db->netPointers();
+    const QVector<int> &pinCells = db->pinCells();
+
+    int n = db->gateCount();
+    int jobCount = coarse.db->gateCount();
 
-    QSet<QString> nets = job.nets.keys().toSet();
-    foreach (const QString &netName, nets)
+    QVector<int> gateJobs(n);
+    QVector<int> pointers(jobCount + 1, 0);
+    for (int gate = 0; gate < n; gate++)
     {
-        QList<QString> items = job.nets.values(netName);
-        QList<QPointF> points;
-        foreach (const QString &itemName, items)
+        gateJobs[gate] = coarse.gateSlots[clusters[gate]];
+        pointers[gateJobs[gate] + 1]++;
+    }
+    for (int i = 0; i < jobCount; i++)
+    {
+        pointers[i + 1] += pointers[i];
+    }
+
+    QVector<int> fill = pointers;
+    data.gates.resize(n);
+    data.gateSlots.resize(n);
+    for (int gate = 0; gate < n; gate++)
+    {
+        int slot = fill[gateJobs[gate]]++;
+        data.gates[slot] = gate;
+        data.gateSlots[gate] = slot;
+        db->positions()[gate] = coarse.db->positions()[clusters[gate]];
+    }
+
+    jobs.resize(jobCount);
+    for (int i = 0; i < jobCount; i++)
+    {
+        Job &job = jobs[i];
+        job.begin = pointers[i];
+        job.end = pointers[i + 1];
+
+        QRectF region = coarse.regions[coarse.gates[i]];
+        job.topLeft = region.topLeft();
+        job.bottomRight = region.bottomRight();
+        job.size = QSizeF(region.width(), region.height());
+
+        job.gatePointers.append(0);
+        job.fixedPointers.append(0);
+    }
+
+    QVector<int> marks(jobCount, -1);
+    QVector<int> netJobs;
+    for (int net = 0; net < db->netCount(); net++)
+    {
+        netJobs.clear();
+        for (int pin = netPointers[net]; pin < netPointers[net + 1]; pin++)
         {
-            if (!job.coords.contains(itemName))
-            {
-                return -1;
-            }
-            QPointF p = job.coords.value(itemName);
-            points.append(p);
+            int cell = pinCells[pin];
+            if (!db->isGate(cell) || (marks[gateJobs[cell]] == net)) continue;
+
+            marks[gateJobs[cell]] = net;
+            netJobs.append(gateJobs[cell]);
         }
 
-        QPointF min = points.first();
-        QPointF max = min;
-        foreach (const QPointF &p, points)
+        foreach (int i, netJobs)
         {
-            min.setX(qMin(min.x(), p.x()));
-            min.setY(qMin(min.y(), p.y()));
+            Job &job = jobs[i];
+            for (int pin = netPointers[net]; pin < netPointers[net + 1]; pin++)
+            {
+                int cell = pinCells[pin];
+                if (db->isGate(cell) && (gateJobs[cell] == i))
+                {
+                    job.gateCells.append(cell);
+                }
+                else
+                {
+                    job.fixedPins.append(projectPoint(db->positions()[cell], job));
+                }
+            }
 
-            max.setX(qMax(max.x(), p.x()));
-            max.setY(qMax(max.y(), p.y()));
+            job.nets.append(net);
+            job.gatePointers.append(job.gateCells.size());
+            job.fixedPointers.append(job.fixedPins.size());
         }
-
-        hpwl += qAbs(max.x() - min.x()) + qAbs(max.y() - min.y());
     }
-    return hpwl;
 }
 
+class LevelTask : public QRunnable
+{
+public:
+    LevelTask(QVector<Job> &jobs, int first, int last, QpData &data, const QpSettings &settings)
+        : m_jobs(jobs), m_first(first), m_last(last), m_data(data), m_settings(settings)
+    {
+    }
+
+    virtual void
+    run()
+    {
+        for (int i = m_first; i < m_last; i++)
+        {
+            solveRecursively(m_jobs[i], m_data, m_settings);
+        }
+    }
+
+private:
+    QVector<Job> &m_jobs;
+    int m_first, m_last;
+    QpData &m_data;
+    const QpSettings &m_settings;
+};
+
+// Jobs of a level are independent like the children of a split
 void
-printSolution(Job &job)
+solveLevel(QVector<Job> &jobs, QpData &data, const QpSettings &settings)
 {
-    QList<QString> gates = job.gates.toList();
-    qSort(gates);
+    if (settings.pool == 0)
+    {
+        LevelTask(jobs, 0, jobs.size(), data, settings).run();
+        return;
+    }
+
+    int chunk = qMax(1, jobs.size() / (4 * settings.pool->threadCount()));
 
-    foreach (const QString &gateName, gates)
+    TaskGroup group(settings.pool);
+    for (int first = 0; first < jobs.size(); first += chunk)
     {
-        QPointF p = job.coords.value(gateName);
-        qDebug("%s [%5.2f;%5.2f]", qPrintable(gateName), p.x(), p.y());
+        group.run(new LevelTask(jobs, first, qMin(first + chunk, jobs.size()), data, settings));
     }
+    group.wait();
 }
 
+/*
+ * Appends coarser levels until the last one has at most threshold gates.
+ * clusters[i] maps gates of level i to gates of level i + 1.
+ */
 void
-solveRecursively(Job &job)
+coarsenLevels(QList<QpData> &levels, QList<QVector<int> > &clusters, int threshold)
 {
-    //qDebug("QP[0]: %d gates, HPWL %0.2f", job.gates.size(), calculateHPWL(job));
-    solveQP(job);
-    //qDebug("QP[1]: %d gates, HPWL %0.2f", job.gates.size(), calculateHPWL(job));
-    //printSolution(job);
-
-    if (job.gates.size() >= 2)
+    while ((threshold > 0) && (levels.last().db->gateCount() > threshold))
     {
-        Job childJob1;
-        Job childJob2;
+        const QpData &fine = levels.last();
+        int n = fine.db->gateCount();
+
+        QVector<double> weights = fine.areas;
+        if (weights.isEmpty()) weights.fill(1.0, n);
 
-        split(childJob1, childJob2, job);
+        double total = 0.0;
+        foreach (double weight, weights)
+        {
+            total += weight;
+        }
 
-        solveRecursively(childJob1);
-        solveRecursively(childJob2);
+        QVector<int> map;
+        int count = matchGates(fine.db, weights, maxClusterWeight * total / n, map);
+        if (count > maxCoarseningRatio * n) break;
 
-        backAnnotate(job, childJob1);
-        backAnnotate(job, childJob2);
-    }
+        QpData coarse;
+        coarse.db = PlacementDb::cluster(fine.db, map, count);
+        coarse.areas.fill(0.0, count);
+        for (int gate = 0; gate < n; gate++)
+        {
+            coarse.areas[map[gate]] += weights[gate];
+        }
+        coarse.regions.resize(count);
 
-    //qDebug("QP[2]: %d gates, HPWL %0.2f", job.gates.size(), calculateHPWL(job));
-    //printSolution(job);
+        levels.append(coarse);
+        clusters.append(map);
+    }
 }
 
+/*
+ * Large netlists are clustered first: the coarsest level is bisected down to
+ * single clusters, and every finer level continues the bisection inside
+ * the regions of its clusters.
+ */
 NetPlacement
-placeQuad(const Netlist *netlist, const PlacementJob *placementJob)
+placeQuad(const Netlist *netlist, const PlacementJob *placementJob, const CellLibrary *library, const GateInflation &inflation, const NetWeights &netWeights)
 {
     NetPlacement placement;
 
-    Job job;
-    if (!readJob(job, netlist, placementJob))
+    QScopedPointer<PlacementDb> db(PlacementDb::build(netlist));
+    if (db.isNull())
     {
         qWarning("Can't initialize QP job");
         return placement;
     }
+    db->netWeights() = netWeights;
 
-    solveRecursively(job);
+    QpData data;
+    data.db = db.data();
 
-    savePlacement(placement, job);
+    if (placementJob->partitionBalance() == PlacementJob::AreaBalance)
+    {
+        if (!readGateAreas(data, netlist, library))
+        {
+            qWarning("Can't get gate areas, bisection balances gate counts");
+            data.areas.clear();
+        }
+    }
+
+    if (!inflation.isEmpty())
+    {
+        if (data.areas.isEmpty()) data.areas.fill(1.0, db->gateCount());
+        for (int gate = 0; gate < db->gateCount(); gate++)
+        {
+            data.areas[gate] *= inflation.value(db->cellName(gate), 1.0);
+        }
+    }
+
+    QList<QpData> levels;
+    QList<QVector<int> > clusters;
+    levels.append(data);
+    coarsenLevels(levels, clusters, placementJob->clusteringThreshold());
+    if (levels.size() > 1)
+    {
+        qDebug("Clustering: %d levels, %d clusters", levels.size() - 1, levels.last().db->gateCount());
+    }
+
+    QpSettings settings;
+    readSettings(settings, placementJob);
+
+    int threads = placementJob->threadCount();
+    if (threads <= 0)
+    {
+        threads = QThread::idealThreadCount();
+    }
+    TaskPool pool(threads);
+    settings.pool = (pool.threadCount() > 1) ? &pool : 0;
+
+    Job job;
+    readJob(job, levels.last(), placementJob);
+    solveRecursively(job, levels.last(), settings);
+
+    for (int level = levels.size() - 2; level >= 0; level--)
+    {
+        QVector<Job> jobs;
+        readClusterJobs(jobs, levels[level], levels[level + 1], clusters[level]);
+        solveLevel(jobs, levels[level], settings);
+
+        delete levels[level + 1].db;
+    }
+
+    savePlacement(placement, db.data());
 
     return placement;
 }
+
+void
+solveGlobalQP(PlacementDb *db, const PlacementJob *placementJob)
+{
+    QpData data;
+    data.db = db;
+
+    Job job;
+    readJob(job, data, placementJob);
+
+    QpSettings settings;
+    readSettings(settings, placementJob);
+
+    solveQP(job, data, settings);
+}
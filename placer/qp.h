@@ -5,8 +5,16 @@
 
 class Netlist;
 class PlacementJob;
+class CellLibrary;
+class PlacementDb;
 
+// Bisection balances the inflated gate areas, QP nets are scaled by their weights
 NetPlacement
-placeQuad(const Netlist *netlist, const PlacementJob *placementJob);
+placeQuad(const Netlist *netlist, const PlacementJob *placementJob, const CellLibrary *library,
+          const GateInflation &inflation = GateInflation(), const NetWeights &netWeights = NetWeights());
+
+// First QP of placeQuad(): gates of the database are placed without spreading
+void
+solveGlobalQP(PlacementDb *db, const PlacementJob *placementJob);
 
 #endif // QP_H
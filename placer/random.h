@@ -0,0 +1,57 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <QtGlobal>
+
+/*
+ * xorshift32, the same sequence on every platform and Qt version.
+ * Generators are cheap values: every thread or task takes its own one,
+ * seeded with mixSeed() from the seed of the job and its place in the work.
+ */
+class Random
+{
+public:
+    Random(quint32 seed)
+        : m_state(seed ? seed : 0x9e3779b9u)
+    {
+    }
+
+    quint32
+    next()
+    {
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 17;
+        m_state ^= m_state << 5;
+        return m_state;
+    }
+
+    // [0; n)
+    int
+    bounded(int n)
+    {
+        return next() % quint32(n);
+    }
+
+    // [0; 1)
+    double
+    uniform()
+    {
+        return (next() >> 8) * (1.0 / 16777216.0);
+    }
+
+private:
+    quint32 m_state;
+};
+
+// Seed of stream b of seed a
+inline quint32
+mixSeed(quint32 a, quint32 b)
+{
+    quint32 h = a * 0x85ebca6bu ^ (b + 0x9e3779b9u + (a << 6) + (a >> 2));
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    return h;
+}
+
+#endif // RANDOM_H
@@ -0,0 +1,205 @@
+#include "taskpool.h"
+#include <QThread>
+
+class TaskPoolThread : public QThread
+{
+public:
+    TaskPoolThread(TaskPool *pool, int index)
+        : m_pool(pool), m_index(index)
+    {
+    }
+
+protected:
+    virtual void
+    run()
+    {
+        m_pool->workerLoop(m_index);
+    }
+
+private:
+    TaskPool *m_pool;
+    int m_index;
+};
+
+TaskPool::TaskPool(int threadCount)
+{
+    m_stopping = false;
+
+    int workers = qMax(0, threadCount - 1);
+    for (int i = 0; i <= workers; i++)
+    {
+        m_queues.append(new Queue());
+    }
+    for (int i = 0; i < workers; i++)
+    {
+        TaskPoolThread *thread = new TaskPoolThread(this, i);
+        m_threads.append(thread);
+        thread->start();
+    }
+}
+
+TaskPool::~TaskPool()
+{
+    m_sleepMutex.lock();
+    m_stopping = true;
+    m_sleep.wakeAll();
+    m_sleepMutex.unlock();
+
+    foreach (TaskPoolThread *thread, m_threads)
+    {
+        thread->wait();
+    }
+    qDeleteAll(m_threads);
+    qDeleteAll(m_queues);
+}
+
+int
+TaskPool::threadCount() const
+{
+    return m_threads.size() + 1;
+}
+
+int
+TaskPool::currentQueue()
+{
+    if (m_threadIndex.hasLocalData())
+    {
+        return m_threadIndex.localData();
+    }
+    return m_threads.size();
+}
+
+void
+TaskPool::push(const TaskPool::Task &task)
+{
+    Queue *queue = m_queues[currentQueue()];
+
+    queue->mutex.lock();
+    queue->tasks.append(task);
+    queue->mutex.unlock();
+
+    m_queued.ref();
+
+    m_sleepMutex.lock();
+    m_sleep.wakeOne();
+    m_sleepMutex.unlock();
+}
+
+bool
+TaskPool::takeTask(TaskPool::Task &task)
+{
+    int own = currentQueue();
+
+    /* Newest task of our own queue first, it is the most likely to be in the cache.  */
+    Queue *queue = m_queues[own];
+    queue->mutex.lock();
+    if (!queue->tasks.isEmpty())
+    {
+        task = queue->tasks.takeLast();
+        queue->mutex.unlock();
+        return true;
+    }
+    queue->mutex.unlock();
+
+    /* Steal the oldest task of another queue, it is usually the biggest one.  */
+    for (int i = 1; i < m_queues.size(); i++)
+    {
+        Queue *victim = m_queues[(own + i) % m_queues.size()];
+        victim->mutex.lock();
+        if (!victim->tasks.isEmpty())
+        {
+            task = victim->tasks.takeFirst();
+            victim->mutex.unlock();
+            return true;
+        }
+        victim->mutex.unlock();
+    }
+
+    return false;
+}
+
+bool
+TaskPool::runPendingTask()
+{
+    Task task;
+    if (!takeTask(task)) return false;
+
+    m_queued.deref();
+
+    QRunnable *runnable = task.runnable;
+    runnable->run();
+    if (runnable->autoDelete())
+    {
+        delete runnable;
+    }
+
+    /* The group may be destroyed as soon as its counter drops to zero.  */
+    if (!task.group->m_remaining.deref())
+    {
+        m_sleepMutex.lock();
+        m_sleep.wakeAll();
+        m_sleepMutex.unlock();
+    }
+    return true;
+}
+
+void
+TaskPool::waitFor(TaskGroup *group)
+{
+    while (group->m_remaining.loadAcquire() > 0)
+    {
+        /* Help with pending tasks instead of blocking.  */
+        if (runPendingTask()) continue;
+
+        QMutexLocker locker(&m_sleepMutex);
+        while ((group->m_remaining.loadAcquire() > 0) && (m_queued.loadAcquire() == 0))
+        {
+            m_sleep.wait(&m_sleepMutex);
+        }
+    }
+}
+
+void
+TaskPool::workerLoop(int index)
+{
+    m_threadIndex.setLocalData(index);
+
+    forever
+    {
+        if (runPendingTask()) continue;
+
+        QMutexLocker locker(&m_sleepMutex);
+        while ((m_queued.loadAcquire() == 0) && !m_stopping)
+        {
+            m_sleep.wait(&m_sleepMutex);
+        }
+        if (m_stopping) return;
+    }
+}
+
+TaskGroup::TaskGroup(TaskPool *pool)
+    : m_pool(pool)
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+    wait();
+}
+
+void
+TaskGroup::run(QRunnable *runnable)
+{
+    TaskPool::Task task;
+    task.runnable = runnable;
+    task.group = this;
+
+    m_remaining.ref();
+    m_pool->push(task);
+}
+
+void
+TaskGroup::wait()
+{
+    m_pool->waitFor(this);
+}
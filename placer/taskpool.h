@@ -0,0 +1,109 @@
+#ifndef TASKPOOL_H
+#define TASKPOOL_H
+
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QThreadStorage>
+#include <QRunnable>
+
+class TaskGroup;
+class TaskPoolThread;
+
+/*
+ * Work-stealing thread pool for fork-join parallelism.
+ *
+ * Every worker has its own queue: new tasks are pushed to the back of the
+ * queue of the thread which creates them and taken from the back by the same
+ * thread, idle workers steal from the front of other queues. Threads which
+ * don't belong to the pool share one extra queue.
+ *
+ * Tasks are started with TaskGroup. A thread waiting for a group executes
+ * pending tasks meanwhile, so nested groups don't block the pool.
+ */
+class TaskPool
+{
+public:
+    // Calling thread is counted as one of threadCount threads
+    TaskPool(int threadCount);
+    ~TaskPool();
+
+    int
+    threadCount() const;
+
+private:
+    Q_DISABLE_COPY(TaskPool)
+
+    struct Task
+    {
+        QRunnable *runnable;
+        TaskGroup *group;
+    };
+
+    struct Queue
+    {
+        QMutex mutex;
+        QList<Task> tasks;
+    };
+
+    void
+    push(const Task &task);
+
+    // Returns false if there is nothing to do
+    bool
+    runPendingTask();
+
+    bool
+    takeTask(Task &task);
+
+    void
+    waitFor(TaskGroup *group);
+
+    void
+    workerLoop(int index);
+
+    int
+    currentQueue();
+
+private:
+    QList<TaskPoolThread *> m_threads;
+    QList<Queue *> m_queues; // Worker queues and the queue for foreign threads
+    QThreadStorage<int> m_threadIndex;
+
+    QAtomicInt m_queued;
+    QMutex m_sleepMutex;
+    QWaitCondition m_sleep;
+    bool m_stopping;
+
+    friend class TaskGroup;
+    friend class TaskPoolThread;
+};
+
+/*
+ * Set of tasks which can be waited for.
+ * Destructor waits for all tasks of the group.
+ */
+class TaskGroup
+{
+public:
+    TaskGroup(TaskPool *pool);
+    ~TaskGroup();
+
+    // Takes ownership of the runnable if autoDelete() is set
+    void
+    run(QRunnable *runnable);
+
+    void
+    wait();
+
+private:
+    Q_DISABLE_COPY(TaskGroup)
+
+    TaskPool *m_pool;
+    QAtomicInt m_remaining;
+
+    friend class TaskPool;
+};
+
+#endif // TASKPOOL_H
@@ -0,0 +1,352 @@
+#include "timinganalysis.h"
+#include "placementjob.h"
+#include "common/netlist.h"
+#include "common/celllibrary.h"
+#include <QScopedPointer>
+
+/*
+ * Pins of item i are itemPins[itemPointers[i]; itemPointers[i + 1]),
+ * drivers[net] is the output pin of a gate or a pad pin, -1 for undriven nets.
+ */
+typedef struct {
+    const Netlist *netlist;
+    int maxWireLength;
+    int repeaterDelay;
+
+    QVector<int> delays;      // item -> ticks
+    QVector<int> drivers;     // net -> driving pin
+    QVector<int> outputs;     // item -> output pin of a gate, -1 if it drives nothing
+    QVector<int> itemPointers;
+    QVector<int> itemPins;
+
+    QVector<Vector<int> > pinPositions;
+    QVector<bool> placed;     // pin -> whether its item is placed
+
+    QVector<int> arrivals;    // item -> arrival time at the output
+    QVector<int> required;    // item -> required time at the output
+} TimingData;
+
+bool
+isGate(const TimingData &data, int item)
+{
+    return !data.netlist->isDeleted(item) && !data.netlist->isPad(item);
+}
+
+QString
+cellTypeName(const Netlist *netlist, int item)
+{
+    int cellType = netlist->cellTypeId(item);
+    return (cellType >= 0) ? netlist->cellTypeName(cellType) : QString();
+}
+
+int
+wireDelay(const TimingData &data, int from, int to)
+{
+    if (!data.placed[from] || !data.placed[to]) return 0;
+
+    int distance = (data.pinPositions[to] - data.pinPositions[from]).length();
+    return data.repeaterDelay * (distance / data.maxWireLength);
+}
+
+// Arrival time at the driver of the net
+int
+sourceArrival(const TimingData &data, int net)
+{
+    int driver = data.drivers[net];
+    return (driver >= 0) ? data.arrivals[data.netlist->pinItem(driver)] : 0;
+}
+
+// Required time at the driver of the net for the sink pin
+int
+sinkRequired(const TimingData &data, int pin, int endTime)
+{
+    int item = data.netlist->pinItem(pin);
+    int sink = data.netlist->isPad(item) ? endTime : data.required[item] - data.delays[item];
+    return sink - wireDelay(data, data.drivers[data.netlist->pinNet(pin)], pin);
+}
+
+// Required time at the driver of the net, endTime if nothing needs the signal
+int
+sourceRequired(const TimingData &data, int net, int endTime)
+{
+    const Netlist *netlist = data.netlist;
+    int driver = data.drivers[net];
+    if (driver < 0) return endTime;
+
+    int result = endTime;
+    for (int pin = netlist->netPinBegin(net); pin < netlist->netPinEnd(net); pin++)
+    {
+        if ((pin == driver) || netlist->isDeleted(netlist->pinItem(pin))) continue;
+
+        result = qMin(result, sinkRequired(data, pin, endTime));
+    }
+    return result;
+}
+
+bool
+readCells(TimingData &data, const CellLibrary *library, const PlacementJob *placementJob)
+{
+    const Netlist *netlist = data.netlist;
+    int itemCount = netlist->itemCount();
+
+    data.delays.fill(0, itemCount);
+    data.drivers.fill(-1, netlist->netCount());
+    data.outputs.fill(-1, itemCount);
+    data.pinPositions.resize(netlist->pinCount());
+    data.placed.fill(false, netlist->pinCount());
+
+    /* Gate outputs drive their nets, pads only nets without a gate output  */
+    QVector<QString> outputPorts(itemCount);
+    for (int item = 0; item < itemCount; item++)
+    {
+        if (!isGate(data, item)) continue;
+
+        PlacementJob::CellTiming timing = placementJob->cellTiming(cellTypeName(netlist, item));
+        data.delays[item] = timing.delay;
+        outputPorts[item] = timing.output;
+    }
+
+    for (int pin = 0; pin < netlist->pinCount(); pin++)
+    {
+        int item = netlist->pinItem(pin);
+        if (netlist->isDeleted(item)) continue;
+
+        int net = netlist->pinNet(pin);
+        int driver = data.drivers[net];
+        bool padDriver = (driver >= 0) && netlist->isPad(netlist->pinItem(driver));
+        if (netlist->isPad(item))
+        {
+            if (driver < 0) data.drivers[net] = pin;
+            continue;
+        }
+
+        if (netlist->pinPort(pin) != outputPorts[item]) continue;
+        if ((driver >= 0) && !padDriver)
+        {
+            qWarning("Net %s has more than one driver", qPrintable(netlist->netName(net)));
+            return false;
+        }
+        data.drivers[net] = pin;
+        data.outputs[item] = pin;
+    }
+
+    /* Pin positions, port offsets are known once the item has a variant  */
+    for (int pin = 0; pin < netlist->pinCount(); pin++)
+    {
+        int item = netlist->pinItem(pin);
+        if (netlist->isDeleted(item) || !netlist->hasPosition(item)) continue;
+
+        Vector<int> p = netlist->position(item);
+        int cell = library->cellIndex(cellTypeName(netlist, item));
+        int variant = netlist->variantId(item);
+        if ((cell >= 0) && (variant >= 0))
+        {
+            int v = library->variantIndex(cell, netlist->variantName(variant));
+            int port = library->portIndex(cell, netlist->pinPort(pin));
+            if ((v >= 0) && (port >= 0)) p = p + library->portOffset(cell, v, port);
+        }
+        data.pinPositions[pin] = p;
+        data.placed[pin] = true;
+    }
+
+    /* Pins of the items  */
+    data.itemPointers.fill(0, itemCount + 1);
+    for (int pin = 0; pin < netlist->pinCount(); pin++)
+    {
+        data.itemPointers[netlist->pinItem(pin) + 1]++;
+    }
+    for (int item = 0; item < itemCount; item++)
+    {
+        data.itemPointers[item + 1] += data.itemPointers[item];
+    }
+    QVector<int> fill = data.itemPointers;
+    data.itemPins.resize(netlist->pinCount());
+    for (int pin = 0; pin < netlist->pinCount(); pin++)
+    {
+        data.itemPins[fill[netlist->pinItem(pin)]++] = pin;
+    }
+
+    return true;
+}
+
+/*
+ * Gates ordered so that the drivers of the inputs of a gate come first
+ */
+bool
+sortGates(const TimingData &data, QVector<int> &order)
+{
+    const Netlist *netlist = data.netlist;
+
+    QVector<int> pending(netlist->itemCount(), 0);
+    int gates = 0;
+    for (int item = 0; item < netlist->itemCount(); item++)
+    {
+        if (!isGate(data, item)) continue;
+
+        gates++;
+        for (int i = data.itemPointers[item]; i < data.itemPointers[item + 1]; i++)
+        {
+            int driver = data.drivers[netlist->pinNet(data.itemPins[i])];
+            if ((driver >= 0) && (driver != data.itemPins[i]) && !netlist->isPad(netlist->pinItem(driver))) pending[item]++;
+        }
+        if (pending[item] == 0) order.append(item);
+    }
+
+    for (int next = 0; next < order.size(); next++)
+    {
+        int output = data.outputs[order[next]];
+        if (output < 0) continue;
+
+        int net = netlist->pinNet(output);
+        for (int pin = netlist->netPinBegin(net); pin < netlist->netPinEnd(net); pin++)
+        {
+            int item = netlist->pinItem(pin);
+            if ((pin == output) || !isGate(data, item)) continue;
+
+            if (--pending[item] == 0) order.append(item);
+        }
+    }
+
+    if (order.size() < gates)
+    {
+        for (int item = 0; item < netlist->itemCount(); item++)
+        {
+            if (isGate(data, item) && (pending[item] > 0))
+            {
+                qWarning("Combinational loop through %s", qPrintable(netlist->itemName(item)));
+                break;
+            }
+        }
+        return false;
+    }
+    return true;
+}
+
+TimingAnalysis::TimingAnalysis()
+{
+    m_criticalPathDelay = 0;
+}
+
+int
+TimingAnalysis::criticalPathDelay() const
+{
+    return m_criticalPathDelay;
+}
+
+int
+TimingAnalysis::netCount() const
+{
+    return m_slacks.size();
+}
+
+int
+TimingAnalysis::arrival(int item) const
+{
+    return m_arrivals[item];
+}
+
+int
+TimingAnalysis::driver(int net) const
+{
+    return m_drivers[net];
+}
+
+int
+TimingAnalysis::pinSlack(int pin) const
+{
+    return m_pinSlacks[pin];
+}
+
+int
+TimingAnalysis::slack(int net) const
+{
+    return m_slacks[net];
+}
+
+double
+TimingAnalysis::criticality(int net) const
+{
+    if (m_criticalPathDelay <= 0) return 0.0;
+
+    return qBound(0.0, 1.0 - double(m_slacks[net]) / m_criticalPathDelay, 1.0);
+}
+
+TimingAnalysis *
+TimingAnalysis::run(const Netlist *netlist, const CellLibrary *library, const PlacementJob *placementJob)
+{
+    TimingData data;
+    data.netlist = netlist;
+    data.maxWireLength = placementJob->maxWireLength();
+    data.repeaterDelay = placementJob->repeaterDelay();
+    if (!readCells(data, library, placementJob)) return 0;
+
+    QVector<int> order;
+    if (!sortGates(data, order)) return 0;
+
+    /* Arrival times, forward  */
+    data.arrivals.fill(0, netlist->itemCount());
+    foreach (int gate, order)
+    {
+        int latest = 0;
+        for (int i = data.itemPointers[gate]; i < data.itemPointers[gate + 1]; i++)
+        {
+            int pin = data.itemPins[i];
+            int net = netlist->pinNet(pin);
+            int driver = data.drivers[net];
+            if ((driver < 0) || (driver == pin)) continue;
+
+            latest = qMax(latest, sourceArrival(data, net) + wireDelay(data, driver, pin));
+        }
+        data.arrivals[gate] = latest + data.delays[gate];
+    }
+
+    /* Paths end at the primary outputs and at gates without loads  */
+    int endTime = 0;
+    foreach (int gate, order)
+    {
+        endTime = qMax(endTime, data.arrivals[gate]);
+    }
+    for (int pin = 0; pin < netlist->pinCount(); pin++)
+    {
+        int net = netlist->pinNet(pin);
+        int driver = data.drivers[net];
+        if (!netlist->isPad(netlist->pinItem(pin)) || netlist->isDeleted(netlist->pinItem(pin))) continue;
+        if ((driver < 0) || (driver == pin)) continue;
+
+        endTime = qMax(endTime, sourceArrival(data, net) + wireDelay(data, driver, pin));
+    }
+
+    /* Required times, backward  */
+    data.required.fill(endTime, netlist->itemCount());
+    for (int i = order.size() - 1; i >= 0; i--)
+    {
+        int output = data.outputs[order[i]];
+        if (output >= 0) data.required[order[i]] = sourceRequired(data, netlist->pinNet(output), endTime);
+    }
+
+    QScopedPointer<TimingAnalysis> analysis(new TimingAnalysis());
+    analysis->m_criticalPathDelay = endTime;
+    analysis->m_arrivals = data.arrivals;
+    analysis->m_drivers = data.drivers;
+    analysis->m_slacks.resize(netlist->netCount());
+    for (int net = 0; net < netlist->netCount(); net++)
+    {
+        analysis->m_slacks[net] = sourceRequired(data, net, endTime) - sourceArrival(data, net);
+    }
+    analysis->m_pinSlacks.resize(netlist->pinCount());
+    for (int pin = 0; pin < netlist->pinCount(); pin++)
+    {
+        int net = netlist->pinNet(pin);
+        int driver = data.drivers[net];
+        if ((driver < 0) || (driver == pin))
+        {
+            analysis->m_pinSlacks[pin] = analysis->m_slacks[net];
+        }
+        else
+        {
+            analysis->m_pinSlacks[pin] = sinkRequired(data, pin, endTime) - sourceArrival(data, net);
+        }
+    }
+
+    return analysis.take();
+}
@@ -0,0 +1,70 @@
+#ifndef TIMINGANALYSIS_H
+#define TIMINGANALYSIS_H
+
+#include <QVector>
+
+class Netlist;
+class CellLibrary;
+class PlacementJob;
+
+/*
+ * Static timing analysis of a combinational netlist in redstone ticks.
+ *
+ * Every gate delays its output by the ticks of its cell in the timing
+ * library of the job. A net is driven by the output port of a gate, nets
+ * without one are driven by their pads, which are the primary inputs. Pads
+ * on gate driven nets are the primary outputs. Redstone signal fades after
+ * maxWireLength blocks, so a wire between two pins d blocks apart (Manhattan
+ * distance) needs d / maxWireLength repeaters of repeaterDelay ticks each.
+ * Pins of unplaced items have no wire delay, which leaves the logic depth.
+ *
+ * Slack of a sink pin is its required time minus the arrival of the
+ * signal, the driver of a net has the worst slack of its sinks. Slack of a net
+ * is the slack of its driver, criticality is
+ * 1 - slack / criticalPathDelay(), 1 on the critical path and 0 for nets
+ * with full slack. IDs are the IDs of the netlist.
+ */
+class TimingAnalysis
+{
+public:
+    // Longest path from the inputs to the outputs
+    int
+    criticalPathDelay() const;
+
+    int
+    netCount() const;
+
+    // Arrival time at the output of the item, 0 for pads
+    int
+    arrival(int item) const;
+
+    // Driving pin of the net, -1 if nothing drives it
+    int
+    driver(int net) const;
+
+    int
+    pinSlack(int pin) const;
+
+    int
+    slack(int net) const;
+
+    double
+    criticality(int net) const;
+
+public:
+    // Returns 0 for combinational loops and nets with several drivers
+    static TimingAnalysis *
+    run(const Netlist *netlist, const CellLibrary *library, const PlacementJob *placementJob);
+
+private:
+    TimingAnalysis();
+
+private:
+    int m_criticalPathDelay;
+    QVector<int> m_arrivals;
+    QVector<int> m_drivers;
+    QVector<int> m_pinSlacks;
+    QVector<int> m_slacks;
+};
+
+#endif // TIMINGANALYSIS_H
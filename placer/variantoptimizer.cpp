@@ -0,0 +1,144 @@
+#include "variantoptimizer.h"
+#include "hpwlengine.h"
+#include "taskpool.h"
+#include <QVector>
+#include <QRunnable>
+
+// Smallest number of items evaluated by one task
+const int minChunkSize = 64;
+
+/*
+ * Greedy colouring: an item gets the smallest colour not used on any of its nets.
+ * Returns items by colour.
+ */
+QVector<QVector<int> >
+colourItems(const HpwlEngine *engine, const QVector<int> &items)
+{
+    QVector<QVector<int> > netColours(engine->netCount());
+    QVector<QVector<int> > colours;
+    QVector<int> marks; // colour -> last item which can't take it
+
+    foreach (int item, items)
+    {
+        QVector<int> nets = engine->itemNets(item);
+        foreach (int net, nets)
+        {
+            foreach (int colour, netColours[net])
+            {
+                marks[colour] = item;
+            }
+        }
+
+        int colour = 0;
+        while ((colour < marks.size()) && (marks[colour] == item)) colour++;
+        if (colour == colours.size())
+        {
+            colours.append(QVector<int>());
+            marks.append(-1);
+        }
+
+        colours[colour].append(item);
+        foreach (int net, nets)
+        {
+            netColours[net].append(colour);
+        }
+    }
+    return colours;
+}
+
+// Best variant of the item, -1 if no variant reduces HPWL
+int
+bestVariant(const HpwlEngine *engine, int item)
+{
+    int best = -1;
+    int bestDelta = 0;
+    for (int v = 0; v < engine->variantCount(item); v++)
+    {
+        int delta = engine->variantDelta(item, v);
+        if (delta < bestDelta)
+        {
+            bestDelta = delta;
+            best = v;
+        }
+    }
+    return best;
+}
+
+class VariantTask : public QRunnable
+{
+public:
+    VariantTask(const HpwlEngine *engine, const QVector<int> &items, int first, int last, QVector<int> &variants)
+        : m_engine(engine), m_items(items), m_first(first), m_last(last), m_variants(variants)
+    {
+    }
+
+    virtual void
+    run()
+    {
+        for (int i = m_first; i < m_last; i++)
+        {
+            m_variants[i] = bestVariant(m_engine, m_items[i]);
+        }
+    }
+
+private:
+    const HpwlEngine *m_engine;
+    const QVector<int> &m_items;
+    int m_first, m_last;
+    QVector<int> &m_variants;
+};
+
+/*
+ * Items of one colour don't share nets, so each delta stays valid while the
+ * others are applied. Evaluation runs in parallel, application is sequential
+ * because it updates the total HPWL.
+ */
+int
+selectVariants(HpwlEngine *engine, TaskPool *pool, int maxPasses)
+{
+    QVector<int> items;
+    for (int item = 0; item < engine->itemCount(); item++)
+    {
+        if (engine->variantCount(item) > 1) items.append(item);
+    }
+
+    QVector<QVector<int> > colours = colourItems(engine, items);
+
+    int pass = 0;
+    while (pass < maxPasses)
+    {
+        pass++;
+
+        int changes = 0;
+        foreach (const QVector<int> &colour, colours)
+        {
+            QVector<int> variants(colour.size());
+            if ((pool != 0) && (colour.size() >= 2 * minChunkSize))
+            {
+                int chunk = qMax(minChunkSize, colour.size() / (4 * pool->threadCount()) + 1);
+
+                TaskGroup group(pool);
+                for (int first = 0; first < colour.size(); first += chunk)
+                {
+                    group.run(new VariantTask(engine, colour, first, qMin(first + chunk, colour.size()), variants));
+                }
+                group.wait();
+            }
+            else
+            {
+                VariantTask(engine, colour, 0, colour.size(), variants).run();
+            }
+
+            for (int i = 0; i < colour.size(); i++)
+            {
+                if (variants[i] < 0) continue;
+
+                engine->setVariant(colour[i], variants[i]);
+                changes++;
+            }
+        }
+
+        if (changes == 0) break;
+    }
+    return pass;
+}
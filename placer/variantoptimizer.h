@@ -0,0 +1,19 @@
+#ifndef VARIANTOPTIMIZER_H
+#define VARIANTOPTIMIZER_H
+
+class HpwlEngine;
+class TaskPool;
+
+/*
+ * Gives every item its best variant for the current variants of the other
+ * items, repeated until no variant change reduces HPWL or maxPasses is
+ * reached. Returns the number of passes.
+ *
+ * Items are coloured so that items of one colour share no nets. Their
+ * deltas are independent and are evaluated in parallel (no pool:
+ * sequentially), the result doesn't depend on the thread count.
+ */
+int
+selectVariants(HpwlEngine *engine, TaskPool *pool, int maxPasses);
+
+#endif // VARIANTOPTIMIZER_H
@@ -0,0 +1,71 @@
+#-------------------------------------------------
+#
+# Placer benchmarks
+#
+#-------------------------------------------------
+
+QT       += core
+
+QT       -= gui
+
+TARGET = placerbench
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+
+SOURCES += \
+    placerbench/main.cpp \
+    placerbench/netlistgenerator.cpp \
+    common/netlist.cpp \
+    common/cellvariant.cpp \
+    common/cellvariantlist.cpp \
+    common/cellvariantfile.cpp \
+    common/celllibrary.cpp \
+    placer/placementjob.cpp \
+    placer/qp.cpp \
+    placer/placementdb.cpp \
+    placer/clustering.cpp \
+    placer/fmpartitioner.cpp \
+    placer/taskpool.cpp \
+    placer/legalization.cpp \
+    placer/hpwlengine.cpp \
+    placer/variantoptimizer.cpp \
+    placer/coomatrix.cpp \
+    placer/csrmatrix.cpp \
+    placer/preconditioner.cpp \
+    placer/cgsolver.cpp \
+    placer/blockcgsolver.cpp \
+    placer/choleskysolver.cpp \
+    placer/linearsolver.cpp \
+    placer/array.cpp
+
+
+HEADERS += \
+    placerbench/netlistgenerator.h \
+    common/netlist.h \
+    common/vector.h \
+    common/cellvariant.h \
+    common/cellvariantlist.h \
+    common/cellvariantfile.h \
+    common/celllibrary.h \
+    placer/placement.h \
+    placer/placementjob.h \
+    placer/qp.h \
+    placer/placementdb.h \
+    placer/clustering.h \
+    placer/fmpartitioner.h \
+    placer/taskpool.h \
+    placer/legalization.h \
+    placer/hpwlengine.h \
+    placer/variantoptimizer.h \
+    placer/random.h \
+    placer/coomatrix.h \
+    placer/csrmatrix.h \
+    placer/preconditioner.h \
+    placer/cgsolver.h \
+    placer/blockcgsolver.h \
+    placer/choleskysolver.h \
+    placer/linearsolver.h \
+    placer/array.h
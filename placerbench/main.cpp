@@ -0,0 +1,372 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QMap>
+#include <QDir>
+#include <QScopedPointer>
+#include <QTemporaryDir>
+#include <QThread>
+#include <math.h>
+#include "common/netlist.h"
+#include "common/cellvariantfile.h"
+#include "common/celllibrary.h"
+#include "placer/placementjob.h"
+#include "placer/coomatrix.h"
+#include "placer/csrmatrix.h"
+#include "placer/blockcgsolver.h"
+#include "placer/choleskysolver.h"
+#include "placer/qp.h"
+#include "placer/legalization.h"
+#include "placer/hpwlengine.h"
+#include "placer/variantoptimizer.h"
+#include "placer/taskpool.h"
+#include "placer/random.h"
+#include "netlistgenerator.h"
+
+// Same as in the placer
+const int maxVariantPasses = 10;
+
+struct LaplacianSystem
+{
+    CooMatrix *A;
+    Array bx;
+    Array by;
+};
+
+/*
+ * Build a system with the structure produced by solveQP(): clique-expanded nets
+ * between nearby gates plus pad connections on the diagonal.
+ */
+LaplacianSystem
+generateLaplacian(int nGates, Random &random)
+{
+    LaplacianSystem system;
+    system.A = new CooMatrix(nGates);
+    system.bx = Array(nGates);
+    system.by = Array(nGates);
+
+    Array diagonal(nGates);
+    int window = qMax(8, (int)sqrt((double)nGates));
+
+    /* One net per driving gate, fanout 1..4, sinks are taken from a local window.  */
+    for (int driver = 0; driver < nGates; driver++)
+    {
+        QList<int> pins;
+        pins.append(driver);
+
+        int fanout = 1 + random.bounded(4);
+        for (int i = 0; i < fanout; i++)
+        {
+            int sink = driver + random.bounded(2 * window + 1) - window;
+            sink = qBound(0, sink, nGates - 1);
+            if (!pins.contains(sink)) pins.append(sink);
+        }
+        if (pins.size() < 2) continue;
+
+        double w = (pins.size() == 2) ? 1.0 : 1.0 / (pins.size() - 1);
+        for (int i = 0; i < pins.size(); i++)
+        {
+            for (int j = 0; j < pins.size(); j++)
+            {
+                if (i == j) continue;
+                system.A->add(pins[i], pins[j], -w);
+                diagonal[pins[i]] += w;
+            }
+        }
+    }
+
+    /* Pads around the die.  */
+    int nPads = qMax(4, 4 * (int)sqrt((double)nGates));
+    for (int i = 0; i < nPads; i++)
+    {
+        int gate = random.bounded(nGates);
+        diagonal[gate] += 1.0;
+        system.bx[gate] += random.bounded(1000);
+        system.by[gate] += random.bounded(1000);
+    }
+
+    for (int i = 0; i < nGates; i++)
+    {
+        system.A->add(i, i, diagonal[i]);
+    }
+
+    return system;
+}
+
+void
+benchmarkSolvers(int nGates, quint32 seed, bool withCoo)
+{
+    Random random(mixSeed(seed, nGates));
+    LaplacianSystem system = generateLaplacian(nGates, random);
+
+    QElapsedTimer timer;
+
+    timer.start();
+    CsrMatrix csr(*system.A);
+    qint64 conversionTime = timer.nsecsElapsed();
+
+    qDebug("%d gates: COO nnz %d, CSR nnz %d, conversion %.2f ms",
+           nGates, system.A->nnz(), csr.nnz(), conversionTime / 1e6);
+
+    if (withCoo)
+    {
+        timer.start();
+        system.A->solve(system.bx);
+        system.A->solve(system.by);
+        qDebug("  %-22s %10.2f ms", "COO CG", timer.nsecsElapsed() / 1e6);
+    }
+
+    const char *names[] = {"CSR CG", "CSR PCG (Jacobi)", "CSR PCG (IC0)"};
+    Preconditioner::Type types[] = {Preconditioner::None, Preconditioner::Jacobi, Preconditioner::IncompleteCholesky};
+
+    for (int i = 0; i < 3; i++)
+    {
+        timer.start();
+        CgSolver solver(csr, types[i]);
+        qint64 setupTime = timer.nsecsElapsed();
+
+        solver.solve(system.bx);
+        int iterations = solver.iterations();
+        double residual = solver.relativeResidual();
+
+        solver.solve(system.by);
+        iterations += solver.iterations();
+        residual = qMax(residual, solver.relativeResidual());
+
+        qDebug("  %-22s %10.2f ms (setup %.2f ms), %5d iterations, residual %.2e",
+               names[i], timer.nsecsElapsed() / 1e6, setupTime / 1e6, iterations, residual);
+    }
+
+    /* Both axes at once.  */
+    Array x, y;
+
+    timer.start();
+    BlockCgSolver blockSolver(csr, Preconditioner::IncompleteCholesky);
+    qint64 setupTime = timer.nsecsElapsed();
+    blockSolver.solve(system.bx, system.by, x, y);
+    qDebug("  %-22s %10.2f ms (setup %.2f ms), %5d iterations, residual %.2e",
+           "CSR block PCG (IC0)", timer.nsecsElapsed() / 1e6, setupTime / 1e6,
+           blockSolver.iterations(), blockSolver.relativeResidual());
+
+    timer.start();
+    CholeskySolver cholesky(csr);
+    setupTime = timer.nsecsElapsed();
+    cholesky.solve(system.bx, system.by, x, y);
+    qint64 totalTime = timer.nsecsElapsed();
+
+    Array rx = system.bx - csr.matvec(x);
+    Array ry = system.by - csr.matvec(y);
+    double residual = qMax(sqrt(dot(rx, rx) / dot(system.bx, system.bx)),
+                           sqrt(dot(ry, ry) / dot(system.by, system.by)));
+    qDebug("  %-22s %10.2f ms (factor %.2f ms), L nnz %d, residual %.2e",
+           "Cholesky (MD)", totalTime / 1e6, setupTime / 1e6, cholesky.factorNnz(), residual);
+
+    delete system.A;
+}
+
+/*
+ * Pads at their job positions, gates at their placement with the first variant
+ */
+bool
+applyPlacement(Netlist *netlist, const PlacementJob *job, const CellLibrary *library, const NetPlacement &placement)
+{
+    foreach (const QString &item, netlist->allPads())
+    {
+        PlacementJob::PadInfo info;
+        if (!job->padByName(info, netlist->externalName(item)))
+        {
+            qWarning("Can't find pad %s", qPrintable(item));
+            return false;
+        }
+        netlist->setPosition(item, info.x, info.y, info.z);
+    }
+
+    foreach (const QString &gateName, placement.keys())
+    {
+        const GatePlacement &gp = placement[gateName];
+        netlist->setPosition(gateName, gp.x, gp.y, gp.z);
+    }
+
+    foreach (const QString &item, netlist->allItems())
+    {
+        int cell = library->cellIndex(netlist->cellType(item));
+        if (cell < 0)
+        {
+            qWarning("Can't find cell %s", qPrintable(netlist->cellType(item)));
+            return false;
+        }
+        netlist->setVariant(item, library->variantName(cell, 0));
+    }
+
+    return true;
+}
+
+bool
+benchmarkPhases(const GeneratorOptions &options, TaskPool *pool)
+{
+    QTemporaryDir dir;
+    if (!dir.isValid() || !generateBenchmark(options, dir.path()))
+    {
+        qWarning("Can't generate the netlist");
+        return false;
+    }
+
+    QElapsedTimer timer;
+
+    timer.start();
+    QScopedPointer<Netlist> netlist(Netlist::readFromFile(QDir(dir.path()).filePath("netlist.xml")));
+    QScopedPointer<PlacementJob> job(PlacementJob::readFromFile(QDir(dir.path()).filePath("placer_job.xml")));
+    QScopedPointer<CellVariantFile> variantFile(CellVariantFile::readFromFile(QDir(dir.path()).filePath("vars.xml")));
+    if (netlist.isNull() || job.isNull() || variantFile.isNull())
+    {
+        qWarning("Can't read the generated files");
+        return false;
+    }
+    QScopedPointer<CellLibrary> library(CellLibrary::build(variantFile.data()));
+    if (library.isNull()) return false;
+    if (!applyPlacement(netlist.data(), job.data(), library.data(), NetPlacement())) return false;
+
+    qDebug("%d gates, %d pads, %d nets: read %.2f ms", netlist->allGates().size(), netlist->allPads().size(),
+           netlist->allNets().size(), timer.nsecsElapsed() / 1e6);
+
+    timer.start();
+    NetPlacement placement = placeQuad(netlist.data(), job.data(), library.data());
+    qint64 time = timer.nsecsElapsed();
+    if (!applyPlacement(netlist.data(), job.data(), library.data(), placement)) return false;
+    QScopedPointer<HpwlEngine> engine(HpwlEngine::build(netlist.data(), library.data()));
+    if (engine.isNull()) return false;
+    qDebug("  %-22s %10.2f ms, HPWL %d", "placeQuad", time / 1e6, engine->hpwl());
+
+    timer.start();
+    bool legal = legalize(placement, netlist.data(), library.data(), job.data());
+    time = timer.nsecsElapsed();
+    if (!legal)
+    {
+        qWarning("Can't legalize placement");
+        return false;
+    }
+    if (!applyPlacement(netlist.data(), job.data(), library.data(), placement)) return false;
+    engine.reset(HpwlEngine::build(netlist.data(), library.data()));
+    if (engine.isNull()) return false;
+    qDebug("  %-22s %10.2f ms, HPWL %d", "legalize", time / 1e6, engine->hpwl());
+
+    timer.start();
+    int passes = selectVariants(engine.data(), pool, maxVariantPasses);
+    qDebug("  %-22s %10.2f ms, HPWL %d, %d passes", "optimizeVariants", timer.nsecsElapsed() / 1e6, engine->hpwl(), passes);
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Placer benchmarks");
+    parser.addHelpOption();
+
+    parser.addPositionalArgument("benchmark", QCoreApplication::translate("main", "Benchmark to run: solver, phases or generate"));
+
+    QCommandLineOption sizesOption(QStringList() << "n" << "sizes",
+                                   QCoreApplication::translate("main", "Comma-separated problem sizes"),
+                                   QCoreApplication::translate("main", "sizes"), "1000,5000,20000,50000");
+    parser.addOption(sizesOption);
+
+    QCommandLineOption seedOption(QStringList() << "s" << "seed",
+                                  QCoreApplication::translate("main", "Random seed"),
+                                  QCoreApplication::translate("main", "seed"), "1");
+    parser.addOption(seedOption);
+
+    QCommandLineOption cooOption("coo", QCoreApplication::translate("main", "Also run the COO CG solver"));
+    parser.addOption(cooOption);
+
+    QCommandLineOption rentOption("rent",
+                                  QCoreApplication::translate("main", "Rent exponent of generated netlists"),
+                                  QCoreApplication::translate("main", "p"), "0.6");
+    parser.addOption(rentOption);
+
+    QCommandLineOption fanoutOption("fanout",
+                                    QCoreApplication::translate("main", "Mean fanout of generated netlists"),
+                                    QCoreApplication::translate("main", "fanout"), "2.0");
+    parser.addOption(fanoutOption);
+
+    QCommandLineOption maxFanoutOption("max-fanout",
+                                       QCoreApplication::translate("main", "Maximal fanout of generated netlists"),
+                                       QCoreApplication::translate("main", "fanout"), "8");
+    parser.addOption(maxFanoutOption);
+
+    QCommandLineOption padsOption("pads",
+                                  QCoreApplication::translate("main", "Pads of generated netlists, 0 for Rent's rule"),
+                                  QCoreApplication::translate("main", "pads"), "0");
+    parser.addOption(padsOption);
+
+    QCommandLineOption outputOption(QStringList() << "o" << "output",
+                                    QCoreApplication::translate("main", "Directory for generate, one subdirectory per size"),
+                                    QCoreApplication::translate("main", "directory"), ".");
+    parser.addOption(outputOption);
+
+    // Process the actual command line arguments given by the user
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 1)
+    {
+        parser.showHelp(1);
+    }
+
+    QList<int> sizes;
+    foreach (const QString &s, parser.value(sizesOption).split(","))
+    {
+        bool ok;
+        int n = s.toInt(&ok);
+        if (!ok || (n <= 0))
+        {
+            qWarning("Invalid problem size '%s'", qPrintable(s));
+            return 1;
+        }
+        sizes.append(n);
+    }
+
+    GeneratorOptions options;
+    options.seed = parser.value(seedOption).toUInt();
+    options.rentExponent = parser.value(rentOption).toDouble();
+    options.meanFanout = parser.value(fanoutOption).toDouble();
+    options.maxFanout = parser.value(maxFanoutOption).toInt();
+    options.pads = parser.value(padsOption).toInt();
+
+    if (args[0] == "solver")
+    {
+        foreach (int n, sizes)
+        {
+            benchmarkSolvers(n, options.seed, parser.isSet(cooOption));
+        }
+    }
+    else if (args[0] == "phases")
+    {
+        TaskPool pool(QThread::idealThreadCount());
+        foreach (int n, sizes)
+        {
+            options.gates = n;
+            if (!benchmarkPhases(options, (pool.threadCount() > 1) ? &pool : 0)) return 1;
+        }
+    }
+    else if (args[0] == "generate")
+    {
+        QDir output(parser.value(outputOption));
+        foreach (int n, sizes)
+        {
+            options.gates = n;
+            QString directory = (sizes.size() > 1) ? output.filePath(QString("n%1").arg(n)) : output.path();
+            if (!generateBenchmark(options, directory)) return 1;
+            qDebug("%d gates: %s", n, qPrintable(directory));
+        }
+    }
+    else
+    {
+        qWarning("Unknown benchmark '%s'", qPrintable(args[0]));
+        return 1;
+    }
+
+    return 0;
+}
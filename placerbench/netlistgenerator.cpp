@@ -0,0 +1,570 @@
+#include "netlistgenerator.h"
+#include <QDir>
+#include <QFile>
+#include <QVector>
+#include <QXmlStreamWriter>
+#include <math.h>
+#include "common/vector.h"
+#include "placer/legalization.h"
+#include "placer/random.h"
+
+// Pads of a block of n gates: rentCoefficient * n^p
+const double rentCoefficient = 3.0;
+
+// Gates per legalization site of the area
+const double utilization = 0.6;
+
+// Samples for a sink before the driver gets a smaller fanout
+const int maxSinkTries = 8;
+
+typedef struct {
+    const char *name;
+    int inputs;
+    int percent;
+} GateType;
+
+const GateType gateTypes[] = {
+    {"NOT", 1, 15},
+    {"XOR2", 2, 25},
+    {"AND3", 3, 15},
+    {"NAND3", 3, 15},
+    {"OR3", 3, 15},
+    {"NOR3", 3, 15}
+};
+const int gateTypeCount = sizeof(gateTypes) / sizeof(gateTypes[0]);
+
+const char *const inputPorts[] = {"A", "B", "C"};
+
+// Port positions on the sides of a gate, in the order of its rotations
+const int sides[4][3] = {{1, 1, 0}, {2, 1, 1}, {1, 1, 2}, {0, 1, 1}};
+
+typedef struct {
+    QString instance;
+    QString port;
+} GeneratedPin;
+
+typedef struct {
+    const GeneratorOptions *options;
+    Random *random;
+    int levels;
+
+    QVector<int> types;         // gate -> gateTypes index
+    QVector<int> ranks;         // gate -> position in the order of the nets
+    QVector<int> openInputs;    // gate -> first unconnected input
+    QVector<int> lastNet;       // gate -> last net it was connected to
+
+    // Nets of the gates first, then the nets of the input pads, the driver is the first pin
+    QVector<QList<GeneratedPin> > nets;
+    QList<QString> inputPads;
+    QList<QString> outputPads;
+
+    Vector<int> min;
+    Vector<int> max;
+} GeneratorData;
+
+GeneratorOptions::GeneratorOptions()
+{
+    gates = 1000;
+    pads = 0;
+    rentExponent = 0.6;
+    meanFanout = 2.0;
+    maxFanout = 8;
+    seed = 1;
+}
+
+QString
+gateName(int gate)
+{
+    return QString("g%1").arg(gate);
+}
+
+QString
+netName(const GeneratorData &data, int net)
+{
+    int gates = data.options->gates;
+    return (net < gates) ? QString("n%1").arg(net) : data.inputPads[net - gates];
+}
+
+int
+sampleFanout(const GeneratorData &data)
+{
+    const GeneratorOptions &options = *data.options;
+    int fanout = 1;
+    while ((fanout < options.maxFanout) && (data.random->uniform() >= 1.0 / options.meanFanout))
+    {
+        fanout++;
+    }
+    return fanout;
+}
+
+/*
+ * Gate in the sibling of the level-L block of the anchor, -1 past the last gate
+ */
+int
+sampleSink(const GeneratorData &data, int anchor)
+{
+    double u = 1.0 - data.random->uniform();
+    int level = 1 + (int)(log(u) / ((data.options->rentExponent - 1.0) * log(2.0)));
+    level = qBound(1, level, data.levels);
+
+    int half = 1 << (level - 1);
+    int base = (anchor >> level) << level;
+    int sink = base + ((anchor & half) ? 0 : half) + data.random->bounded(half);
+
+    return (sink < data.options->gates) ? sink : -1;
+}
+
+void
+connectSinks(GeneratorData &data, int net, int anchor, int rank)
+{
+    int fanout = sampleFanout(data);
+    for (int i = 0; i < fanout; i++)
+    {
+        for (int tries = 0; tries < maxSinkTries; tries++)
+        {
+            int sink = sampleSink(data, anchor);
+            if ((sink < 0) || (data.ranks[sink] <= rank) || (data.lastNet[sink] == net)) continue;
+
+            int input = data.openInputs[sink];
+            if (input == gateTypes[data.types[sink]].inputs) continue;
+
+            GeneratedPin pin = {gateName(sink), inputPorts[input]};
+            data.nets[net].append(pin);
+            data.openInputs[sink]++;
+            data.lastNet[sink] = net;
+            break;
+        }
+    }
+}
+
+/*
+ * Driver for an open input: an earlier gate nearby with room for a sink, else an input pad
+ */
+int
+sampleDriver(const GeneratorData &data, int gate)
+{
+    for (int tries = 0; tries < maxSinkTries; tries++)
+    {
+        int driver = sampleSink(data, gate);
+        if ((driver < 0) || (data.ranks[driver] >= data.ranks[gate]) || (data.lastNet[gate] == driver)) continue;
+        if (data.nets[driver].size() > data.options->maxFanout) continue;
+
+        return driver;
+    }
+    return data.options->gates + data.random->bounded(data.inputPads.size());
+}
+
+void
+generateNets(GeneratorData &data)
+{
+    const GeneratorOptions &options = *data.options;
+    int gates = options.gates;
+
+    data.levels = 1;
+    while ((1 << data.levels) < gates)
+    {
+        data.levels++;
+    }
+
+    data.types.resize(gates);
+    data.openInputs.fill(0, gates);
+    data.lastNet.fill(-1, gates);
+    for (int gate = 0; gate < gates; gate++)
+    {
+        int percent = data.random->bounded(100);
+        int type = 0;
+        while ((type < gateTypeCount - 1) && (percent >= gateTypes[type].percent))
+        {
+            percent -= gateTypes[type].percent;
+            type++;
+        }
+        data.types[gate] = type;
+    }
+
+    /* Random order of the gates, nets only go forward  */
+    QVector<int> order(gates);
+    for (int i = 0; i < gates; i++)
+    {
+        order[i] = i;
+    }
+    for (int i = gates - 1; i > 0; i--)
+    {
+        qSwap(order[i], order[data.random->bounded(i + 1)]);
+    }
+    data.ranks.resize(gates);
+    for (int i = 0; i < gates; i++)
+    {
+        data.ranks[order[i]] = i;
+    }
+
+    data.nets.resize(gates + data.inputPads.size());
+    for (int gate = 0; gate < gates; gate++)
+    {
+        GeneratedPin pin = {gateName(gate), "Y"};
+        data.nets[gate].append(pin);
+    }
+
+    /* Input pads come before every gate and hang at random leaves  */
+    for (int i = 0; i < data.inputPads.size(); i++)
+    {
+        int net = gates + i;
+        GeneratedPin pin = {data.inputPads[i], "X"};
+        data.nets[net].append(pin);
+        connectSinks(data, net, data.random->bounded(gates), -1);
+    }
+    foreach (int gate, order)
+    {
+        connectSinks(data, gate, gate, data.ranks[gate]);
+    }
+
+    /* Open inputs go to the nearby gates or the input pads, unloaded outputs to the output pads  */
+    for (int gate = 0; gate < gates; gate++)
+    {
+        for (int input = data.openInputs[gate]; input < gateTypes[data.types[gate]].inputs; input++)
+        {
+            int net = sampleDriver(data, gate);
+            GeneratedPin pin = {gateName(gate), inputPorts[input]};
+            data.nets[net].append(pin);
+            data.lastNet[gate] = net;
+        }
+        data.openInputs[gate] = gateTypes[data.types[gate]].inputs;
+    }
+
+    QList<int> unloaded;
+    for (int gate = 0; gate < gates; gate++)
+    {
+        if (data.nets[gate].size() == 1) unloaded.append(gate);
+    }
+    foreach (const QString &pad, data.outputPads)
+    {
+        int gate = unloaded.isEmpty() ? data.random->bounded(gates) : unloaded.takeAt(data.random->bounded(unloaded.size()));
+        GeneratedPin pin = {pad, "X"};
+        data.nets[gate].append(pin);
+    }
+}
+
+bool
+writeNetlist(const GeneratorData &data, const QString &filePath)
+{
+    QFile fo(filePath);
+    if (!fo.open(QFile::WriteOnly | QFile::Truncate))
+    {
+        qWarning("Can't open %s", qPrintable(filePath));
+        return false;
+    }
+
+    QXmlStreamWriter stream(&fo);
+    stream.setAutoFormatting(true);
+    stream.writeStartDocument();
+    stream.writeStartElement("netlist");
+    stream.writeAttribute("name", "synthetic");
+    stream.writeStartElement("library");
+    stream.writeAttribute("name", "DESIGN");
+    stream.writeStartElement("cell");
+    stream.writeAttribute("name", "synthetic");
+    stream.writeStartElement("contents");
+
+    QList<QString> pads = data.inputPads + data.outputPads;
+    foreach (const QString &pad, pads)
+    {
+        stream.writeStartElement("instance");
+        stream.writeAttribute("name", pad);
+        stream.writeStartElement("cellRef");
+        stream.writeAttribute("name", "PAD");
+        stream.writeAttribute("library", "LIB");
+        stream.writeEndElement();
+        stream.writeStartElement("property");
+        stream.writeAttribute("name", "NAME");
+        stream.writeAttribute("value", pad);
+        stream.writeEndElement();
+        stream.writeEndElement();
+    }
+
+    for (int gate = 0; gate < data.options->gates; gate++)
+    {
+        stream.writeStartElement("instance");
+        stream.writeAttribute("name", gateName(gate));
+        stream.writeStartElement("cellRef");
+        stream.writeAttribute("name", gateTypes[data.types[gate]].name);
+        stream.writeAttribute("library", "LIB");
+        stream.writeEndElement();
+        stream.writeEndElement();
+    }
+
+    for (int net = 0; net < data.nets.size(); net++)
+    {
+        if (data.nets[net].size() < 2) continue;
+
+        stream.writeStartElement("net");
+        stream.writeAttribute("name", netName(data, net));
+        foreach (const GeneratedPin &pin, data.nets[net])
+        {
+            stream.writeStartElement("portRef");
+            stream.writeAttribute("name", pin.port);
+            stream.writeAttribute("instance", pin.instance);
+            stream.writeEndElement();
+        }
+        stream.writeEndElement();
+    }
+
+    stream.writeEndElement();
+    stream.writeEndElement();
+    stream.writeEndElement();
+    stream.writeEndElement();
+    stream.writeEndDocument();
+
+    return true;
+}
+
+void
+writeCoordinates(QXmlStreamWriter &stream, const QString &element, const Vector<int> &p)
+{
+    stream.writeStartElement(element);
+    stream.writeAttribute("x", QString::number(p.x));
+    stream.writeAttribute("y", QString::number(p.y));
+    stream.writeAttribute("z", QString::number(p.z));
+    stream.writeEndElement();
+}
+
+/*
+ * Pads are spread evenly over the ring around the area, inputs and outputs alternate
+ */
+bool
+writeJob(const GeneratorData &data, const QString &filePath)
+{
+    QFile fo(filePath);
+    if (!fo.open(QFile::WriteOnly | QFile::Truncate))
+    {
+        qWarning("Can't open %s", qPrintable(filePath));
+        return false;
+    }
+
+    QXmlStreamWriter stream(&fo);
+    stream.setAutoFormatting(true);
+    stream.writeStartDocument();
+    stream.writeStartElement("job");
+
+    stream.writeStartElement("area");
+    writeCoordinates(stream, "min", data.min);
+    writeCoordinates(stream, "max", data.max);
+    stream.writeEndElement();
+
+    stream.writeStartElement("pads");
+    stream.writeStartElement("cellRef");
+    stream.writeAttribute("name", "PAD");
+    stream.writeAttribute("library", "LIB");
+    stream.writeAttribute("nameProperty", "NAME");
+    stream.writeEndElement();
+
+    QList<QString> pads;
+    for (int i = 0; i < qMax(data.inputPads.size(), data.outputPads.size()); i++)
+    {
+        if (i < data.inputPads.size()) pads.append(data.inputPads[i]);
+        if (i < data.outputPads.size()) pads.append(data.outputPads[i]);
+    }
+
+    int side = data.max.x - data.min.x + 1;
+    for (int i = 0; i < pads.size(); i++)
+    {
+        int position = (qint64)i * 4 * side / pads.size();
+        int offset = position % side;
+
+        Vector<int> p(0, data.min.y, 0);
+        switch (position / side)
+        {
+        case 0: p.x = data.min.x + offset; p.z = data.min.z - 1; break;
+        case 1: p.x = data.max.x + 1; p.z = data.min.z + offset; break;
+        case 2: p.x = data.max.x - offset; p.z = data.max.z + 1; break;
+        default: p.x = data.min.x - 1; p.z = data.max.z - offset; break;
+        }
+
+        stream.writeStartElement("pad");
+        stream.writeAttribute("name", pads[i]);
+        stream.writeAttribute("x", QString::number(p.x));
+        stream.writeAttribute("y", QString::number(p.y));
+        stream.writeAttribute("z", QString::number(p.z));
+        stream.writeEndElement();
+    }
+
+    stream.writeEndElement();
+    stream.writeEndElement();
+    stream.writeEndDocument();
+
+    return true;
+}
+
+void
+writePort(QXmlStreamWriter &stream, const QString &name, const int *position)
+{
+    stream.writeStartElement("port");
+    stream.writeAttribute("name", name);
+    stream.writeAttribute("x", QString::number(position[0]));
+    stream.writeAttribute("y", QString::number(position[1]));
+    stream.writeAttribute("z", QString::number(position[2]));
+    stream.writeEndElement();
+}
+
+void
+writeBlock(QXmlStreamWriter &stream, const QString &type, int rotation, int x, int y, int z)
+{
+    stream.writeStartElement("block");
+    stream.writeAttribute("type", type);
+    stream.writeAttribute("rotation", QString::number(rotation));
+    stream.writeAttribute("x", QString::number(x));
+    stream.writeAttribute("y", QString::number(y));
+    stream.writeAttribute("z", QString::number(z));
+    stream.writeEndElement();
+}
+
+/*
+ * Gate variants: output on one side, inputs on the others, like the redlogic cells
+ */
+void
+writeGateCell(QXmlStreamWriter &stream, const GateType &type)
+{
+    stream.writeStartElement("cell");
+    stream.writeAttribute("name", type.name);
+    stream.writeAttribute("xSize", QString::number(legalizationBlockSize));
+    stream.writeAttribute("ySize", "2");
+    stream.writeAttribute("zSize", QString::number(legalizationBlockSize));
+
+    int variant = 0;
+    for (int output = 0; output < 4; output++)
+    {
+        // A single input may take any free side
+        int choices = (type.inputs == 1) ? 3 : 1;
+        for (int choice = 0; choice < choices; choice++)
+        {
+            QList<int> inputSides;
+            if (type.inputs == 1) inputSides << (output + 1 + choice) % 4;
+            if (type.inputs == 2) inputSides << (output + 1) % 4 << (output + 3) % 4;
+            if (type.inputs == 3) inputSides << (output + 1) % 4 << (output + 2) % 4 << (output + 3) % 4;
+
+            stream.writeStartElement("variant");
+            stream.writeAttribute("name", QString("%1$%2").arg(type.name).arg(++variant, 3, 10, QChar('0')));
+
+            stream.writeStartElement("ports");
+            for (int i = 0; i < inputSides.size(); i++)
+            {
+                writePort(stream, inputPorts[i], sides[inputSides[i]]);
+            }
+            writePort(stream, "Y", sides[output]);
+            stream.writeEndElement();
+
+            stream.writeStartElement("blocks");
+            for (int x = 0; x < legalizationBlockSize; x++)
+            {
+                for (int z = 0; z < legalizationBlockSize; z++)
+                {
+                    writeBlock(stream, "$stone", -1, x, 0, z);
+                }
+            }
+            inputSides << output;
+            foreach (int side, inputSides)
+            {
+                writeBlock(stream, "$blockage", -1, sides[side][0], sides[side][1], sides[side][2]);
+            }
+            writeBlock(stream, "$" + QString(type.name).toLower(), output, 1, 1, 1);
+            stream.writeEndElement();
+
+            stream.writeEndElement();
+        }
+    }
+
+    stream.writeEndElement();
+}
+
+bool
+writeVariants(const QString &filePath)
+{
+    QFile fo(filePath);
+    if (!fo.open(QFile::WriteOnly | QFile::Truncate))
+    {
+        qWarning("Can't open %s", qPrintable(filePath));
+        return false;
+    }
+
+    QXmlStreamWriter stream(&fo);
+    stream.setAutoFormatting(true);
+    stream.writeStartDocument();
+    stream.writeStartElement("cells");
+
+    const int padPort[3] = {0, 1, 0};
+    stream.writeStartElement("cell");
+    stream.writeAttribute("name", "PAD");
+    stream.writeAttribute("xSize", "1");
+    stream.writeAttribute("ySize", "2");
+    stream.writeAttribute("zSize", "1");
+    stream.writeStartElement("variant");
+    stream.writeAttribute("name", "PAD$001");
+    stream.writeStartElement("ports");
+    writePort(stream, "X", padPort);
+    stream.writeEndElement();
+    stream.writeStartElement("blocks");
+    writeBlock(stream, "$stone", -1, 0, 0, 0);
+    writeBlock(stream, "$blockage", -1, 0, 1, 0);
+    stream.writeEndElement();
+    stream.writeEndElement();
+    stream.writeEndElement();
+
+    for (int type = 0; type < gateTypeCount; type++)
+    {
+        writeGateCell(stream, gateTypes[type]);
+    }
+
+    stream.writeEndElement();
+    stream.writeEndDocument();
+
+    return true;
+}
+
+bool
+generateBenchmark(const GeneratorOptions &options, const QString &directory)
+{
+    if ((options.gates < 2) || (options.rentExponent <= 0.0) || (options.rentExponent >= 1.0) ||
+        (options.meanFanout < 1.0) || (options.maxFanout < 1))
+    {
+        qWarning("Invalid generator options");
+        return false;
+    }
+
+    Random random(options.seed);
+
+    GeneratorData data;
+    data.options = &options;
+    data.random = &random;
+
+    /* Square area with a site for every gate, pads on the ring around it  */
+    int sites = (int)ceil(options.gates / utilization);
+    int side = (int)ceil(sqrt((double)sites)) * legalizationBlockSize;
+    data.min = Vector<int>(0, 8, 0);
+    data.max = Vector<int>(side - 1, 9, side - 1);
+
+    int pads = options.pads;
+    if (pads <= 0) pads = (int)(rentCoefficient * pow((double)options.gates, options.rentExponent));
+    pads = qBound(2, pads, 4 * side);
+
+    for (int i = 0; i < (pads + 1) / 2; i++)
+    {
+        data.inputPads.append(QString("in%1").arg(i));
+    }
+    for (int i = 0; i < pads / 2; i++)
+    {
+        data.outputPads.append(QString("out%1").arg(i));
+    }
+
+    generateNets(data);
+
+    QDir dir(directory);
+    if (!dir.mkpath("."))
+    {
+        qWarning("Can't create %s", qPrintable(directory));
+        return false;
+    }
+
+    if (!writeNetlist(data, dir.filePath("netlist.xml"))) return false;
+    if (!writeJob(data, dir.filePath("placer_job.xml"))) return false;
+    if (!writeVariants(dir.filePath("vars.xml"))) return false;
+
+    return true;
+}
@@ -0,0 +1,34 @@
+#ifndef NETLISTGENERATOR_H
+#define NETLISTGENERATOR_H
+
+#include <QString>
+
+struct GeneratorOptions
+{
+    GeneratorOptions();
+
+    int gates;
+    int pads;               // 0: t * gates^p pads by Rent's rule
+    double rentExponent;    // p
+    double meanFanout;
+    int maxFanout;
+    unsigned int seed;
+};
+
+/*
+ * Synthetic combinational circuit for the placer: netlist.xml, placer_job.xml
+ * and vars.xml in the directory, the same seed gives the same files.
+ *
+ * Gates are the leaves of a binary hierarchy. A sink is taken from the
+ * sibling of the level-L block of its driver, with P(L > l) = 2^(l (p - 1)),
+ * so a block of n gates has about n^p nets to the outside (Rent's rule).
+ * Fanout is geometric with the given mean, up to maxFanout. Nets only go to
+ * gates later in a random order, so there are no combinational loops. Inputs
+ * left open are connected to earlier gates the same way or to the input pads,
+ * outputs without sinks drive the output pads. The area has room for every
+ * gate at a utilization of about 60%, pads surround it.
+ */
+bool
+generateBenchmark(const GeneratorOptions &options, const QString &directory);
+
+#endif // NETLISTGENERATOR_H
@@ -21,7 +21,10 @@ SOURCES += \
     router/compactgrid.cpp \
     router/customgrid.cpp \
     router/gridstack.cpp \
-    router/uniformgrid.cpp
+    router/uniformgrid.cpp \
+    router/route.cpp \
+    router/resultwriter.cpp \
+    common/blockstream.cpp
 
 
 HEADERS += \
@@ -33,5 +36,8 @@ HEADERS += \
     router/grid.h \
     router/gridstack.h \
     router/routerrules.h \
-    router/uniformgrid.h
+    router/uniformgrid.h \
+    router/route.h \
+    router/resultwriter.h \
+    common/blockstream.h
 
@@ -14,11 +14,12 @@
 #include "compactgrid.h"
 #include "uniformgrid.h"
 #include "routerrules.h"
+#include "route.h"
+#include "resultwriter.h"
 #include "common/pqueue.h"
 
 typedef QList<Point> Net;
 typedef QMap<QString, Net> Netlist;
-typedef QSet<Point> Route;
 typedef QMap<QString, Route> Routes;
 
 struct Block
@@ -43,6 +44,7 @@ RouterRules rules;
 Netlist netlist;
 Routes routes;
 QMap<QString, int> netColors;
+QMap<QString, float> netCriticalities;
 
 bool
 parsePorts(QXmlStreamReader &xml)
@@ -196,6 +198,19 @@ parseNets(QXmlStreamReader &xml)
                     return false;
                 }
 
+                /* Criticality from the timing analysis of the placer  */
+                QString criticalityStr = attributes.value("criticality").toString();
+                if (!criticalityStr.isEmpty())
+                {
+                    bool ok;
+                    netCriticalities[netName] = criticalityStr.toFloat(&ok);
+                    if (!ok)
+                    {
+                        qWarning("can't parse criticality of net %s", qPrintable(netName));
+                        return false;
+                    }
+                }
+
                 if (!parseNet(xml, netName)) return false;
             }
         }
@@ -308,6 +323,7 @@ readJob(const QString &filePath)
     rules.useAstarApproximation = false;
     rules.aStarMultiplier = 1;
     rules.sortByHPWL = false;
+    rules.criticalityDiscount = 0.5;
 
     QFile f(filePath);
     if (!f.open(QFile::ReadOnly))
@@ -352,6 +368,21 @@ readJob(const QString &filePath)
             {
                 rules.sortByHPWL = true;
             }
+            if (xml.name() == "timing")
+            {
+                QXmlStreamAttributes attributes = xml.attributes();
+                QString discountStr = attributes.value("discount").toString();
+                if (!discountStr.isEmpty())
+                {
+                    bool ok;
+                    rules.criticalityDiscount = discountStr.toFloat(&ok);
+                    if (!ok || (rules.criticalityDiscount < 0) || (rules.criticalityDiscount > 1))
+                    {
+                        qWarning("can't parse criticality discount value");
+                        return false;
+                    }
+                }
+            }
         }
     }
 
@@ -405,10 +436,12 @@ bool
 route(const QString &netName, bool allowSharing)
 {
     QList<Point> net = netlist[netName];
+    float congestionShare = 1 - rules.criticalityDiscount * netCriticalities.value(netName, 0);
 
     QSet<Point> sources; sources.insert(net.first());
     QSet<Point> targets = net.mid(1).toSet();
     QSet<Point> routePoints;
+    Route path;
     bool error = false;
 
     /* Unblock current net.  */
@@ -457,13 +490,18 @@ route(const QString &netName, bool allowSharing)
                 while (!sources.contains(p))
                 {
                     routePoints.insert(p);
+                    path.addPoint(p);
 
                     CellState st = reached[p];
 
                     p = p - st.direction;
                 }
 
-                routePoints.insert(p);
+                if (!routePoints.contains(p))
+                {
+                    routePoints.insert(p);
+                    path.addPoint(p);
+                }
                 sources = routePoints;
 
                 break;
@@ -481,6 +519,12 @@ route(const QString &netName, bool allowSharing)
                 int weight = gridStack.get(next);
                 if (weight == -1) continue;
 
+                /* Critical nets pay less for congestion, so other nets make the detours.  */
+                if (weight > 1)
+                {
+                    weight = 1 + (int)((weight - 1) * congestionShare);
+                }
+
                 int nextPathCost = st.pathCost + weight;
 
                 /* Calculate cost approximation.  */
@@ -533,7 +577,7 @@ route(const QString &netName, bool allowSharing)
         }
 
         /* Register route.  */
-        routes[netName] = routePoints;
+        routes[netName] = path;
 
         /*QList<Point> ps = routePoints.toList();
         qSort(ps);
@@ -557,7 +601,7 @@ route(const QString &netName, bool allowSharing)
             foreach (const QString &netName, routes.keys())
             {
                 Route route = routes[netName];
-                foreach (const Point &p2, route)
+                foreach (const Point &p2, route.points())
                 {
                     if ((p - p2).length() == 1)
                     {
@@ -642,8 +686,7 @@ routeAllNets(bool oneShot)
             QMap<Point, QList<QString> > conflictingNets;
             foreach (const QString &netName, nets)
             {
-                Route route = routes[netName];
-                foreach (const Point &p, route)
+                foreach (const Point &p, routes[netName].points())
                 {
                     conflictingNets[p].append(netName);
                 }
@@ -686,8 +729,7 @@ colorize()
 
     foreach (const QString &netName, routes.keys())
     {
-        Route route = routes[netName];
-        foreach (const Point &p, route)
+        foreach (const Point &p, routes[netName].points())
         {
             pointMap[p] = netName;
         }
@@ -696,9 +738,8 @@ colorize()
     int maxColor = -1;
     foreach (const QString &netName, routes.keys())
     {
-        Route route = routes[netName];
         QSet<int> adjColors;
-        foreach (const Point &p, route)
+        foreach (const Point &p, routes[netName].points())
         {
             for (int dirIndex = 0; dirIndex < 6; dirIndex++)
             {
@@ -742,74 +783,58 @@ colorize()
 }
 
 bool
-saveResults(const QString &filePath)
+saveResults(const QString &filePath, const QString &format)
 {
     QFile f(filePath);
     if (!f.open(QFile::WriteOnly | QFile::Truncate))
     {
-        qCritical("Can't open XML file");
-        return 1;
+        qCritical("Can't open result file");
+        return false;
     }
 
-    QXmlStreamWriter stream(&f);
-    stream.setAutoFormatting(true);
-    stream.writeStartDocument();
-
-    stream.writeStartElement("blocks");
+    QScopedPointer<ResultWriter> writer(ResultWriter::create(format, &f));
+    if (writer.isNull())
+    {
+        qCritical("Unknown result format '%s'", qPrintable(format));
+        return false;
+    }
 
     foreach (const Block &block, blocks)
     {
         if (block.type == "$blockage") continue;
 
-        stream.writeStartElement("block");
-        stream.writeAttribute("type", block.type);
-        stream.writeAttribute("rotation", QString::number(block.rotation));
-        stream.writeAttribute("x", QString::number(block.p.x));
-        stream.writeAttribute("y", QString::number(block.p.y));
-        stream.writeAttribute("z", QString::number(block.p.z));
-        stream.writeEndElement();
+        writer->writeBlock(block.type, block.rotation, block.p);
     }
     int wirelength = 0;
-    foreach (const QString &netName, routes.keys())
+    for (Routes::const_iterator it = routes.constBegin(); it != routes.constEnd(); ++it)
     {
-        stream.writeComment(QString(" Net '%1' ").arg(netName));
+        const QString &netName = it.key();
+        const Route &route = it.value();
+
+        writer->writeComment(QString(" Net '%1' ").arg(netName));
         int color = netColors.value(netName, -1);
 
         /* Place wires on pads.  */
+        QString padWireType = QString("$wire%1").arg(color);
         foreach (const Point &p, netlist[netName])
         {
-            stream.writeStartElement("block");
-            stream.writeAttribute("type", QString("$wire%1").arg(color));
-            stream.writeAttribute("rotation", "-1");
-            stream.writeAttribute("x", QString::number(p.x));
-            stream.writeAttribute("y", QString::number(p.y));
-            stream.writeAttribute("z", QString::number(p.z));
-            stream.writeEndElement();
+            writer->writeBlock(padWireType, -1, p);
         }
 
-        QList<Point> route = routes[netName].toList();
-        qSort(route);
-        foreach (const Point &p, route)
+        QString wireType = QString("$fswire%1").arg(color);
+        foreach (const Route::Segment &segment, route.segments())
         {
-            stream.writeStartElement("block");
-            stream.writeAttribute("type", QString("$fswire%1").arg(color));
-            stream.writeAttribute("rotation", "-1");
-            stream.writeAttribute("x", QString::number(p.x));
-            stream.writeAttribute("y", QString::number(p.y));
-            stream.writeAttribute("z", QString::number(p.z));
-            stream.writeEndElement();
-            wirelength++;
+            writer->writeSegment(wireType, -1, segment);
         }
+        wirelength += route.size();
     }
 
-    stream.writeEndElement();
-
-    stream.writeEndDocument();
+    bool ok = writer->finish();
     f.close();
 
     qDebug("Wirelength: %d", wirelength);
 
-    return true;
+    return ok;
 }
 
 int main(int argc, char *argv[])
@@ -824,6 +849,11 @@ int main(int argc, char *argv[])
     parser.addPositionalArgument("job", QCoreApplication::translate("main", "Routing job file"));
     parser.addPositionalArgument("result", QCoreApplication::translate("main", "Routing result"));
 
+    QCommandLineOption formatOption(QStringList() << "f" << "format",
+                                    QCoreApplication::translate("main", "Result format: blocks (default), segments or binary"),
+                                    QCoreApplication::translate("main", "format"), "blocks");
+    parser.addOption(formatOption);
+
     // Process the actual command line arguments given by the user
     parser.process(app);
 
@@ -855,7 +885,11 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    saveResults(args[2]);
+    if (!saveResults(args[2], parser.value(formatOption)))
+    {
+        qWarning("Can't save results");
+        return 1;
+    }
 
     return 0;
 }
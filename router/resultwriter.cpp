@@ -0,0 +1,129 @@
+#include "resultwriter.h"
+
+ResultWriter *
+ResultWriter::create(const QString &format, QIODevice *device)
+{
+    if (format == "blocks")
+    {
+        return new XmlBlockWriter(device);
+    }
+    else if (format == "segments")
+    {
+        return new XmlSegmentWriter(device);
+    }
+    else if (format == "binary")
+    {
+        return new BinaryResultWriter(device);
+    }
+    else
+    {
+        return 0;
+    }
+}
+
+XmlBlockWriter::XmlBlockWriter(QIODevice *device)
+    : m_stream(device)
+{
+    m_stream.setAutoFormatting(true);
+    m_stream.writeStartDocument();
+    m_stream.writeStartElement("blocks");
+}
+
+void
+XmlBlockWriter::writeBlock(const QString &type, int rotation, const Point &p)
+{
+    m_stream.writeStartElement("block");
+    m_stream.writeAttribute("type", type);
+    m_stream.writeAttribute("rotation", QString::number(rotation));
+    m_stream.writeAttribute("x", QString::number(p.x));
+    m_stream.writeAttribute("y", QString::number(p.y));
+    m_stream.writeAttribute("z", QString::number(p.z));
+    m_stream.writeEndElement();
+}
+
+void
+XmlBlockWriter::writeSegment(const QString &type, int rotation, const Route::Segment &segment)
+{
+    Point p = segment.start;
+    for (int i = 0; i < segment.length; i++)
+    {
+        writeBlock(type, rotation, p);
+        p = p + segment.step;
+    }
+}
+
+void
+XmlBlockWriter::writeComment(const QString &text)
+{
+    m_stream.writeComment(text);
+}
+
+bool
+XmlBlockWriter::finish()
+{
+    m_stream.writeEndElement();
+    m_stream.writeEndDocument();
+    return !m_stream.hasError();
+}
+
+XmlSegmentWriter::XmlSegmentWriter(QIODevice *device)
+    : XmlBlockWriter(device)
+{
+    /* Compact output, no indentation.  */
+    m_stream.setAutoFormatting(false);
+}
+
+void
+XmlSegmentWriter::writeSegment(const QString &type, int rotation, const Route::Segment &segment)
+{
+    if (segment.length == 1)
+    {
+        writeBlock(type, rotation, segment.start);
+        return;
+    }
+
+    m_stream.writeStartElement("segment");
+    m_stream.writeAttribute("type", type);
+    m_stream.writeAttribute("rotation", QString::number(rotation));
+    m_stream.writeAttribute("x", QString::number(segment.start.x));
+    m_stream.writeAttribute("y", QString::number(segment.start.y));
+    m_stream.writeAttribute("z", QString::number(segment.start.z));
+    m_stream.writeAttribute("dx", QString::number(segment.step.x));
+    m_stream.writeAttribute("dy", QString::number(segment.step.y));
+    m_stream.writeAttribute("dz", QString::number(segment.step.z));
+    m_stream.writeAttribute("length", QString::number(segment.length));
+    m_stream.writeEndElement();
+}
+
+BinaryResultWriter::BinaryResultWriter(QIODevice *device)
+    : m_stream(device)
+{
+    m_stream.writeHeader();
+}
+
+void
+BinaryResultWriter::writeBlock(const QString &type, int rotation, const Point &p)
+{
+    m_stream.writeBlock(type, rotation, Vector<int>(p.x, p.y, p.z));
+}
+
+void
+BinaryResultWriter::writeSegment(const QString &type, int rotation, const Route::Segment &segment)
+{
+    Vector<int> start(segment.start.x, segment.start.y, segment.start.z);
+    Vector<int> step(segment.step.x, segment.step.y, segment.step.z);
+    m_stream.writeRun(type, rotation, start, step, segment.length);
+}
+
+void
+BinaryResultWriter::writeComment(const QString &text)
+{
+    Q_UNUSED(text);
+}
+
+bool
+BinaryResultWriter::finish()
+{
+    m_stream.writeEnd();
+    return !m_stream.hasError();
+}
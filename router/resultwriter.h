@@ -0,0 +1,94 @@
+#ifndef RESULTWRITER_H
+#define RESULTWRITER_H
+
+#include <QString>
+#include <QIODevice>
+#include <QXmlStreamWriter>
+#include "common/blockstream.h"
+#include "point.h"
+#include "route.h"
+
+/*
+ * Streaming writer for routing results.
+ * Blocks and wire segments are written to the device as soon as they are passed in.
+ */
+class ResultWriter
+{
+public:
+    virtual ~ResultWriter() {}
+
+    virtual void
+    writeBlock(const QString &type, int rotation, const Point &p) = 0;
+
+    virtual void
+    writeSegment(const QString &type, int rotation, const Route::Segment &segment) = 0;
+
+    virtual void
+    writeComment(const QString &text) = 0;
+
+    virtual bool
+    finish() = 0;
+
+public:
+    /*
+     * Supported formats:
+     *   "blocks"   - one XML <block> element per block (compatibility mode)
+     *   "segments" - XML with straight wire runs as <segment> elements
+     *   "binary"   - binary block stream (see common/blockstream.h)
+     */
+    static ResultWriter *
+    create(const QString &format, QIODevice *device);
+};
+
+class XmlBlockWriter : public ResultWriter
+{
+public:
+    XmlBlockWriter(QIODevice *device);
+
+    virtual void
+    writeBlock(const QString &type, int rotation, const Point &p);
+
+    virtual void
+    writeSegment(const QString &type, int rotation, const Route::Segment &segment);
+
+    virtual void
+    writeComment(const QString &text);
+
+    virtual bool
+    finish();
+
+protected:
+    QXmlStreamWriter m_stream;
+};
+
+class XmlSegmentWriter : public XmlBlockWriter
+{
+public:
+    XmlSegmentWriter(QIODevice *device);
+
+    virtual void
+    writeSegment(const QString &type, int rotation, const Route::Segment &segment);
+};
+
+class BinaryResultWriter : public ResultWriter
+{
+public:
+    BinaryResultWriter(QIODevice *device);
+
+    virtual void
+    writeBlock(const QString &type, int rotation, const Point &p);
+
+    virtual void
+    writeSegment(const QString &type, int rotation, const Route::Segment &segment);
+
+    virtual void
+    writeComment(const QString &text);
+
+    virtual bool
+    finish();
+
+private:
+    BlockStreamWriter m_stream;
+};
+
+#endif // RESULTWRITER_H
@@ -0,0 +1,70 @@
+#include "route.h"
+
+Route::Route()
+{
+    m_size = 0;
+}
+
+void
+Route::addPoint(const Point &p)
+{
+    m_size++;
+
+    if (!m_segments.isEmpty())
+    {
+        Segment &last = m_segments.last();
+
+        Point end = last.start;
+        end.x += last.step.x * (last.length - 1);
+        end.y += last.step.y * (last.length - 1);
+        end.z += last.step.z * (last.length - 1);
+
+        Point delta = p - end;
+        if (delta.length() == 1)
+        {
+            Direction step(delta.x, delta.y, delta.z);
+            if ((last.length == 1) || (step == last.step))
+            {
+                last.step = step;
+                last.length++;
+                return;
+            }
+        }
+    }
+
+    Segment s;
+    s.start = p;
+    s.step = Direction();
+    s.length = 1;
+    m_segments.append(s);
+}
+
+QList<Route::Segment>
+Route::segments() const
+{
+    return m_segments;
+}
+
+QList<Point>
+Route::points() const
+{
+    QList<Point> result;
+    result.reserve(m_size);
+
+    foreach (const Segment &s, m_segments)
+    {
+        Point p = s.start;
+        for (int i = 0; i < s.length; i++)
+        {
+            result.append(p);
+            p = p + s.step;
+        }
+    }
+    return result;
+}
+
+int
+Route::size() const
+{
+    return m_size;
+}
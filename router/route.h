@@ -0,0 +1,47 @@
+#ifndef ROUTE_H
+#define ROUTE_H
+
+#include <QList>
+#include "point.h"
+#include "direction.h"
+
+/*
+ * Net route stored as a list of straight segments.
+ * Each segment covers "length" points starting at "start" and moving by "step".
+ */
+class Route
+{
+public:
+    struct Segment
+    {
+        Point start;
+        Direction step;
+        int length;
+    };
+
+public:
+    Route();
+
+    /*
+     * Append point to the route. Point is merged into the last segment
+     * if it continues it in a straight line.
+     */
+    void
+    addPoint(const Point &p);
+
+    QList<Segment>
+    segments() const;
+
+    QList<Point>
+    points() const;
+
+    // Number of points in the route
+    int
+    size() const;
+
+private:
+    QList<Segment> m_segments;
+    int m_size;
+};
+
+#endif // ROUTE_H
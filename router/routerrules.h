@@ -12,6 +12,9 @@ struct RouterRules
     float aStarMultiplier;
 
     bool sortByHPWL;
+
+    // Fraction of the congestion cost not paid by a net of criticality 1
+    float criticalityDiscount;
 };
 
 #endif // ROUTERRULES
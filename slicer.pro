@@ -16,7 +16,9 @@ TEMPLATE = app
 
 
 SOURCES += \
-    slicer/main.cpp
+    slicer/main.cpp \
+    common/blockstream.cpp
 
 HEADERS += \
-    common/vector.h
+    common/vector.h \
+    common/blockstream.h
@@ -10,6 +10,7 @@
 #include <QPoint>
 #include <QRect>
 #include "common/vector.h"
+#include "common/blockstream.h"
 
 typedef Vector<int> Point;
 
@@ -142,6 +143,34 @@ readJob(const QString &filePath)
     return true;
 }
 
+void
+appendRun(const Block &first, const Point &step, int length)
+{
+    Block b = first;
+    for (int i = 0; i < length; i++)
+    {
+        blocks.append(b);
+        b.p = b.p + step;
+    }
+}
+
+bool
+readBlockStream(QIODevice *device)
+{
+    BlockStreamReader reader(device);
+    if (!reader.readHeader()) return false;
+
+    Block b;
+    Point step;
+    int length;
+    while (reader.readRun(b.type, b.rotation, b.p, step, length))
+    {
+        appendRun(b, step, length);
+    }
+
+    return !reader.hasError();
+}
+
 bool
 readBlocks(const QString &filePath)
 {
@@ -152,6 +181,11 @@ readBlocks(const QString &filePath)
         return false;
     }
 
+    if (BlockStreamReader::isBlockStream(&f))
+    {
+        return readBlockStream(&f);
+    }
+
     QXmlStreamReader xml(&f);
 
     while (!xml.atEnd() && !xml.hasError())
@@ -188,6 +222,46 @@ readBlocks(const QString &filePath)
 
                 blocks.append(b);
             }
+            else if (xml.name() == "segment")
+            {
+                QXmlStreamAttributes attributes = xml.attributes();
+
+                Block b;
+                Point step;
+                int length;
+
+                b.type = attributes.value("type").toString();
+                if (b.type.isEmpty())
+                {
+                    qWarning("segment type is invalid");
+                    return false;
+                }
+
+                if (!readPoint(b.p, attributes))
+                {
+                    qWarning("segment coordinates are invalid");
+                    return false;
+                }
+                if (!readNumber(b.rotation, "rotation", attributes))
+                {
+                    qWarning("segment rotation is invalid");
+                    return false;
+                }
+                if (!readNumber(step.x, "dx", attributes) ||
+                    !readNumber(step.y, "dy", attributes) ||
+                    !readNumber(step.z, "dz", attributes))
+                {
+                    qWarning("segment direction is invalid");
+                    return false;
+                }
+                if (!readNumber(length, "length", attributes) || (length < 1))
+                {
+                    qWarning("segment length is invalid");
+                    return false;
+                }
+
+                appendRun(b, step, length);
+            }
         }
     }
 